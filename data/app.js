@@ -210,6 +210,151 @@ function updatePID() {
         });
 }
 
+function readFilterInputs(prefix) {
+    return {
+        enabled: document.getElementById(prefix + 'FilterEnabled').checked,
+        minCutoffHz: parseFloat(document.getElementById(prefix + 'FilterMinCutoff').value),
+        beta: parseFloat(document.getElementById(prefix + 'FilterBeta').value),
+        dCutoffHz: parseFloat(document.getElementById(prefix + 'FilterDCutoff').value)
+    };
+}
+
+function updateFilter() {
+    fetch('/api/filter', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify({
+            cyclic: readFilterInputs('cyclic'),
+            collective: readFilterInputs('collective')
+        })
+    })
+        .then(response => response.json())
+        .catch(err => console.error('Filter update failed:', err));
+}
+
+let filterInited = false;
+function updateFilterDisplay(filters) {
+    // Fill inputs once on load, like the PID inputs
+    if (filterInited || !filters || !filters.cyclic || !filters.collective) return;
+    for (const prefix of ['cyclic', 'collective']) {
+        const f = filters[prefix];
+        document.getElementById(prefix + 'FilterEnabled').checked = f.enabled;
+        document.getElementById(prefix + 'FilterMinCutoff').value = f.minCutoffHz;
+        document.getElementById(prefix + 'FilterBeta').value = f.beta;
+        document.getElementById(prefix + 'FilterDCutoff').value = f.dCutoffHz;
+    }
+    filterInited = true;
+}
+
+// Response curves: settings per axis as returned by /api/curves
+let curves = {};
+
+// Same shapes as the firmware (response_curve.cpp), for the preview
+function evaluateCurve(c, x) {
+    const a = Math.min(Math.max(c.amount || 0, 0), 1);
+    if (c.type === 'expo') {
+        const n = (x - 5000) / 5000;
+        return 5000 + ((1 - a) * n + a * n * n * n) * 5000;
+    }
+    if (c.type === 'scurve') {
+        const u = x / 10000;
+        return ((1 - a) * u + a * u * u * (3 - 2 * u)) * 10000;
+    }
+    if (c.type === 'points' && c.points.length >= 2) {
+        const p = c.points;
+        if (x <= p[0][0]) return p[0][1];
+        for (let i = 1; i < p.length; i++) {
+            if (x <= p[i][0]) {
+                const t = (x - p[i - 1][0]) / (p[i][0] - p[i - 1][0]);
+                return p[i - 1][1] + t * (p[i][1] - p[i - 1][1]);
+            }
+        }
+        return p[p.length - 1][1];
+    }
+    return x;
+}
+
+function parseCurvePoints(text) {
+    return text.split(',')
+        .map(s => s.trim())
+        .filter(s => s.length > 0)
+        .map(s => s.split(':').map(v => parseInt(v, 10)));
+}
+
+function readCurveInputs() {
+    return {
+        type: document.getElementById('curveType').value,
+        amount: parseFloat(document.getElementById('curveAmount').value) || 0,
+        points: parseCurvePoints(document.getElementById('curvePoints').value)
+    };
+}
+
+function drawCurvePreview() {
+    const canvas = document.getElementById('curvePreview');
+    const ctx = canvas.getContext('2d');
+    const w = canvas.width;
+    const h = canvas.height;
+    const c = readCurveInputs();
+
+    ctx.clearRect(0, 0, w, h);
+    ctx.strokeStyle = 'rgba(255, 255, 255, 0.15)';
+    ctx.beginPath();
+    ctx.moveTo(0, h);
+    ctx.lineTo(w, 0);
+    ctx.stroke();
+
+    ctx.strokeStyle = '#64ffda';
+    ctx.lineWidth = 2;
+    ctx.beginPath();
+    for (let px = 0; px <= w; px++) {
+        const y = evaluateCurve(c, px / w * 10000);
+        const py = h - Math.min(Math.max(y, 0), 10000) / 10000 * h;
+        if (px === 0) ctx.moveTo(px, py);
+        else ctx.lineTo(px, py);
+    }
+    ctx.stroke();
+    ctx.lineWidth = 1;
+}
+
+function showCurve() {
+    const c = curves[document.getElementById('curveAxis').value];
+    if (!c) return;
+    document.getElementById('curveType').value = c.type;
+    document.getElementById('curveAmount').value = c.amount;
+    document.getElementById('curvePoints').value = c.points.map(p => p[0] + ':' + p[1]).join(', ');
+    drawCurvePreview();
+}
+
+function loadCurves() {
+    fetch('/api/curves')
+        .then(response => response.json())
+        .then(data => {
+            curves = data;
+            showCurve();
+        })
+        .catch(err => console.error('Curve load failed:', err));
+}
+
+function updateCurve() {
+    const body = readCurveInputs();
+    body.axis = document.getElementById('curveAxis').value;
+    fetch('/api/curves', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(body)
+    })
+        .then(response => response.json())
+        .then(data => {
+            if (data.error) {
+                alert('Curve not applied: ' + data.error);
+                return;
+            }
+            curves = data;
+            showCurve();
+        })
+        .catch(err => console.error('Curve update failed:', err));
+}
+
 let pidInited = false;
 function updateAutopilotDisplay(ap) {
     const lateralEl = document.getElementById('apLateral');
@@ -371,6 +516,7 @@ function connect() {
             const sim = data.simulator || {};
             lastSimData = sim;
             updateAutopilotDisplay(ap);
+            updateFilterDisplay(data.filters);
             updateAPToggleButton(ap.enabled);
             updateSimulatorDisplay(sim, ap);
 
@@ -485,6 +631,17 @@ document.getElementById('apToggleBtn').addEventListener('click', toggleAP);
 // PID Apply button
 document.getElementById('pidApplyBtn').addEventListener('click', updatePID);
 
+// Axis filter Apply button
+document.getElementById('filterApplyBtn').addEventListener('click', updateFilter);
+
+// Response curves
+document.getElementById('curveAxis').addEventListener('change', showCurve);
+document.getElementById('curveType').addEventListener('change', drawCurvePreview);
+document.getElementById('curveAmount').addEventListener('input', drawCurvePreview);
+document.getElementById('curvePoints').addEventListener('input', drawCurvePreview);
+document.getElementById('curveApplyBtn').addEventListener('click', updateCurve);
+loadCurves();
+
 // AP Target Adjustment buttons (D-Pad)
 document.getElementById('apPitchUpBtn').addEventListener('click', () => adjustAPTarget('pitch', -1));   // Pitch UP = lower degree (negative)
 document.getElementById('apPitchDownBtn').addEventListener('click', () => adjustAPTarget('pitch', 1));   // Pitch DOWN = higher degree (positive)
@@ -634,6 +791,8 @@ function updateSimulatorDisplay(sim, ap) {
     document.getElementById('simPitchText').textContent = sim.pitch !== undefined ? sim.pitch.toFixed(1) : '--';
     document.getElementById('simRollText').textContent = sim.roll !== undefined ? sim.roll.toFixed(1) : '--';
     document.getElementById('simLastUpdate').textContent = formatAge(sim.lastSimDataAgeMs);
+    const simPortNames = { usb: 'USB', uart: 'UART' };
+    document.getElementById('simPort').textContent = simPortNames[sim.port] || '--';
 
     // Indicators
     const rollNeedle = document.getElementById('rollNeedle');
@@ -0,0 +1,58 @@
+#ifndef AXIS_FILTER_H
+#define AXIS_FILTER_H
+
+#include <stdint.h>
+
+// =============================================================================
+// Adaptive axis filter (One Euro filter, fixed point)
+// =============================================================================
+// A low-pass filter whose cutoff rises with the speed of the input:
+//   cutoff = minCutoff + beta * |filtered speed|
+// At rest the cutoff sits at minCutoff and sensor noise is smoothed hard; in
+// a fast move the cutoff opens up and the filter adds almost no lag.
+// (Casiez et al., "1 Euro Filter", CHI 2012.)
+//
+// Works on axis values (0-10000) with a Q8 state, timestamps in microseconds
+// so it copes with irregular sample intervals. Integer math only.
+// =============================================================================
+
+#define AXIS_FILTER_MAX_CUTOFF_MHZ 1000000  // Cutoff clamp (1 kHz = effectively off)
+#define AXIS_FILTER_MIN_DT_US      100      // Shorter (or zero) steps are treated as 100 us
+#define AXIS_FILTER_MAX_DT_US      100000   // Longer gaps are treated as 100 ms
+#define AXIS_FILTER_MAX_SPEED      10000000 // Speed clamp, axis units/s
+
+// Tuning (runtime adjustable via /api/filter)
+struct AxisFilterSettings {
+    bool enabled = false;
+    float minCutoffHz = 0.0f;  // Cutoff at rest (lower = smoother, more lag when slow)
+    float beta = 0.0f;         // Cutoff increase in Hz per axis unit/s of speed
+    float dCutoffHz = 0.0f;    // Cutoff of the speed estimate
+};
+
+class AxisFilter {
+public:
+  AxisFilter();
+
+  // Apply settings (cheap no-op if unchanged). Disabling resets the state.
+  void configure(const AxisFilterSettings& settings);
+
+  // Forget history; the next sample passes through unchanged
+  void reset();
+
+  // Filter one sample taken at timeUs. Returns the input when disabled.
+  int16_t update(int16_t value, int64_t timeUs);
+
+private:
+  AxisFilterSettings current;
+  uint32_t minCutoffMilliHz;
+  uint32_t dCutoffMilliHz;
+  uint32_t betaMicro;     // beta * 1e6: mHz per 1000 units/s
+  bool primed;
+  int32_t valueQ8;        // Filtered value, Q8
+  int32_t speed;          // Filtered speed, axis units/s
+  int64_t lastUs;
+
+  static int32_t alphaQ16(uint32_t cutoffMilliHz, uint32_t dtUs);
+};
+
+#endif // AXIS_FILTER_H
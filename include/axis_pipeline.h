@@ -0,0 +1,89 @@
+#ifndef AXIS_PIPELINE_H
+#define AXIS_PIPELINE_H
+
+#include <stdint.h>
+#include "axis_range.h"
+
+// =============================================================================
+// Axis pipeline: raw 12-bit sensor value -> joystick axis value
+// =============================================================================
+// unwrap (ranges crossing 4095 -> 0) -> clamp to calibration -> map to
+// AXIS_MIN..AXIS_MAX -> invert. The whole pipeline is evaluated at compile
+// time for every raw value, so a conversion at runtime is one table lookup
+// (8 KB of flash per axis, no divide).
+//
+//   using CollectivePipeline = AxisPipeline<1370, 1500, true, true>;
+//   int16_t axis = CollectivePipeline::map(raw);
+// =============================================================================
+
+#define AXIS_PIPELINE_SENSOR_RANGE 4096  // 12-bit sensors (AS5600)
+
+struct AxisCalibration {
+    uint16_t sensorMin;  // Raw value at the low end of travel
+    uint16_t sensorMax;  // Raw value at the high end of travel
+    bool invert;         // Swap axis direction
+    bool wraps;          // Travel runs sensorMin -> 4095 -> 0 -> sensorMax
+};
+
+// One conversion, computed step by step. Used to build the tables; the
+// integer math matches the per-sample code the tables replaced.
+constexpr int16_t axisPipelineConvert(uint16_t raw, const AxisCalibration& cal) {
+    int32_t value = raw;
+    int32_t lo = cal.sensorMin;
+    int32_t hi = cal.sensorMax;
+
+    // Unwrap into one continuous range: values past the 4095 -> 0 boundary
+    // continue above 4095
+    if (cal.wraps) {
+        if (raw <= cal.sensorMax) {
+            value += AXIS_PIPELINE_SENSOR_RANGE;
+        }
+        hi += AXIS_PIPELINE_SENSOR_RANGE;
+    }
+
+    if (value < lo) {
+        value = lo;
+    }
+    if (value > hi) {
+        value = hi;
+    }
+
+    int32_t mapped = (value - lo) * (AXIS_MAX - AXIS_MIN) / (hi - lo) + AXIS_MIN;
+    if (cal.invert) {
+        mapped = AXIS_MAX - (mapped - AXIS_MIN);
+    }
+    return (int16_t)mapped;
+}
+
+struct AxisLookupTable {
+    int16_t values[AXIS_PIPELINE_SENSOR_RANGE];
+};
+
+constexpr AxisLookupTable makeAxisLookupTable(const AxisCalibration& cal) {
+    AxisLookupTable table = {};
+    for (int32_t raw = 0; raw < AXIS_PIPELINE_SENSOR_RANGE; raw++) {
+        table.values[raw] = axisPipelineConvert((uint16_t)raw, cal);
+    }
+    return table;
+}
+
+template <uint16_t SensorMin, uint16_t SensorMax, bool Invert, bool Wraps = false>
+class AxisPipeline {
+  static_assert(SensorMin < AXIS_PIPELINE_SENSOR_RANGE && SensorMax < AXIS_PIPELINE_SENSOR_RANGE,
+                "Axis calibration must be within the 12-bit sensor range");
+  static_assert(Wraps || SensorMin < SensorMax,
+                "Axis calibration range is empty - set the axis' WRAPS flag if it crosses 4095 -> 0");
+
+public:
+  static constexpr AxisCalibration calibration = {SensorMin, SensorMax, Invert, Wraps};
+
+  // Raw values above 4095 (not produced by 12-bit sensors) read as 4095
+  static int16_t map(uint16_t raw) {
+    return table.values[raw < AXIS_PIPELINE_SENSOR_RANGE ? raw : AXIS_PIPELINE_SENSOR_RANGE - 1];
+  }
+
+private:
+  static constexpr AxisLookupTable table = makeAxisLookupTable(calibration);
+};
+
+#endif // AXIS_PIPELINE_H
@@ -0,0 +1,11 @@
+#ifndef AXIS_RANGE_H
+#define AXIS_RANGE_H
+
+// Axis range: 0 to 10000 (16-bit precision for full sensor resolution).
+// Kept apart from joystick.h so hardware-independent code (and host tests)
+// can use it without Arduino.
+#define AXIS_MIN 0
+#define AXIS_MAX 10000
+#define AXIS_CENTER 5000
+
+#endif // AXIS_RANGE_H
@@ -3,13 +3,24 @@
 
 #include <Arduino.h>
 
-// Initialize the collective axis reading
+// Acquisition counters (background read task)
+struct CollectiveStats {
+    uint32_t reads = 0;       // Successful sensor reads
+    uint32_t busErrors = 0;   // Failed transfers (NACK, timeout, short read)
+    uint32_t recoveries = 0;  // Bus recoveries after repeated errors
+    uint32_t rateHz = 0;      // Successful reads per second
+};
+
+// Initialize the collective axis reading (starts the acquisition task)
 void initCollective();
 
-// Handle collective axis reading and update joystick
-// Should be called regularly from loop()
+// Pick up the latest sensor sample and update joystick
+// Should be called regularly from the control task
 void handleCollective();
 
+// Acquisition counters
+CollectiveStats getCollectiveStats();
+
 // Get the last raw ADC reading (0-4095 for ESP32)
 uint16_t getCollectiveRaw();
 
@@ -98,18 +98,124 @@
 
 // Collective axis (up/down) calibration
 // Note: This axis wraps around at the ADC boundary (0/4095)
-// Physical range: 1370 (down) → 0 → 4095 → 1500 (up)
-#define COLLECTIVE_SENSOR_MIN 1370   // Sensor value at full down position
-#define COLLECTIVE_SENSOR_MAX 1500   // Sensor value at full up position
-#define COLLECTIVE_INVERT     true   // Set to true to invert axis direction
+// Physical range: 1370 (down) → 4095 → 0 → 1500 (up)
+#define COLLECTIVE_SENSOR_MIN   1370   // Sensor value at full down position
+#define COLLECTIVE_SENSOR_MAX   1500   // Sensor value at full up position
+#define COLLECTIVE_INVERT       true   // Set to true to invert axis direction
+#define COLLECTIVE_SENSOR_WRAPS true   // Travel crosses the 4095 → 0 boundary
+
+// Oversampling: average N consecutive samples into one axis value after
+// calibration. Sensor noise dithers the samples, so the result resolves
+// finer than one raw count; output rate drops by N. 1 = off.
+// Cyclic: per sensor frame - the link rate (debug page) / N is the rate the
+// cyclic reaches the HID reports at. Off by default: the link rate depends on
+// the sensor board, and the axis filter already smooths the resting noise.
+// 4 halves the RMS error with ~1 count of noise and adds 1.5 frames of delay
+// (test/test_decimator).
+#define CYCLIC_DECIMATION             1
+// Collective: one axis update per COLLECTIVE_DECIMATION sensor reads
+// (1 kHz / 4 = 250 Hz)
+#define COLLECTIVE_DECIMATION         4
+
+// HID report suppression: an axis change smaller than MIN_CHANGE (moving on in
+// the same direction) or HYSTERESIS (reversing) doesn't trigger a report by
+// itself; it is sent after HID_SUPPRESS_SETTLE_MS if still pending. Axis
+// units (0-10000). 1 / 1 = report every change.
+#define HID_CYCLIC_MIN_CHANGE         2
+#define HID_CYCLIC_HYSTERESIS         4
+#define HID_COLLECTIVE_MIN_CHANGE     2
+#define HID_COLLECTIVE_HYSTERESIS     4
+#define HID_SUPPRESS_SETTLE_MS        100
+
+// Collective AS5600 acquisition: a background task on core 0 reads the sensor
+// at a fixed rate; the control task only picks up the latest sample.
+#define COLLECTIVE_I2C_CLOCK          400000  // Hz (AS5600: up to 1 MHz)
+#define COLLECTIVE_I2C_TIMEOUT_MS     2       // Give up on a stuck transfer
+#define COLLECTIVE_SAMPLE_PERIOD_MS   1       // 1 kHz (FreeRTOS tick = 1 ms)
+#define COLLECTIVE_RECOVERY_ERRORS    3       // Consecutive bus errors before bus recovery
+#define COLLECTIVE_TASK_CORE          0
+#define COLLECTIVE_TASK_PRIORITY      5       // Above web (0) / housekeeping (1)
+#define COLLECTIVE_TASK_STACK         3072
+// AS5600 CONF register: fastest response, noise is handled by oversampling
+// and the axis filter. Slow filter 3 = 2x (0.286 ms step response),
+// fast filter 0 = off, hysteresis 0 = off.
+#define COLLECTIVE_AS5600_SLOW_FILTER 3
+#define COLLECTIVE_AS5600_FAST_FILTER 0
+#define COLLECTIVE_AS5600_HYSTERESIS  0
+
+// Adaptive axis filter (One Euro) applied after calibration. Smooths sensor
+// noise at rest, opens up during fast moves. Tunable at runtime (/api/filter).
+// beta: Hz of extra cutoff per axis unit/s (full travel is 10000 units)
+#define CYCLIC_FILTER_ENABLED         true
+#define CYCLIC_FILTER_MIN_CUTOFF_HZ   1.0f
+#define CYCLIC_FILTER_BETA            0.005f
+#define CYCLIC_FILTER_D_CUTOFF_HZ     1.0f
+#define COLLECTIVE_FILTER_ENABLED       true
+#define COLLECTIVE_FILTER_MIN_CUTOFF_HZ 1.0f
+#define COLLECTIVE_FILTER_BETA          0.005f
+#define COLLECTIVE_FILTER_D_CUTOFF_HZ   1.0f
+
+// Default response curves (CURVE_LINEAR, CURVE_EXPO, CURVE_SCURVE); amount
+// 0-1. Editable at runtime, including custom points (/api/curves).
+#define CYCLIC_X_CURVE            CURVE_LINEAR
+#define CYCLIC_X_CURVE_AMOUNT     0.0f
+#define CYCLIC_Y_CURVE            CURVE_LINEAR
+#define CYCLIC_Y_CURVE_AMOUNT     0.0f
+#define COLLECTIVE_CURVE          CURVE_LINEAR
+#define COLLECTIVE_CURVE_AMOUNT   0.0f
 
 // Serial protocol settings (for receiving data from AS5600 sensor board)
-#define CYCLIC_SERIAL_BAUD    115200 // Baud rate for cyclic sensor data
+// Protocol v2 (sequence number, sample timestamp, CRC-16) runs at
+// CYCLIC_SERIAL_BAUD. Older v1 boards run at CYCLIC_SERIAL_BAUD_V1: while no
+// valid frame arrives the receiver alternates between the two rates.
+#define CYCLIC_SERIAL_BAUD          921600 // Baud rate for v2 sensor boards
+#define CYCLIC_SERIAL_BAUD_V1       115200 // Baud rate for v1 sensor boards
+#define CYCLIC_SERIAL_BAUD_HUNT_MS  500    // Try the other rate after this long without a frame
+
+// Event-driven receive: UART raises an event per frame and wakes the control
+// task immediately. 0 = plain polling from the control loop.
+#define CYCLIC_SERIAL_RX_EVENTS     1
+#define CYCLIC_SERIAL_RX_TIMEOUT    1   // RX idle timeout in symbol times (~11us at 921600)
 
 // ----------------------------------------------------------------------------
-// Simulator Serial (JSON over UART)
+// Simulator Data (USB CDC, UDP over WiFi, UART fallback)
 // ----------------------------------------------------------------------------
-#define SIM_SERIAL_BAUD     115200  // Baud rate for simulator data
+// The joystick's USB port also carries a CDC-ACM serial channel (composite
+// device). Messages with a sim timestamp are applied whenever they are newer
+// than the current data, whichever source they come from. Messages without
+// one stick to the active source; a higher-priority source (USB > UDP >
+// UART) takes over at once, a lower one once the active source is quiet.
+#define SIM_USB_RX_BUFFER   1024    // CDC receive buffer (bytes)
+#define SIM_USB_RX_EVENTS   1       // Wake the control task when CDC data arrives (0 = poll)
+#define SIM_SOURCE_HOLD_MS  500     // A source counts as alive this long after its last message
+#define SIM_UDP_ENABLED     1       // Listen for simulator datagrams when WiFi is configured
+#define SIM_UDP_PORT        4210    // UDP port for simulator messages (one per datagram)
+#define SIM_UDP_MAILBOX     8       // Datagrams buffered between lwIP and the control task
+
+// Feed requests: ask the bridge for the fields / rate the autopilot needs
+// (sim_feed.h). Bridges that don't answer keep sending at their own rate.
+#define SIM_FEED_REQUESTS         1
+#define SIM_FEED_MONITOR_HZ       5      // Autopilot off: all fields at this rate
+#define SIM_FEED_AP_HZ            50     // Autopilot on: the fields its modes use
+#define SIM_FEED_ACK_TIMEOUT_MS   1000   // Resend an unacknowledged request after this
+#define SIM_FEED_RETRIES          3      // Sends without ack = bridge ignores requests
+#define SIM_FEED_REFRESH_MS       5000   // Repeat an acknowledged request (bridge restarted?)
+#define SIM_FEED_IGNORED_RETRY_MS 10000  // Ask a bridge that ignored us again
+
+// X-Plane: subscribe to its RREF datarefs directly over WiFi (no PC bridge).
+// Requires WiFi. X-Plane sends each reply to the port the request came from.
+#define XPLANE_ENABLED      0
+#define XPLANE_HOST         "192.168.1.100"  // IP address of the X-Plane PC
+#define XPLANE_PORT         49000   // X-Plane's UDP receive port
+#define XPLANE_LOCAL_PORT   49010   // Our port for the RREF replies
+#define XPLANE_RREF_HZ      50      // Reply rate requested from X-Plane (feed requests adjust it)
+#define XPLANE_TIMEOUT_MS   1000    // No reply this long = feed lost, resubscribe
+// X-Plane's signs -> the autopilot's (MSFS bridge) convention: positive
+// pitch = nose down, positive bank = left wing down
+#define XPLANE_PITCH_SIGN   -1.0f
+#define XPLANE_ROLL_SIGN    -1.0f
+#define XPLANE_VS_SIGN      1.0f
+#define SIM_SERIAL_BAUD     115200  // UART baud rate for simulator data
 #define PIN_SIM_RX          43      // RX pin (connect to simulator TX)
 #define PIN_SIM_TX          44      // TX pin (optional, simulator may be RX-only)
 
@@ -119,24 +225,41 @@
 #define SIMULATOR_VALID_TIMEOUT_MS  5000  // Simulator data considered valid for this long (ms)
 #define AP_MIN_SPEED_KNOTS          10    // Min speed (knots) to enable or keep AP on
 
+// The loops run at a fixed rate from an alpha-beta estimate of each simulator
+// channel (sim_estimator.h), not per packet, so gains don't depend on how
+// fast or evenly the bridge sends
+#define AP_LOOP_HZ                 100
+#define SIM_EST_ALPHA              0.5f   // Value correction per packet (0-1)
+#define SIM_EST_BETA               0.15f  // Rate correction per packet
+#define SIM_EST_MAX_PREDICT_MS     250    // Extrapolate this far past the last packet, then hold
+#define SIM_EST_RESET_MS           1000   // Longer gap: the channel restarts from the next packet
+#define SIM_DIFF_SAMPLES           7      // Attitude differentiator window (samples, 3-16)
+#define SIM_DIFF_ORDER             2      // ... fitted polynomial order (1 = slope, 2 = less lag)
+
+// PID engine (pid_controller.h) settings shared by the loops
+#define AP_PID_D_FILTER_S          0.05f  // D low-pass when no attitude rate is available (s)
+#define AP_PID_TRACKING_S          0.2f   // Anti-windup back-calculation time constant (s)
+#define AP_STICK_RATE_LIMIT        20000.0f // Max AP cyclic change (axis units/s; center to stop in 0.25 s)
+
 // PID gains for pitch hold (tune as needed)
 #define AP_PITCH_KP                50.0f
 #define AP_PITCH_KI                10.0f
-#define AP_PITCH_KD                 0.0f
+#define AP_PITCH_KD                 0.0f   // Stick units per deg/s of pitch rate (sim rate, else derived)
 
 // PID gains for roll hold (tune as needed)
 #define AP_ROLL_KP                 50.0f
 #define AP_ROLL_KI                 10.0f
-#define AP_ROLL_KD                  0.0f
+#define AP_ROLL_KD                  0.0f   // Stick units per deg/s of roll rate
 
 // Heading navigation (Outer loop)
 #define AP_HEADING_KP              1.0f   // Bank angle per degree of heading error
 #define AP_MAX_BANK_ANGLE          15.0f  // Max bank during turns (degrees)
-#define AP_HEADING_ROLL_RATE       3.0f   // Max roll change (deg) per update - smooths heading change kick
+#define AP_HEADING_ROLL_RATE       3.0f   // Max roll target ahead of the current roll (deg) - smooths heading change kick
 
 // Vertical speed navigation (Outer loop)
 #define AP_VS_KP                   0.005f // Pitch angle (deg) per fpm of VS error
-#define AP_VS_KI                   0.0002f// Dampened integral gain (per update cycle)
+#define AP_VS_KI                   0.004f // Dampened integral gain (per fpm * s; was 0.0002 per ~20 Hz packet)
+#define AP_VS_PITCH_SMOOTHING_S    0.5f   // Time constant of the target pitch low-pass
 #define AP_MAX_PITCH_ANGLE         10.0f  // Max pitch during VS hold (degrees)
 #define AP_ALT_CAPTURE_WINDOW      50.0f  // Altitude window to trigger ALTS capture (feet/meters)
 #define AP_ALTS_GAIN               2.0f   // VS (fpm) per foot of altitude error
@@ -185,6 +308,64 @@
 #define CYCLIC_FEEDBACK_X_DIR_POS    1     // 1 = HIGH increases sensor, 0 = LOW increases
 #define CYCLIC_FEEDBACK_Y_DIR_POS    1     // Same for Y axis
 
+// ----------------------------------------------------------------------------
+// Force Feedback (USB HID PID effects on the cyclic steppers)
+// ----------------------------------------------------------------------------
+// Host effects (constant, ramp, periodic, spring, damper, inertia, friction)
+// are computed at 1 kHz. Force drives stepping speed; the motors are only
+// energised while an effect pushes. Directions follow CYCLIC_FEEDBACK_*_DIR_POS.
+#define FFB_ENABLED                  1     // 0 = accept effects but never move the motors
+#define FFB_MAX_STEP_RATE            1000  // Steps/s per axis at full force (max 1 per FFB tick)
+#define FFB_ENGAGE_FORCE             500   // Energise the motors above this force (0-10000)
+#define FFB_RELEASE_FORCE            250   // ...and release them below this one
+#define FFB_TRAVEL_LIMIT             9800  // Don't push past this position (-10000..10000 from centre)
+
+// ----------------------------------------------------------------------------
+// Scheduler / Tasks
+// ----------------------------------------------------------------------------
+// The latency-critical chain (sensors -> AP -> HID) runs in a high-priority
+// control task pinned to core 1. LED, buzzer and heartbeat logging run in a
+// low-priority housekeeping task on core 0 next to WiFi and the web server.
+// Each handler runs at its own fixed rate; phases spread slower tasks over
+// different ticks so they don't all land on the same millisecond.
+#define CONTROL_PERIOD_MS            1     // Control chain rate (1 ms = 1 kHz)
+#define CONTROL_TICK_MS              1     // Control scheduler resolution (FreeRTOS tick = 1 ms)
+#define CONTROL_TASK_CORE            1
+#define CONTROL_TASK_PRIORITY        20    // Above Arduino loop (1) and web (0), below USB/WiFi drivers
+#define CONTROL_TASK_STACK           8192
+
+#define HOUSEKEEPING_TICK_MS         10
+#define HOUSEKEEPING_TASK_CORE       0
+#define HOUSEKEEPING_TASK_PRIORITY   1
+#define HOUSEKEEPING_TASK_STACK      4096
+
+// Control task periods
+#define SCHED_BUTTONS_PERIOD_MS      10    // Button matrix scan (~200us per scan)
+#define SCHED_CYCLIC_SERIAL_PERIOD_MS CONTROL_PERIOD_MS  // Cyclic sensor UART
+#define SCHED_SIMULATOR_PERIOD_MS    5     // Simulator JSON UART
+#define SCHED_COLLECTIVE_PERIOD_MS   CONTROL_PERIOD_MS   // Collective (picks up samples from its read task)
+#define SCHED_AP_PERIOD_MS           (1000 / AP_LOOP_HZ) // Autopilot (fixed rate, runs from the estimate)
+#define SCHED_STEPPERS_PERIOD_MS     2     // Stepper hold / motor debug stepping
+#define SCHED_CYCLIC_FEEDBACK_PERIOD_MS CONTROL_PERIOD_MS // Cyclic feedback stepping
+#define SCHED_FFB_PERIOD_MS          CONTROL_PERIOD_MS   // Force-feedback effect engine (fixed 1 ms tick)
+#define SCHED_JOYSTICK_PERIOD_MS     CONTROL_PERIOD_MS   // HID report (sent when changed and the endpoint is free)
+
+// Housekeeping task periods
+#define SCHED_BUZZER_PERIOD_MS       10    // Buzzer state machine
+#define SCHED_STATUS_LED_PERIOD_MS   20    // LED animation
+#define SCHED_HEARTBEAT_PERIOD_MS    2000  // Debug heartbeat log
+#define SCHED_SIM_FEED_PERIOD_MS     100   // Simulator feed rate requests
+#define SCHED_XPLANE_PERIOD_MS       250   // X-Plane RREF subscription watchdog
+
+// ----------------------------------------------------------------------------
+// Sampling Profiler
+// ----------------------------------------------------------------------------
+// PC samples are taken on every FreeRTOS tick (1 kHz) on both cores while
+// the sampler runs (start it from the debug page). 8192 samples = ~4 s of
+// both cores, 40 KB of heap allocated on first start.
+#define SAMPLER_MAX_SAMPLES          8192
+#define SAMPLER_MAX_TASKS            32    // Distinct tasks tracked (< 127)
+
 // ----------------------------------------------------------------------------
 // Logging Configuration
 // ----------------------------------------------------------------------------
@@ -192,4 +373,9 @@
 // DEBUG level logs are not stored, only INFO, WARN, and ERROR
 #define LOG_BUFFER_SIZE     50
 
+// UART0 TX buffer (bytes). Log lines queue here and drain in the background
+// (~11.5 bytes/ms at 115200) instead of blocking the task that logs, which
+// may be the control task.
+#define LOG_SERIAL_TX_BUFFER 2048
+
 #endif // CONFIG_H
@@ -0,0 +1,108 @@
+#ifndef CYCLIC_PARSER_H
+#define CYCLIC_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// Cyclic sensor packet parser (hardware independent)
+// =============================================================================
+// Two frame formats are accepted at any time (auto-detected by start byte):
+//
+// v1 (7 bytes):  0xAA | sensor1 LE16 | sensor2 LE16 | XOR of bytes 1-4 | 0x55
+//
+// v2 (13 bytes): 0xA5 | 0x02 (version) | seq | sensor1 LE16 | sensor2 LE16 |
+//                sample time LE32 (sensor board micros()) |
+//                CRC-16/CCITT-FALSE of bytes 1-10, LE16
+//
+// v2 sequence numbers are checked: gaps count as lost frames, repeated or
+// older frames are counted and dropped so the stick never steps backwards.
+//
+// Bytes go into a ring buffer in whole spans: writeSpan() hands out the free
+// contiguous space so the UART driver can copy straight into it with one
+// readBytes(), commit() publishes the bytes. next() then decodes frames in a
+// single forward pass. On a bad frame the parser advances one byte and looks
+// for the next start marker, so it never re-reads bytes it already rejected
+// and never moves data around.
+// =============================================================================
+
+// Binary protocol constants (from esp32-as5600 project)
+#define PACKET_START_MARKER   0xAA
+#define PACKET_END_MARKER     0x55
+#define PACKET_SIZE           7
+
+#define PACKET_V2_START_MARKER 0xA5
+#define PACKET_V2_VERSION      0x02
+#define PACKET_V2_SIZE         13
+
+// Consecutive "older" v2 frames after which the sender is assumed to have
+// restarted its sequence counter
+#define CYCLIC_PARSER_SEQ_RESYNC 4
+
+#define CYCLIC_PARSER_RING_SIZE 256  // Power of two
+
+struct CyclicSample {
+    uint16_t sensor1;
+    uint16_t sensor2;
+    uint8_t version;    // 1 or 2
+    uint8_t seq;        // v2 only
+    uint32_t sensorUs;  // v2 only: sample time on the sensor board's clock
+};
+
+struct CyclicParserStats {
+    uint32_t frames = 0;        // Valid frames decoded (both versions)
+    uint32_t framesV2 = 0;      // ... of which v2
+    uint32_t badFrames = 0;     // Start marker found but end marker / checksum / CRC wrong
+    uint32_t skippedBytes = 0;  // Bytes discarded while searching for sync
+    uint32_t resyncs = 0;       // Times sync was lost after a good frame
+    uint32_t lost = 0;          // v2 sequence gaps
+    uint32_t duplicates = 0;    // v2 frames with the previous sequence number
+    uint32_t reordered = 0;     // v2 frames older than the previous one
+    uint8_t lastVersion = 0;    // Version of the last valid frame (0 = none yet)
+};
+
+class CyclicParser {
+public:
+  CyclicParser();
+
+  void reset();
+
+  // Free contiguous space at the write position. Fill up to *len bytes and
+  // pass the count to commit(). Space wraps, so a large read may take two
+  // writeSpan()/commit() rounds.
+  uint8_t* writeSpan(size_t* len);
+  void commit(size_t len);
+
+  // Convenience: copy bytes in (returns how many fit)
+  size_t write(const uint8_t* data, size_t len);
+
+  // Decode the next valid frame (v1 or v2). Returns false when no complete
+  // frame is left; an incomplete tail stays buffered for the next commit().
+  bool next(CyclicSample* sample);
+
+  size_t available() const { return head - tail; }
+  const CyclicParserStats& getStats() const { return stats; }
+
+private:
+  static const size_t MASK = CYCLIC_PARSER_RING_SIZE - 1;
+
+  uint8_t ring[CYCLIC_PARSER_RING_SIZE];
+  size_t head;  // Write position (free-running, masked on access)
+  size_t tail;  // Read position
+  CyclicParserStats stats;
+
+  bool synced;
+  bool haveSeq;
+  uint8_t lastSeq;
+  uint8_t olderInRow;
+
+  uint8_t at(size_t offset) const { return ring[(tail + offset) & MASK]; }
+  bool decodeV1(CyclicSample* sample);
+  bool decodeV2(CyclicSample* sample);
+  bool acceptSeq(uint8_t seq);
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as used by v2 frames
+uint16_t cyclicCrc16(const uint8_t* data, size_t len);
+
+#endif // CYCLIC_PARSER_H
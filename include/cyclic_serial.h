@@ -2,11 +2,7 @@
 #define CYCLIC_SERIAL_H
 
 #include <Arduino.h>
-
-// Binary protocol constants (from esp32-as5600 project)
-#define PACKET_START_MARKER   0xAA
-#define PACKET_END_MARKER     0x55
-#define PACKET_SIZE           7
+#include "cyclic_parser.h"  // Protocol constants and packet parser
 
 // Initialize the serial receiver for cyclic sensor data
 void initCyclicSerial();
@@ -25,4 +21,20 @@ bool isCyclicDataValid();
 // Get time since last valid packet (milliseconds)
 unsigned long getCyclicDataAge();
 
+// Frame arrival (UART receive event) to processing latency (microseconds)
+uint32_t getCyclicRxLatencyUs();
+uint32_t getCyclicRxLatencyAvgUs();
+uint32_t getCyclicRxLatencyMaxUs();
+
+// Parser counters (frames, bad frames, resync bytes, v2 loss/duplicates/reorders)
+const CyclicParserStats& getCyclicParserStats();
+
+// Age of the last sample when processed (microseconds). For v2 frames this
+// is measured from the sensor board's sample timestamp, for v1 from arrival.
+uint32_t getCyclicSampleAgeUs();
+uint32_t getCyclicSampleAgeMaxUs();
+
+// UART rate in use (v2 rate or v1 rate, auto-detected)
+uint32_t getCyclicBaud();
+
 #endif // CYCLIC_SERIAL_H
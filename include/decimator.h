@@ -0,0 +1,47 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+
+// =============================================================================
+// Decimating accumulator (oversampling for finer axis resolution)
+// =============================================================================
+// Averages blocks of `ratio` consecutive axis values into one. A calibrated
+// range much smaller than the axis range makes the axis move in steps (e.g.
+// 1700 raw counts stretched over 10000 units: ~6 units per count); sensor
+// noise of a count or so dithers the samples, so the block average lands
+// between those steps. Resolution improves by up to `ratio`, output rate drops
+// by the same factor.
+//
+// Samples are averaged after mapping to the axis range: the mapping is linear
+// inside the calibration range, and this way a range that wraps at 4095 -> 0
+// is averaged in its unwrapped form.
+// =============================================================================
+
+class Decimator {
+public:
+  Decimator();
+
+  // Samples per output value (1 = pass-through). Starts a new block.
+  void setRatio(uint8_t ratio);
+  uint8_t getRatio() const { return ratio; }
+
+  // Add one sample taken at timeUs. Returns true when a block is complete;
+  // its average and mid-block time are then in value() / timeUs().
+  bool add(int16_t sample, int64_t sampleUs);
+
+  int16_t value() const { return out; }
+  int64_t timeUs() const { return outUs; }
+
+  void reset();
+
+private:
+  int32_t sum;
+  uint8_t count;
+  uint8_t ratio;
+  int64_t firstUs;
+  int16_t out;
+  int64_t outUs;
+};
+
+#endif // DECIMATOR_H
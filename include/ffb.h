@@ -0,0 +1,66 @@
+#ifndef FFB_H
+#define FFB_H
+
+#include <Arduino.h>
+#include "profile.h"
+#include "ffb_engine.h"
+
+// =============================================================================
+// USB force feedback (HID PID) on the cyclic steppers
+// =============================================================================
+// The host (DirectInput / Linux ff) builds effects through the PID reports in
+// the joystick's HID descriptor. The effect engine (ffb_engine.h) runs at a
+// fixed 1 kHz in the control task and returns a force per cyclic axis.
+//
+// The cyclic motors are step/dir steppers without torque control, so force
+// becomes stepping speed: |force| sets the step rate (full force =
+// FFB_MAX_STEP_RATE), its sign the direction. The motors are energised
+// (holding torque) once the force passes FFB_ENGAGE_FORCE and released again
+// below FFB_RELEASE_FORCE, so the stick moves freely while no effect pushes.
+// The autopilot's cyclic feedback takes precedence while it is active.
+// =============================================================================
+
+struct FfbStats {
+    uint32_t outputReports = 0;
+    uint32_t featureReports = 0;
+    uint32_t badReports = 0;
+    uint32_t effectsCreated = 0;
+    uint32_t poolFull = 0;
+    uint8_t playing = 0;          // Effects currently playing
+    bool actuatorsEnabled = false;
+    bool paused = false;
+    bool engaged = false;         // Motors energised by force feedback
+    uint8_t deviceGain = 0;
+    int16_t forceX = 0;           // Last computed force (-10000..10000)
+    int16_t forceY = 0;
+    uint32_t stepsX = 0;
+    uint32_t stepsY = 0;
+    ProfileSummary reportToForce; // Output report -> first tick using it (us)
+};
+
+// PID part of the HID report descriptor (inserted into the joystick's
+// application collection)
+extern const uint8_t ffbReportDescriptor[];
+extern const uint16_t ffbReportDescriptorSize;
+
+void initFfb();
+
+// Control task (SCHED_FFB_PERIOD_MS): one engine tick, then step the cyclic motors
+void handleFfb();
+
+// USB callbacks (TinyUSB task). data/len exclude the report ID.
+void ffbOutputReport(uint8_t reportId, const uint8_t* data, uint16_t len);
+void ffbSetFeature(uint8_t reportId, const uint8_t* data, uint16_t len);
+uint16_t ffbGetFeature(uint8_t reportId, uint8_t* buffer, uint16_t len);
+
+// PID State input report: true while it differs from the last one sent.
+// The joystick task sends it and confirms with ffbStateReportSent().
+bool ffbStateReportPending(FfbStateReport* report);
+void ffbStateReportSent(const FfbStateReport& report);
+
+// Motors energised by force feedback (steppers keep them enabled)
+bool isFfbEngaged();
+
+FfbStats getFfbStats();
+
+#endif // FFB_H
@@ -0,0 +1,279 @@
+#ifndef FFB_ENGINE_H
+#define FFB_ENGINE_H
+
+#include <stdint.h>
+
+// =============================================================================
+// Force-feedback effect engine (USB HID PID)
+// =============================================================================
+// Keeps the effect table the host builds through the PID output and feature
+// reports (see ffb.cpp for the descriptor) and turns the playing effects into
+// one force per cyclic axis.
+//
+// No hardware access and no clock of its own: effect time only advances in
+// tick(), one fixed FFB_ENGINE_TICK_US step per call, and all math is
+// integer. Feeding the same report stream between the same ticks with the
+// same stick positions gives bit-identical forces on the ESP32 and on a host.
+//
+// Units:
+//   position  -10000..10000 per axis (stick centre = 0)
+//   force     -10000..10000 per axis, positive pushes towards +position
+//   time      milliseconds (report fields) / engine ticks
+//   angles    hundredths of a degree, polar: 0 = forward (-Y), 9000 = right (+X)
+// =============================================================================
+
+#define FFB_ENGINE_TICK_US     1000   // One tick() = 1 ms of effect time
+#define FFB_MAX_EFFECTS        16     // Effect blocks (block index 1..16)
+#define FFB_AXES               2      // Cyclic X, cyclic Y
+#define FFB_FORCE_MAX          10000
+#define FFB_DURATION_INFINITE  0xFFFF // Duration / loop count meaning "until stopped"
+#define FFB_LOOP_INFINITE      0xFF
+
+// Condition metric full scale: the speed / acceleration at which a
+// coefficient of 10000 produces full force
+#define FFB_DAMPER_SPEED       20000  // Position units/s (full travel in 1 s)
+#define FFB_INERTIA_ACCEL      200000 // Position units/s^2
+#define FFB_FRICTION_SPEED     500    // Friction ramps to full over this speed
+#define FFB_VELOCITY_SHIFT     4      // Speed estimate smoothing (1/16 per tick)
+
+// Report IDs (PID usage page 0x0F). Joystick input report is ID 1.
+#define FFB_REPORT_STATE           0x02  // Input:   PID State
+#define FFB_REPORT_SET_EFFECT      0x11  // Output:  Set Effect
+#define FFB_REPORT_SET_ENVELOPE    0x12  // Output:  Set Envelope
+#define FFB_REPORT_SET_CONDITION   0x13  // Output:  Set Condition
+#define FFB_REPORT_SET_PERIODIC    0x14  // Output:  Set Periodic
+#define FFB_REPORT_SET_CONSTANT    0x15  // Output:  Set Constant Force
+#define FFB_REPORT_SET_RAMP        0x16  // Output:  Set Ramp Force
+#define FFB_REPORT_EFFECT_OP       0x1A  // Output:  Effect Operation
+#define FFB_REPORT_BLOCK_FREE      0x1B  // Output:  PID Block Free
+#define FFB_REPORT_DEVICE_CONTROL  0x1C  // Output:  PID Device Control
+#define FFB_REPORT_DEVICE_GAIN     0x1D  // Output:  Device Gain
+#define FFB_REPORT_CREATE_EFFECT   0x21  // Feature: Create New Effect (set)
+#define FFB_REPORT_BLOCK_LOAD      0x22  // Feature: PID Block Load (get)
+#define FFB_REPORT_POOL            0x23  // Feature: PID Pool (get)
+
+// Effect types, in the order of the Effect Type array in the descriptor
+enum FfbEffectType : uint8_t {
+    FFB_EFFECT_NONE,
+    FFB_EFFECT_CONSTANT,
+    FFB_EFFECT_RAMP,
+    FFB_EFFECT_SQUARE,
+    FFB_EFFECT_SINE,
+    FFB_EFFECT_TRIANGLE,
+    FFB_EFFECT_SAWTOOTH_UP,
+    FFB_EFFECT_SAWTOOTH_DOWN,
+    FFB_EFFECT_SPRING,
+    FFB_EFFECT_DAMPER,
+    FFB_EFFECT_INERTIA,
+    FFB_EFFECT_FRICTION,
+    FFB_EFFECT_TYPE_COUNT
+};
+
+// Report payloads (without the report ID byte), little endian
+struct __attribute__((packed)) FfbSetEffectReport {
+    uint8_t blockIndex;
+    uint8_t effectType;          // FfbEffectType
+    uint16_t durationMs;         // FFB_DURATION_INFINITE = until stopped
+    uint16_t triggerRepeatMs;
+    uint16_t samplePeriodMs;
+    uint16_t startDelayMs;
+    uint8_t gain;                // 0..255
+    uint8_t triggerButton;
+    uint8_t enable;              // bit 0/1: X/Y axis enable, bit 2: direction enable
+    uint16_t direction[FFB_AXES];  // Polar angle in direction[0] (0..35999)
+};
+
+struct __attribute__((packed)) FfbSetEnvelopeReport {
+    uint8_t blockIndex;
+    uint16_t attackLevel;        // 0..10000
+    uint16_t fadeLevel;
+    uint16_t attackTimeMs;
+    uint16_t fadeTimeMs;
+};
+
+struct __attribute__((packed)) FfbSetConditionReport {
+    uint8_t blockIndex;
+    uint8_t parameterBlockOffset;  // Axis the condition applies to (0 = X, 1 = Y)
+    int16_t cpOffset;            // -10000..10000
+    int16_t positiveCoefficient;
+    int16_t negativeCoefficient;
+    uint16_t positiveSaturation; // 0..10000
+    uint16_t negativeSaturation;
+    uint16_t deadBand;           // 0..10000
+};
+
+struct __attribute__((packed)) FfbSetPeriodicReport {
+    uint8_t blockIndex;
+    uint16_t magnitude;          // 0..10000
+    int16_t offset;              // -10000..10000
+    uint16_t phase;              // 0..35999
+    uint16_t periodMs;
+};
+
+struct __attribute__((packed)) FfbSetConstantReport {
+    uint8_t blockIndex;
+    int16_t magnitude;           // -10000..10000
+};
+
+struct __attribute__((packed)) FfbSetRampReport {
+    uint8_t blockIndex;
+    int16_t start;               // -10000..10000
+    int16_t end;
+};
+
+struct __attribute__((packed)) FfbEffectOperationReport {
+    uint8_t blockIndex;
+    uint8_t operation;           // 1 start, 2 start solo, 3 stop
+    uint8_t loopCount;           // FFB_LOOP_INFINITE = until stopped
+};
+
+struct __attribute__((packed)) FfbCreateEffectReport {
+    uint8_t effectType;
+    uint16_t byteCount;
+};
+
+struct __attribute__((packed)) FfbBlockLoadReport {
+    uint8_t blockIndex;
+    uint8_t loadStatus;          // 1 success, 2 full, 3 error
+    uint16_t ramPoolAvailable;
+};
+
+struct __attribute__((packed)) FfbPoolReport {
+    uint16_t ramPoolSize;
+    uint8_t simultaneousEffectsMax;
+    uint8_t flags;               // bit 0: device managed pool, bit 1: shared parameter blocks
+};
+
+struct __attribute__((packed)) FfbStateReport {
+    uint8_t status;              // bit 0 paused, 1 actuators enabled, 2 safety switch, 3 override, 4 power
+    uint8_t effect;              // bit 0 effect playing, bits 1-7 effect block index
+};
+
+struct FfbCondition {
+    int16_t cpOffset = 0;
+    int16_t positiveCoefficient = 0;
+    int16_t negativeCoefficient = 0;
+    uint16_t positiveSaturation = FFB_FORCE_MAX;
+    uint16_t negativeSaturation = FFB_FORCE_MAX;
+    uint16_t deadBand = 0;
+};
+
+struct FfbEffect {
+    FfbEffectType type = FFB_EFFECT_NONE;  // NONE = free block
+    bool playing = false;
+    uint16_t durationMs = FFB_DURATION_INFINITE;
+    uint16_t startDelayMs = 0;
+    uint8_t gain = 255;
+    uint8_t enable = 0;
+    uint16_t direction = 0;
+
+    // Envelope (constant, ramp, periodic)
+    uint16_t attackLevel = 0;
+    uint16_t fadeLevel = 0;
+    uint16_t attackTimeMs = 0;
+    uint16_t fadeTimeMs = 0;
+
+    // Type specific parameters
+    int16_t magnitude = 0;       // Constant force, periodic magnitude
+    int16_t offset = 0;          // Periodic offset
+    uint16_t phase = 0;
+    uint16_t periodMs = 0;
+    int16_t rampStart = 0;
+    int16_t rampEnd = 0;
+    FfbCondition conditions[FFB_AXES];
+    uint8_t conditionCount = 0;  // One block = same condition on every axis
+
+    uint8_t loopCount = 1;
+    uint32_t startMs = 0;        // Engine time the current play started
+};
+
+// Report and effect counters
+struct FfbEngineStats {
+    uint32_t ticks = 0;
+    uint32_t outputReports = 0;
+    uint32_t featureReports = 0;
+    uint32_t badReports = 0;     // Unknown ID, short payload, bad block index
+    uint32_t effectsCreated = 0;
+    uint32_t poolFull = 0;       // Create New Effect with no free block
+};
+
+class FfbEngine {
+public:
+  FfbEngine();
+
+  // Back to power-on state: no effects, actuators disabled, full gain
+  void reset();
+
+  // Host -> device reports. data/len exclude the report ID byte.
+  // Return false for reports that were not understood.
+  bool handleOutput(uint8_t reportId, const uint8_t* data, uint16_t len);
+  bool handleSetFeature(uint8_t reportId, const uint8_t* data, uint16_t len);
+
+  // Device -> host feature report; returns bytes written (0 = unknown ID)
+  uint16_t handleGetFeature(uint8_t reportId, uint8_t* buffer, uint16_t len);
+
+  // Advance effect time by one tick and compute the force on each axis
+  void tick(const int16_t position[FFB_AXES], int16_t force[FFB_AXES]);
+
+  FfbStateReport stateReport() const;
+  bool actuatorsEnabled() const { return actuators; }
+  bool paused() const { return devicePaused; }
+  uint8_t deviceGain() const { return gain; }
+  uint8_t playingCount() const;
+  const FfbEffect& effect(uint8_t blockIndex) const { return effects[blockIndex - 1]; }
+  const FfbEngineStats& getStats() const { return stats; }
+
+private:
+  FfbEffect effects[FFB_MAX_EFFECTS];
+  FfbBlockLoadReport blockLoad;
+  bool actuators;
+  bool devicePaused;
+  uint8_t gain;
+  uint32_t nowMs;                // Effect time (stands still while paused)
+  uint8_t lastPlayed;            // Block index reported in PID State
+
+  // Per-axis motion estimate from successive tick() positions
+  bool primed;
+  int16_t lastPosition[FFB_AXES];
+  int32_t velocity[FFB_AXES];      // Position units/s, smoothed, within +-FFB_DAMPER_SPEED
+  int32_t acceleration[FFB_AXES];  // Position units/s^2, within +-FFB_INERTIA_ACCEL
+
+  FfbEngineStats stats;
+
+  FfbEffect* block(uint8_t blockIndex);
+  void start(FfbEffect& e, uint8_t loopCount);
+  void stopAll();
+  void updateMotion(const int16_t position[FFB_AXES]);
+  int32_t envelope(const FfbEffect& e, uint32_t t, int32_t level) const;
+  int32_t periodic(const FfbEffect& e, uint32_t t) const;
+  int32_t condition(const FfbCondition& c, FfbEffectType type, uint8_t axis,
+                    const int16_t position[FFB_AXES]) const;
+};
+
+// Force -> stepper pulses for one axis, one update() per engine tick. Full
+// force = maxStepRate steps/s (at most one step per tick); forces below
+// releaseForce, and pushes past travelLimit, don't step.
+class FfbStepDrive {
+public:
+  FfbStepDrive(uint16_t maxStepRate, uint16_t releaseForce, int16_t travelLimit);
+
+  // Drop the force-time accumulated towards the next step
+  void reset() { accumulator = 0; }
+
+  // Returns +1 / -1 for a step towards +position / -position, 0 for none
+  int8_t update(int16_t force, int16_t position);
+
+  uint32_t getSteps() const { return steps; }
+
+private:
+  uint32_t maxStepRate;
+  uint32_t releaseForce;
+  int16_t travelLimit;
+  uint32_t accumulator;  // Force * steps/s * ms
+  uint32_t steps;
+};
+
+// Sine of a polar angle in hundredths of a degree, Q14 (16384 = 1.0)
+int32_t ffbSinQ14(int32_t angle);
+
+#endif // FFB_ENGINE_H
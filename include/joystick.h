@@ -2,6 +2,8 @@
 #define JOYSTICK_H
 
 #include <Arduino.h>
+#include "axis_range.h"
+#include "profile.h"
 
 // Joystick configuration
 #define JOYSTICK_AXIS_COUNT 3
@@ -12,16 +14,41 @@
 #define AXIS_CYCLIC_Y 1     // Cyclic forward/back
 #define AXIS_COLLECTIVE 2   // Collective up/down
 
-// Axis range: 0 to 10000 (16-bit precision for full sensor resolution)
-#define AXIS_MIN 0
-#define AXIS_MAX 10000
-#define AXIS_CENTER 5000
+// Origin of an axis value (for input-to-HID latency tracing)
+enum AxisSource {
+    SOURCE_CYCLIC_SENSOR,      // Cyclic sensor board (UART frame)
+    SOURCE_COLLECTIVE_SENSOR,  // Collective AS5600 (I2C read)
+    SOURCE_AUTOPILOT,          // AP output (simulator packet that triggered it)
+    SOURCE_COUNT
+};
+
+// Axis changes put into reports vs. held back by report suppression
+struct AxisReportStats {
+    uint32_t sent = 0;        // Changes reported right away
+    uint32_t settled = 0;     // Held-back values reported after the settle time
+    uint32_t suppressed = 0;  // Changes held back (noise, or superseded before settling)
+};
+
+// HID report path statistics
+struct HidStats {
+    uint32_t reports = 0;  // Reports handed to USB
+    uint32_t rateHz = 0;   // Reports per second
+    uint32_t busy = 0;     // Ticks a changed report waited for the previous transfer
+    uint32_t failed = 0;   // Reports TinyUSB refused
+    ProfileSummary sendLatency;  // State change -> report handed to USB (us)
+};
 
 // Initialize the USB HID joystick
 void initJoystick();
 
 // Set axis value (0 to 10000)
-void setJoystickAxis(uint8_t axis, int16_t value);
+// Changes smaller than the axis' minimum change (or its hysteresis band when
+// reversing direction) are held back and reported once they have settled.
+// sampleUs: esp_timer time of the input sample that produced this value.
+// When non-zero, the delay until the value goes out in a HID report is
+// recorded per axis and per source. 0 = untraced.
+void setJoystickAxis(uint8_t axis, int16_t value,
+                     AxisSource source = SOURCE_COUNT, int64_t sampleUs = 0);
 
 // Set button state (0-31)
 void setJoystickButton(uint8_t button, bool pressed);
@@ -35,6 +62,14 @@ int16_t getJoystickAxis(uint8_t axis);
 // Get current button state
 bool getJoystickButton(uint8_t button);
 
+// Report suppression statistics
+AxisReportStats getAxisReportStats(uint8_t axis);
+HidStats getHidStats();
+
+// Sample-to-report latency statistics (microseconds)
+ProfileSummary getAxisLatency(uint8_t axis);
+ProfileSummary getSourceLatency(AxisSource source);
+
 // Demo function: Update joystick with smooth animated movements
 void updateJoystickDemo();
 
@@ -0,0 +1,69 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <Arduino.h>
+#include "profile.h"
+
+// =============================================================================
+// Serial link quality monitor
+// =============================================================================
+// One LinkMonitor per input link (cyclic sensor UART, simulator UART, USB
+// CDC, UDP and X-Plane). The link's receive code bumps the counters and calls frameReceived()
+// for every good frame; the monitor keeps an inter-arrival histogram and the
+// effective frame rate. Monitors register themselves so /api/debug can list them all.
+// =============================================================================
+
+#define LINK_RATE_WINDOW_US 1000000  // Frame rate measurement window
+
+struct LinkCounters {
+    uint32_t goodFrames = 0;
+    uint32_t checksumErrors = 0;  // Frames with bad checksum / CRC / end marker
+    uint32_t resyncs = 0;         // Times the receiver lost frame sync
+    uint32_t lineOverflows = 0;   // Frames/lines too long for the buffer, UART RX overflows
+    uint32_t parseErrors = 0;     // Complete frames whose content could not be parsed
+    uint32_t discardedBytes = 0;  // Bytes thrown away (resync, overflow)
+    uint32_t uartErrors = 0;      // Framing / parity / break errors reported by the driver
+};
+
+class LinkMonitor {
+public:
+  explicit LinkMonitor(const char* name);
+
+  // Count a good frame that arrived at arrivalUs (esp_timer time)
+  void frameReceived(int64_t arrivalUs);
+
+  // Hook the monitor up to a UART's error callback (overflows, framing errors)
+  void attachUart(HardwareSerial& serial);
+
+  void reset();
+
+  // Counters are written by the link's receive code only
+  LinkCounters counters;
+
+  const char* getName() const { return name; }
+  uint32_t getRateHz() const;
+  ProfileSummary getInterArrival() const;  // Gap between good frames (us)
+
+  static LinkMonitor* first() { return head; }
+  LinkMonitor* getNext() const { return next; }
+
+private:
+  const char* name;
+  ProfileStats gaps;
+  int64_t lastFrameUs;
+  int64_t windowStartUs;
+  uint32_t windowFrames;
+  uint32_t rateHz;
+  LinkMonitor* next;
+
+  static LinkMonitor* head;
+};
+
+// Links
+extern LinkMonitor cyclicLink;
+extern LinkMonitor simulatorLink;
+extern LinkMonitor simulatorUsbLink;
+extern LinkMonitor simulatorUdpLink;
+extern LinkMonitor xplaneLink;
+
+#endif // LINK_MONITOR_H
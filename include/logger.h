@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // Log levels
 enum LogLevel {
@@ -51,9 +53,14 @@ public:
   // Clear all stored entries
   void clear();
 
+  // Write a protocol line to Serial the way log lines go out (whole, in one
+  // write), so a line sharing UART0 never interleaves with a log line
+  void writeSerial(const uint8_t* data, size_t len);
+
 private:
   std::vector<LogEntry> entries;
   size_t maxEntries;
+  SemaphoreHandle_t mutex;  // Logging happens from control, housekeeping and web tasks
   
   // Core logging function
   void log(LogLevel level, const String& message);
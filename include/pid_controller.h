@@ -0,0 +1,144 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+// =============================================================================
+// PID controller (header only, hardware independent)
+// =============================================================================
+//   output = P + I + D, with
+//   P = kp * e                          e = setpoint - measurement (reverse:
+//   I += ki * e * dt                        measurement - setpoint)
+//   D = -kd * d(measurement)/dt
+//
+// - dt is passed to every compute(), so I and D follow the real time between
+//   runs (PID_v1 assumes its sample time passed and skips calls that come
+//   early by millis()).
+// - D acts on the measurement, not the error: a setpoint step doesn't kick.
+//   The derivative is either passed in (a measured rate) or the difference of
+//   measurements, low-passed with time constant derivativeFilterS.
+// - Back-calculation anti-windup: when the output saturates (limits or rate
+//   limit) the integrator is pulled toward the value that was actually output,
+//   by (applied - unsaturated) * dt / trackingS (all of it for trackingS 0).
+// - start() is bumpless: the integrator is seeded so the first output equals
+//   the one given (the stick position when the AP takes over).
+// - outputRateLimit caps the output change per second (0 = off).
+//
+// Float on the target: the ESP32-S3 FPU is single precision only, doubles are
+// software emulated. The template lets host tests run the same code in double.
+// =============================================================================
+
+template <typename T>
+struct PidSettings {
+    T kp = 0;
+    T ki = 0;                  // Per second
+    T kd = 0;                  // Seconds (output per unit/s of the measurement)
+    T outputMin = -1;
+    T outputMax = 1;
+    T derivativeFilterS = 0;   // D low-pass time constant for the internal difference (0 = none)
+    T trackingS = 0;           // Anti-windup time constant (0 = clamp at once)
+    T outputRateLimit = 0;     // Output units per second (0 = off)
+    bool reverse = false;      // Output rises when the measurement rises above the setpoint
+};
+
+template <typename T>
+class PidController {
+public:
+  PidController() { stop(); }
+
+  void configure(const PidSettings<T>& s) { settings = s; }
+  const PidSettings<T>& getSettings() const { return settings; }
+
+  // Live tuning; the integrator holds output units, so this doesn't bump
+  void setTunings(T kp, T ki, T kd) {
+      settings.kp = kp;
+      settings.ki = ki;
+      settings.kd = kd;
+  }
+
+  // Take over at output (clamped to the limits) with no bump: the integrator
+  // absorbs whatever P doesn't account for. Without ki there is no
+  // integrator to seed and the output starts at P.
+  void start(T setpoint, T measurement, T output) {
+      output = clamp(output, settings.outputMin, settings.outputMax);
+      integral = settings.ki != 0 ? output - settings.kp * error(setpoint, measurement) : 0;
+      lastMeasurement = measurement;
+      derivative = 0;
+      lastOutput = output;
+      active = true;
+  }
+
+  // Manual mode: compute() returns the last output unchanged
+  void stop() {
+      active = false;
+      integral = 0;
+      lastMeasurement = 0;
+      derivative = 0;
+      lastOutput = 0;
+  }
+
+  bool isActive() const { return active; }
+
+  // Derivative from the difference of measurements
+  T compute(T setpoint, T measurement, T dt) {
+      if (!active || dt <= 0) {
+          return lastOutput;
+      }
+      // Low-pass of (change / dt) with time constant derivativeFilterS, one
+      // divide; for 0 it reduces to change / dt
+      derivative += (measurement - lastMeasurement - derivative * dt) / (settings.derivativeFilterS + dt);
+      return step(setpoint, measurement, derivative, dt);
+  }
+
+  // Derivative of the measurement supplied (units/s), e.g. a measured rate
+  T compute(T setpoint, T measurement, T rate, T dt) {
+      if (!active || dt <= 0) {
+          return lastOutput;
+      }
+      derivative = rate;
+      return step(setpoint, measurement, rate, dt);
+  }
+
+  T getOutput() const { return lastOutput; }
+  T getIntegral() const { return integral; }
+
+private:
+  PidSettings<T> settings;
+  T integral;          // Output units
+  T lastMeasurement;
+  T derivative;        // Filtered d(measurement)/dt
+  T lastOutput;
+  bool active;
+
+  static T clamp(T value, T lo, T hi) {
+      return value < lo ? lo : (value > hi ? hi : value);
+  }
+
+  T error(T setpoint, T measurement) const {
+      return settings.reverse ? measurement - setpoint : setpoint - measurement;
+  }
+
+  T step(T setpoint, T measurement, T rate, T dt) {
+      lastMeasurement = measurement;
+      T e = error(setpoint, measurement);
+      T d = settings.reverse ? rate : -rate;
+
+      integral += settings.ki * e * dt;
+      T unsaturated = settings.kp * e + integral + settings.kd * d;
+
+      T output = clamp(unsaturated, settings.outputMin, settings.outputMax);
+      if (settings.outputRateLimit > 0) {
+          T maxStep = settings.outputRateLimit * dt;
+          output = clamp(output, lastOutput - maxStep, lastOutput + maxStep);
+      }
+
+      // Back-calculation: bleed off the integral the output couldn't deliver
+      if (output != unsaturated && settings.ki != 0) {
+          T gain = settings.trackingS > dt ? dt / settings.trackingS : 1;
+          integral += (output - unsaturated) * gain;
+      }
+
+      lastOutput = output;
+      return output;
+  }
+};
+
+#endif // PID_CONTROLLER_H
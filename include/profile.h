@@ -3,31 +3,102 @@
 
 #include <Arduino.h>
 
-// Initialize profiling (call from setup)
-void initProfile();
-
-// Start timing a slot (call at start of task)
-void profileStart(uint8_t slot);
-
-// End timing and record (call at end of task). Logs if duration exceeds threshold.
-void profileEnd(uint8_t slot);
-
-// Slot indices for main loop tasks
-#define PROFILE_BUTTONS        0
-#define PROFILE_CYCLIC_SERIAL  1
-#define PROFILE_SIMULATOR      2
-#define PROFILE_COLLECTIVE     3
-#define PROFILE_AP             4
-#define PROFILE_STEPPERS       5
-#define PROFILE_CYCLIC_FEEDBACK 6
-#define PROFILE_BUZZER         7
-#define PROFILE_JOYSTICK       8
-#define PROFILE_STATUS_LED     9
-#define PROFILE_SLOT_COUNT     10
-
-// Get last/max ms for a slot (for debug API)
-unsigned long profileGetLastMs(uint8_t slot);
-unsigned long profileGetMaxMs(uint8_t slot);
-const char* profileGetName(uint8_t slot);
+// =============================================================================
+// Profiling zones (microsecond resolution)
+// =============================================================================
+// A zone is a named timing accumulator. Put PROFILE_ZONE("name") at the top of
+// a block and the block's duration is recorded when it exits. Zones register
+// themselves on first use, so there is no central slot table to maintain.
+//
+// Each zone keeps count / last / min / avg / max and a log-bucketed histogram
+// (4 buckets per power of two, ~12% resolution) for percentiles.
+// Timing comes from esp_timer_get_time(), so sub-millisecond handlers no
+// longer read as 0.
+// =============================================================================
+
+#define PROFILE_HIST_SUB_BITS  2                              // 4 buckets per octave
+#define PROFILE_HIST_OCTAVES   26                             // Up to 2^26 us (~67 s)
+#define PROFILE_HIST_BUCKETS   (PROFILE_HIST_OCTAVES << PROFILE_HIST_SUB_BITS)
+
+#define PROFILE_SLOW_US        50000  // Log when any zone exceeds this
+
+struct ProfileSummary;
+
+// Raw accumulator + histogram. Not thread-safe on its own (see ProfileZone).
+struct ProfileStats {
+    uint32_t count;
+    uint32_t lastUs;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t buckets[PROFILE_HIST_BUCKETS];
+
+    void reset();
+    void record(uint32_t us);
+    uint32_t avgUs() const;
+    // Value at quantile q (0.0-1.0), e.g. 0.99 for p99. Returns bucket midpoint.
+    uint32_t percentileUs(float q) const;
+    // Fill the statistics fields of a summary (name is left alone)
+    void summarize(ProfileSummary& s) const;
+};
+
+// Summary of a zone for the debug API
+struct ProfileSummary {
+    const char* name = "";
+    uint32_t count = 0;
+    uint32_t lastUs = 0;
+    uint32_t minUs = 0;
+    uint32_t avgUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t p50Us = 0;
+    uint32_t p95Us = 0;
+    uint32_t p99Us = 0;
+    uint32_t p999Us = 0;
+};
+
+class ProfileZone {
+public:
+  // slowUs: log a SLOW warning for samples above this (0 = never)
+  explicit ProfileZone(const char* name, uint32_t slowUs = PROFILE_SLOW_US);
+
+  void record(uint32_t us);
+  void reset();
+  ProfileSummary summary() const;
+  const char* getName() const { return name; }
+
+  // Registered zones (in order of first use)
+  static ProfileZone* first() { return head; }
+  ProfileZone* getNext() const { return next; }
+
+private:
+  const char* name;
+  uint32_t slowUs;
+  ProfileStats stats;
+  ProfileZone* next;
+
+  static ProfileZone* head;
+};
+
+// RAII timer: records the time between construction and destruction
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileZone& zone);
+  ~ProfileScope();
+
+private:
+  ProfileZone& zone;
+  int64_t startUs;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Time the rest of the enclosing block in a zone called `name`
+#define PROFILE_ZONE(name) \
+    static ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name); \
+    ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZone_, __LINE__))
+
+// Reset statistics of every registered zone
+void profileResetAll();
 
 #endif // PROFILE_H
@@ -0,0 +1,67 @@
+#ifndef RESPONSE_CURVE_H
+#define RESPONSE_CURVE_H
+
+#include <stdint.h>
+
+// =============================================================================
+// Axis response curves (expo / S-curve / custom points)
+// =============================================================================
+// Shapes the pilot's sensor input (0-10000) on its way to the HID report.
+// Settings live in state and are edited from the web UI; each axis' curve is
+// compiled into a small table when its settings change, so applying it costs
+// one lookup plus a linear interpolation (integer math only).
+//
+//   Expo:    y = (1 - a) x + a x^3, x centred (-1..1). Finer control around
+//            the centre, full authority at the ends.
+//   S-curve: y = (1 - a) u + a (3u^2 - 2u^3), u over the full range (0..1).
+//            Steeper through the centre, softer towards the ends.
+//   Points:  piecewise linear through up to RESPONSE_CURVE_MAX_POINTS (in, out)
+//            pairs; flat before the first and after the last point.
+// =============================================================================
+
+#define RESPONSE_CURVE_SEGMENTS   128  // Table resolution (entries = segments + 1)
+#define RESPONSE_CURVE_MAX_POINTS 9
+
+enum ResponseCurveType : uint8_t {
+    CURVE_LINEAR,
+    CURVE_EXPO,
+    CURVE_SCURVE,
+    CURVE_POINTS
+};
+
+struct ResponseCurvePoint {
+    int16_t in;   // Axis units, strictly increasing
+    int16_t out;  // Axis units
+};
+
+struct ResponseCurveSettings {
+    ResponseCurveType type = CURVE_LINEAR;
+    float amount = 0.0f;  // Expo / S-curve strength, 0 (linear) to 1
+    uint8_t pointCount = 0;
+    ResponseCurvePoint points[RESPONSE_CURVE_MAX_POINTS] = {};
+    uint32_t revision = 0;  // Bump after every change - curves rebuild when it moves
+};
+
+class ResponseCurve {
+public:
+  ResponseCurve();
+
+  // Shape one axis value, rebuilding the table first if settings changed
+  int16_t apply(const ResponseCurveSettings& settings, int16_t value);
+
+private:
+  int16_t table[RESPONSE_CURVE_SEGMENTS + 1];
+  uint32_t builtRevision;
+  bool linear;
+
+  void build(const ResponseCurveSettings& settings);
+};
+
+// Names used by the web API ("linear", "expo", "scurve", "points")
+const char* responseCurveTypeName(ResponseCurveType type);
+bool parseResponseCurveType(const char* name, ResponseCurveType* type);
+
+// Points must be in axis range with strictly increasing inputs
+bool responseCurvePointsValid(const ResponseCurvePoint* points, uint8_t count);
+
+#endif // RESPONSE_CURVE_H
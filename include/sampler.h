@@ -0,0 +1,47 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// Statistical PC-sampling profiler
+// =============================================================================
+// While running, a FreeRTOS tick hook on each core records the program counter
+// and task that the tick interrupt preempted into a fixed RAM buffer. Unlike
+// PROFILE_ZONE this needs no instrumentation, so time spent in WiFi/lwIP,
+// ArduinoJson, NeoPixel show() etc. shows up too.
+//
+// Sampling stops by itself when the buffer is full. Download the samples from
+// /api/sampler/samples and resolve them with tools/pc_report.py against the
+// firmware.elf of the same build.
+//
+// Off by default: the tick hooks are only registered while running and the
+// buffer is allocated on first start.
+// =============================================================================
+
+#define SAMPLER_TASK_ISR 0x7F  // Task index for samples taken inside another ISR
+
+// Start sampling (clears previous samples). Returns false if the buffer
+// cannot be allocated or the tick hooks cannot be registered.
+bool startSampler();
+
+// Stop sampling and resolve the names of tasks seen while running
+void stopSampler();
+
+bool isSamplerRunning();
+
+// The buffer filled and sampling stopped by itself, but stopSampler() has not
+// run yet: hooks still registered, task names not resolved
+bool isSamplerStopPending();
+uint32_t getSamplerCount();
+uint32_t getSamplerCapacity();
+uint32_t getSamplerSampleHz();   // Per core
+
+// Sample access (for the download endpoint). Only valid while stopped.
+bool getSamplerSample(uint32_t index, uint32_t* pc, uint8_t* core, uint8_t* task);
+
+// Name of a task index seen in the samples ("?" once the task is gone)
+uint8_t getSamplerTaskCount();
+const char* getSamplerTaskName(uint8_t task);
+
+#endif // SAMPLER_H
@@ -0,0 +1,105 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "profile.h"
+
+// =============================================================================
+// Cooperative fixed-rate scheduler
+// =============================================================================
+// Each module registers its handler with a period and a phase offset (ms).
+// tick() sleeps on vTaskDelayUntil() until the next scheduler tick and then
+// runs every task whose deadline has passed. Each Scheduler instance runs in
+// its own FreeRTOS task (see startTask()) so the latency-critical control
+// chain is isolated from housekeeping work. Deadlines are kept in
+// microseconds (esp_timer) so jitter and overruns can be measured precisely.
+//
+// A task that falls behind by one or more whole periods does not "catch up"
+// with a burst of runs - the skipped deadlines are counted as missed instead.
+//
+// Event sources (e.g. a UART receive callback) can call wake() to run the
+// registered wake handlers immediately instead of at the next tick.
+// =============================================================================
+
+#define SCHED_MAX_TASKS 16
+#define SCHED_MAX_WAKE_HANDLERS 4
+
+typedef void (*SchedTaskFn)();
+
+struct SchedTaskStats {
+    const char* name = "";
+    uint32_t periodMs = 0;
+    uint32_t runs = 0;
+    uint32_t overruns = 0;      // Runs that took longer than their period
+    uint32_t missed = 0;        // Deadlines skipped because the task was late
+    uint32_t lastJitterUs = 0;  // Start time minus deadline (last run)
+    uint32_t maxJitterUs = 0;
+    uint32_t lastExecUs = 0;    // Execution time (last run)
+    uint32_t maxExecUs = 0;
+};
+
+class Scheduler {
+public:
+  Scheduler(const char* name, uint32_t tickMs);
+
+  // Register a task. Its run time is also recorded in a profile zone of the
+  // same name. Returns false if the table is full.
+  bool addTask(const char* name, SchedTaskFn fn, uint32_t periodMs, uint32_t phaseMs = 0);
+
+  // Register a handler that runs (in registration order) whenever wake() is
+  // called between ticks. Handlers still run on their normal period too.
+  bool addWakeHandler(SchedTaskFn fn);
+
+  // Wake the scheduler task early (task context only, e.g. UART event callback)
+  void wake();
+
+  // Run tick() forever in a dedicated FreeRTOS task. Call after all tasks
+  // have been added.
+  void startTask(uint32_t stackSize, UBaseType_t priority, BaseType_t core);
+
+  // Sleep until the next tick, then run all due tasks
+  void tick();
+
+  // Stats access (for debug API)
+  const char* getName() const { return name; }
+  uint32_t getTickMs() const { return tickMs; }
+  uint32_t getMaxTickLateUs() const { return maxTickLateUs; }  // Worst wake-up lateness
+  uint32_t getWakeups() const { return wakeups; }
+  uint8_t getTaskCount() const { return taskCount; }
+  const SchedTaskStats& getStats(uint8_t index) const { return tasks[index].stats; }
+  void resetStats();
+
+private:
+  struct Task {
+    SchedTaskFn fn = nullptr;
+    uint32_t periodUs = 0;
+    int64_t nextDueUs = 0;
+    ProfileZone* zone = nullptr;
+    SchedTaskStats stats;
+  };
+
+  const char* name;
+  uint32_t tickMs;
+  Task tasks[SCHED_MAX_TASKS];
+  uint8_t taskCount;
+  SchedTaskFn wakeHandlers[SCHED_MAX_WAKE_HANDLERS];
+  uint8_t wakeHandlerCount;
+  bool started;
+  TickType_t lastWake;
+  int64_t nextTickUs;
+  uint32_t maxTickLateUs;
+  uint32_t wakeups;
+  TaskHandle_t taskHandle;
+
+  void start();
+  void runTask(Task& task, int64_t now);
+  static void taskEntry(void* arg);
+};
+
+// Control scheduler: sensor input -> AP -> HID output (high priority, core 1)
+extern Scheduler controlScheduler;
+
+// Housekeeping scheduler: LED, buzzer, heartbeat (low priority)
+extern Scheduler housekeepingScheduler;
+
+#endif // SCHEDULER_H
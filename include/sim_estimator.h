@@ -0,0 +1,166 @@
+#ifndef SIM_ESTIMATOR_H
+#define SIM_ESTIMATOR_H
+
+#include <stdint.h>
+#include "sim_protocol.h"
+
+// =============================================================================
+// Simulator state estimator (hardware independent)
+// =============================================================================
+// One alpha-beta tracker per channel the autopilot flies on. Each keeps a
+// value and a rate; a measurement is compared with the value predicted for
+// its time and the difference (innovation) corrects both:
+//   predicted = value + rate * dt
+//   value     = predicted + alpha * innovation
+//   rate      = rate + beta * innovation / dt
+// Between packets the estimate is extrapolated along the rate, so the
+// autopilot can run at a fixed rate whatever the bridge sends. After
+// maxPredictUs without a packet it holds still (short dropouts ride through
+// at the last trend, long ones don't run away); after resetUs the channel
+// starts over from the next measurement.
+//
+// dt comes from the messages' sim timestamps when both carry one - transport
+// jitter and bursts then don't show up as fake rate changes - else from the
+// arrival times. Heading wraps at 360.
+//
+// Pitch / roll / yaw rates for derivative action: the simulator's own body
+// rates while it sends them, else the attitude differentiated by a
+// Savitzky-Golay style least-squares fit over the last few samples. The fit
+// uses the samples' actual timestamps, so irregular packet spacing doesn't
+// turn into rate noise the way a plain difference quotient does.
+// =============================================================================
+
+#define SIM_EST_MIN_DT_US     5000  // Shorter steps (bursts without sim time) count as 5 ms
+#define SIM_DIFF_MAX_SAMPLES  16
+
+enum SimChannel : uint8_t {
+    SIM_CH_PITCH,
+    SIM_CH_ROLL,
+    SIM_CH_HEADING,
+    SIM_CH_VS,
+    SIM_CH_ALTITUDE,
+    SIM_CH_COUNT
+};
+
+// Rates of the attitude channels (pitch, roll, heading)
+enum SimRateAxis : uint8_t {
+    SIM_RATE_PITCH,
+    SIM_RATE_ROLL,
+    SIM_RATE_YAW,
+    SIM_RATE_COUNT
+};
+
+enum SimRateSource : uint8_t {
+    SIM_RATE_NONE,      // No current rate
+    SIM_RATE_MEASURED,  // Sent by the simulator
+    SIM_RATE_DERIVED    // Differentiated attitude
+};
+
+struct SimEstimatorSettings {
+    float alpha = 0.5f;
+    float beta = 0.15f;
+    uint32_t maxPredictUs = 250000;
+    uint32_t resetUs = 1000000;
+    uint8_t diffSamples = 7;   // Differentiator window (3..SIM_DIFF_MAX_SAMPLES)
+    uint8_t diffOrder = 2;     // Fitted polynomial order (1 or 2)
+};
+
+// Per channel, for diagnosis
+struct SimChannelStats {
+    bool valid = false;           // Measured since the last reset
+    float value = 0.0f;           // Estimate at the last measurement
+    float rate = 0.0f;            // Units per second
+    float innovation = 0.0f;      // Last measurement minus its prediction
+    float innovationRms = 0.0f;   // Running RMS of the innovation
+    int64_t lastUs = 0;           // Arrival of the last measurement
+    uint32_t updates = 0;
+    uint32_t resets = 0;          // Restarts after a gap longer than resetUs
+};
+
+// Per rate axis, for diagnosis
+struct SimRateStats {
+    SimRateSource source = SIM_RATE_NONE;  // What rate() returns now
+    float measured = 0.0f;      // Last simulator rate (deg/s)
+    float derived = 0.0f;       // Last differentiated rate (deg/s)
+    int64_t measuredUs = 0;     // Arrival of the last simulator rate (0 = never)
+    int64_t derivedUs = 0;      // Arrival of the last attitude sample differentiated
+};
+
+// Slope of a least-squares polynomial fit over the last n samples, at the
+// newest one (Savitzky-Golay differentiation for irregular sample times)
+class SgDifferentiator {
+public:
+  SgDifferentiator() { reset(); }
+
+  void reset();
+
+  // Add a sample taken at timeUs (must increase; a step back restarts the
+  // window). Returns true with *rate (units/s) once the window is full.
+  bool push(float value, int64_t timeUs, uint8_t samples, uint8_t order, float* rate);
+
+  void setWrap360(bool wrap) { wrap360 = wrap; }
+
+private:
+  float values[SIM_DIFF_MAX_SAMPLES];  // Unwrapped
+  int64_t times[SIM_DIFF_MAX_SAMPLES];
+  uint8_t head;
+  uint8_t count;
+  bool wrap360 = false;
+};
+
+class AlphaBetaTracker {
+public:
+  AlphaBetaTracker() { reset(); }
+
+  void reset();
+
+  // Measurement z that arrived at arrivalUs, taken at simTimeMs on the
+  // sim clock if hasTime
+  void update(float z, int64_t arrivalUs, bool hasTime, uint32_t simTimeMs,
+              const SimEstimatorSettings& settings);
+
+  // Estimate at nowUs. Returns false if never measured (or reset).
+  bool predict(int64_t nowUs, const SimEstimatorSettings& settings, float* out) const;
+
+  void setWrap360(bool wrap) { wrap360 = wrap; }
+  const SimChannelStats& getStats() const { return stats; }
+
+private:
+  SimChannelStats stats;
+  float innovationSq;  // Running mean of innovation^2
+  bool hasSimTime;     // Last measurement had a sim timestamp
+  uint32_t lastSimTimeMs;
+  bool wrap360 = false;
+};
+
+class SimEstimator {
+public:
+  SimEstimator();
+
+  void configure(const SimEstimatorSettings& s) { settings = s; }
+  void reset();
+
+  // Feed one applied simulator message (only the fields it carries)
+  void update(const SimMessage& msg, int64_t arrivalUs);
+
+  // Estimate of one channel at nowUs; false if it has no data
+  bool predict(SimChannel ch, int64_t nowUs, float* out) const;
+
+  // Rate of an attitude axis at nowUs (deg/s): the simulator's while it is
+  // current, else the derived one. Neither current (older than
+  // maxPredictUs): SIM_RATE_NONE.
+  SimRateSource rate(SimRateAxis axis, int64_t nowUs, float* out) const;
+
+  const SimChannelStats& getStats(SimChannel ch) const { return channels[ch].getStats(); }
+  SimRateStats getRateStats(SimRateAxis axis, int64_t nowUs) const;
+
+private:
+  SimEstimatorSettings settings;
+  AlphaBetaTracker channels[SIM_CH_COUNT];
+  SgDifferentiator differentiators[SIM_RATE_COUNT];
+  SimRateStats rates[SIM_RATE_COUNT];
+  int64_t diffLastUs[SIM_RATE_COUNT];  // Timestamp of the last differentiated sample
+  bool diffSimTime[SIM_RATE_COUNT];    // ... on the sim clock
+};
+
+#endif // SIM_ESTIMATOR_H
@@ -0,0 +1,50 @@
+#ifndef SIM_FEED_H
+#define SIM_FEED_H
+
+#include <Arduino.h>
+#include "sim_protocol.h"
+
+// =============================================================================
+// Simulator feed rate requests
+// =============================================================================
+// Tells the bridge which fields to send and how often, so the links carry
+// what the autopilot needs and little else:
+//   Autopilot off:  air data and attitude at SIM_FEED_MONITOR_HZ (debug page)
+//   Autopilot on:   the fields the active modes use (and pitch / roll rates)
+//                   at SIM_FEED_AP_HZ, the rest at SIM_FEED_MONITOR_HZ
+// Requests (SIM_REQUEST_PREFIX lines, sim_protocol.h) go to the port the
+// data arrives on, or to every port until one has delivered. A bridge acks
+// with "ack":<id> in its JSON. Without an ack after SIM_FEED_RETRIES sends
+// the bridge counts as ignoring requests: nothing else changes - whatever
+// it sends at whatever rate is used as before - and the request is repeated
+// every SIM_FEED_IGNORED_RETRY_MS in case a newer bridge takes over.
+// X-Plane gets the same rates through its RREF subscription instead.
+// =============================================================================
+
+enum SimFeedStatus : uint8_t {
+    SIM_FEED_OFF,       // SIM_FEED_REQUESTS disabled
+    SIM_FEED_PENDING,   // Sent, no ack yet
+    SIM_FEED_ACKED,     // Bridge follows the current request
+    SIM_FEED_IGNORED,   // No ack - bridge keeps its own rate
+    SIM_FEED_XPLANE     // X-Plane feed: rates set through the RREF subscription
+};
+
+struct SimFeedStats {
+    SimFeedStatus status = SIM_FEED_OFF;
+    SimFeedRequest request;     // Current request
+    uint32_t id = 0;            // ... and its id
+    uint32_t requestsSent = 0;
+    uint32_t acks = 0;          // Requests acknowledged
+};
+
+void initSimFeed();
+
+// Housekeeping task: follow the autopilot modes, (re)send requests
+void handleSimFeed();
+
+// A bridge acknowledged request id (control task)
+void simFeedAcked(uint32_t id);
+
+SimFeedStats getSimFeedStats();
+
+#endif // SIM_FEED_H
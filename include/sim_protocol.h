@@ -0,0 +1,182 @@
+#ifndef SIM_PROTOCOL_H
+#define SIM_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// Simulator message parser (hardware independent)
+// =============================================================================
+// Two message formats are accepted on the same byte stream, auto-detected:
+//
+// JSON line:  {"spd":85,"alt":2500,"pitch":2.5,"roll":-1,"hdg":270,"vs":0}\n
+//             All keys optional, unknown keys skipped. Parsed in place by a
+//             single forward scan - no document object, no allocation.
+//             Optional "seq" (sequence number) and "t" (sim time, ms) keys
+//             enable the same checks as binary messages. Body rates
+//             "prate", "rrate", "yrate" (deg/s, signs as pitch / roll /
+//             heading) are optional too.
+//
+// Binary:     0x00 | COBS(payload) | 0x00, payload (36 bytes, LE):
+//               0      type (SIM_BINARY_TYPE_STATE)
+//               1      field mask (SIM_FIELD_*: which values are valid)
+//               2-5    sequence number
+//               6-9    sim timestamp (ms, sender's clock)
+//               10-33  float32 spd, alt, pitch, roll, hdg, vs
+//               34-35  CRC-16/CCITT-FALSE of bytes 0-33
+//             or with body rates (49 bytes, type SIM_BINARY_TYPE_RATES):
+//               0      type
+//               1-2    field mask (16 bit)
+//               3-6    sequence number
+//               7-10   sim timestamp
+//               11-46  float32 spd, alt, pitch, roll, hdg, vs, prate, rrate, yrate
+//               47-48  CRC-16/CCITT-FALSE of bytes 0-46
+//
+// A 0x00 byte switches to binary framing; a frame starting with '{' switches
+// back to JSON lines. (A COBS frame this short never starts with '{'.)
+// Sequence numbers are checked like cyclic v2 frames: gaps count as lost,
+// repeated or older messages are counted and dropped.
+//
+// Datagram transports (UDP) carry one message per datagram: JSON text or the
+// bare binary payload - the datagram is the frame, so no COBS.
+//
+// Feed requests (firmware -> bridge, sim_feed.h) are text lines on the same
+// link's TX side, prefixed so they stand apart from the log output sharing
+// UART0:
+//   @SIMREQ {"id":7,"hz":50,"fields":["spd","pitch","roll"],"otherHz":5}\n
+// A bridge that follows a request adds "ack":<id> to its JSON messages.
+// =============================================================================
+
+#define SIM_FRAME_MAX          256   // Longest JSON line / encoded binary frame
+#define SIM_BINARY_TYPE_STATE  0x01
+#define SIM_BINARY_TYPE_RATES  0x02
+#define SIM_BINARY_STATE_SIZE  36
+#define SIM_BINARY_RATES_SIZE  49
+#define SIM_SEQ_RESYNC         4     // Older messages in a row = sender restarted
+#define SIM_REQUEST_PREFIX     "@SIMREQ "
+#define SIM_REQUEST_MAX        128   // Longest feed request line, newline included
+
+enum SimField : uint16_t {
+    SIM_FIELD_SPEED      = 1 << 0,
+    SIM_FIELD_ALTITUDE   = 1 << 1,
+    SIM_FIELD_PITCH      = 1 << 2,
+    SIM_FIELD_ROLL       = 1 << 3,
+    SIM_FIELD_HEADING    = 1 << 4,
+    SIM_FIELD_VS         = 1 << 5,
+    SIM_FIELD_PITCH_RATE = 1 << 6,
+    SIM_FIELD_ROLL_RATE  = 1 << 7,
+    SIM_FIELD_YAW_RATE   = 1 << 8
+};
+#define SIM_FIELD_STATE  0x003F  // Air data and attitude (binary type 1)
+#define SIM_FIELD_RATES  0x01C0  // Body rates
+#define SIM_FIELD_ALL    0x01FF
+
+struct SimMessage {
+    uint16_t fields = 0;  // SIM_FIELD_* present in this message
+    float speed = 0.0f;
+    float altitude = 0.0f;
+    float pitch = 0.0f;
+    float roll = 0.0f;
+    float heading = 0.0f;
+    float verticalSpeed = 0.0f;
+    float pitchRate = 0.0f;  // deg/s
+    float rollRate = 0.0f;
+    float yawRate = 0.0f;
+    bool binary = false;
+    bool hasSeq = false;     // Always for binary, JSON with "seq"
+    bool hasTime = false;    // Always for binary, JSON with "t"
+    bool hasAck = false;     // JSON with "ack"
+    uint32_t seq = 0;
+    uint32_t simTimeMs = 0;  // Sender's sim clock
+    uint32_t ack = 0;        // Id of the feed request the sender follows
+};
+
+// What the firmware asks the bridge to send
+struct SimFeedRequest {
+    uint16_t fields = SIM_FIELD_STATE;  // SIM_FIELD_* wanted at hz
+    uint16_t hz = 0;
+    uint16_t otherHz = 0;            // All other fields (0 = not needed)
+};
+
+// What push() did with a byte
+enum SimEvent : uint8_t {
+    SIM_EVENT_NONE,         // Consumed, nothing complete yet
+    SIM_EVENT_MESSAGE,      // *msg holds a new message
+    SIM_EVENT_PARSE_ERROR,  // Complete line / frame that could not be decoded
+    SIM_EVENT_CRC_ERROR,    // Binary frame with a bad CRC
+    SIM_EVENT_OVERFLOW      // Line / frame too long, dropped up to its terminator
+};
+
+struct SimParserStats {
+    uint32_t jsonMessages = 0;
+    uint32_t binaryMessages = 0;
+    uint32_t discardedBytes = 0;  // Overflowed lines, partial frames cut by a new one
+    uint32_t lost = 0;            // Sequence gaps
+    uint32_t duplicates = 0;      // Messages with the previous sequence number
+    uint32_t reordered = 0;       // Messages older than the previous one
+};
+
+// Sequence number check, shared by the stream parser and datagram receivers
+class SimSeqTracker {
+public:
+  SimSeqTracker() { reset(); }
+
+  void reset();
+
+  // False for duplicate and stale messages; gaps are counted as lost
+  bool accept(uint32_t seq, SimParserStats& stats);
+
+private:
+  bool haveSeq;
+  uint32_t lastSeq;
+  uint8_t olderInRow;
+};
+
+class SimParser {
+public:
+  SimParser();
+
+  void reset();
+
+  // Feed one received byte
+  SimEvent push(uint8_t c, SimMessage* msg);
+
+  const SimParserStats& getStats() const { return stats; }
+
+private:
+  uint8_t buf[SIM_FRAME_MAX];
+  size_t len;
+  bool binaryMode;
+  bool discarding;     // Dropping the rest of an overlong line / frame
+  SimSeqTracker seq;
+  SimParserStats stats;
+
+  SimEvent overflow();
+  SimEvent finishLine(SimMessage* msg);
+  SimEvent finishFrame(SimMessage* msg);
+  SimEvent accepted(SimMessage* msg);
+};
+
+// Parse one JSON message (no terminator needed, len bytes). Returns false on
+// a syntax error; known keys with values of the wrong type (or "seq" / "t"
+// not an unsigned 32-bit integer) are ignored.
+bool parseSimJson(const char* text, size_t len, SimMessage* msg);
+
+// Decode a bare binary payload (COBS already removed)
+SimEvent decodeSimBinary(const uint8_t* payload, size_t len, SimMessage* msg);
+
+// Decode one datagram: JSON text or a bare binary payload. Returns
+// SIM_EVENT_MESSAGE, SIM_EVENT_PARSE_ERROR or SIM_EVENT_CRC_ERROR; sequence
+// numbers are left to the caller.
+SimEvent decodeSimDatagram(const uint8_t* data, size_t len, SimMessage* msg);
+
+// Encode a binary state message into out (at least SIM_BINARY_RATES_SIZE + 3
+// bytes, delimiters included) - type 2 if it carries rates, else type 1.
+// Returns the frame length. For senders and tests; the firmware only decodes.
+size_t encodeSimBinary(const SimMessage& msg, uint8_t* out);
+
+// Format a feed request line (SIM_REQUEST_PREFIX ... \n) into out. Returns
+// its length, or 0 if it does not fit.
+size_t formatSimRequest(const SimFeedRequest& req, uint32_t id, char* out, size_t size);
+
+#endif // SIM_PROTOCOL_H
@@ -0,0 +1,59 @@
+#ifndef SIM_UDP_H
+#define SIM_UDP_H
+
+#include <Arduino.h>
+#include "sim_protocol.h"
+#include "simulator_serial.h"
+
+// =============================================================================
+// Simulator messages over WiFi (UDP)
+// =============================================================================
+// One message per datagram on SIM_UDP_PORT: a JSON object or a bare binary
+// state payload (sim_protocol.h). Datagrams are parsed in lwIP's tcpip task
+// straight out of the receive pbuf - no socket, no copy - and sequence
+// numbers are checked there, so reordered and stale datagrams never reach
+// the control task. Accepted messages wait in a small mailbox that
+// handleSimulatorSerial() drains.
+//
+// X-Plane (XPLANE_ENABLED): a second socket subscribes to X-Plane's own RREF
+// datarefs (xplane_rref.h) and feeds the decoded replies into the same
+// mailbox - no PC-side bridge. Subscriptions are sent again whenever no
+// reply has arrived for XPLANE_TIMEOUT_MS (sim restarted, WiFi dropped),
+// and whenever the feed rates change (sim_feed.h).
+// =============================================================================
+
+struct XPlaneStats {
+    bool enabled = false;
+    bool connected = false;     // Replies within XPLANE_TIMEOUT_MS
+    uint32_t subscriptions = 0; // Subscription rounds sent
+    uint32_t sendErrors = 0;
+    uint32_t replies = 0;
+};
+
+// Bind the UDP ports (after WiFi is started; no-op when WiFi is disabled)
+void initSimulatorUdp();
+
+// Housekeeping task: (re)subscribe to X-Plane while it isn't replying
+void handleXPlane();
+
+// Per-dataref X-Plane rates from a feed request (housekeeping task). The
+// subscription is renewed on the next handleXPlane() if they changed.
+void setXPlaneRates(const SimFeedRequest& req);
+
+// Send a datagram to the bridge that last sent us one. False before any
+// bridge has been heard from, or when the send fails.
+bool sendSimulatorUdp(const char* data, size_t len);
+
+// Next received message, its arrival time and source (control task). False
+// when the mailbox is empty.
+bool pollSimulatorUdp(SimMessage* msg, int64_t* arrivalUs, SimulatorPort* port);
+
+// Decoder counters (JSON / binary messages, lost / duplicate / reordered)
+SimParserStats getSimulatorUdpStats();
+
+// Datagrams dropped because the control task had not emptied the mailbox
+uint32_t getSimulatorUdpMailboxDrops();
+
+XPlaneStats getXPlaneStats();
+
+#endif // SIM_UDP_H
@@ -2,15 +2,63 @@
 #define SIMULATOR_SERIAL_H
 
 #include <Arduino.h>
+#include "sim_protocol.h"
+#include "sim_estimator.h"
+#include "profile.h"
 
-// Initialize simulator serial receiver
+// Port the simulator data currently arrives on
+enum SimulatorPort {
+    SIM_PORT_NONE,  // Nothing received yet
+    SIM_PORT_USB,   // USB CDC channel (composite with the HID joystick)
+    SIM_PORT_UART,  // UART0 via the CH340 (fallback)
+    SIM_PORT_UDP,   // UDP over WiFi
+    SIM_PORT_XPLANE,  // X-Plane RREF datarefs over WiFi
+    SIM_PORT_COUNT
+};
+
+// Per-source receive statistics, to compare the transports
+struct SimSourceStats {
+    int64_t ageUs = -1;     // Since the last message (-1 = never)
+    uint32_t applied = 0;   // Messages that updated state.simulator
+    uint32_t dropped = 0;   // Older sim time than already applied / another source active
+    ProfileSummary lag;     // Same sim time arrived this much later than via the leading source (us)
+};
+
+// Initialize simulator serial receiver (USB CDC + UART fallback). UDP is
+// started separately once WiFi is up (sim_udp.h).
 void initSimulatorSerial();
 
-// Process incoming serial data (call from main loop)
+// Process incoming serial data and queued UDP messages (control task)
 void handleSimulatorSerial();
 
+SimulatorPort getSimulatorPort();
+
+// Simulator channel extrapolated to nowUs (sim_estimator.h). False while the
+// channel has no data. Control task.
+bool estimateSimulator(SimChannel ch, int64_t nowUs, float* out);
+
+// Innovation and staleness of a channel's estimator, for diagnosis
+SimChannelStats getSimChannelStats(SimChannel ch);
+
+// Pitch / roll / yaw rate at nowUs (deg/s): the simulator's own, else the
+// differentiated attitude. SIM_RATE_NONE while neither is current.
+SimRateSource estimateSimulatorRate(SimRateAxis axis, int64_t nowUs, float* out);
+SimRateStats getSimRateStats(SimRateAxis axis, int64_t nowUs);
+
+// Send a text line back to the bridge on port (USB, UART or UDP); to all of
+// them for SIM_PORT_NONE. Used for feed requests (sim_feed.h). The UART
+// line goes through the logger (UART0 also carries the log).
+void sendSimulatorLine(SimulatorPort port, const char* line, size_t len);
+
+SimSourceStats getSimSourceStats(SimulatorPort port);
+void resetSimSourceStats();
+
+// Message counters of all sources' parsers, summed
+SimParserStats getSimParserStats();
+
 /*
- * JSON protocol: newline-separated messages (\n)
+ * JSON protocol: newline-separated messages (\n), on the USB CDC port or UART0
+ * (one message per datagram over UDP)
  * Each message updates state.simulator. Partial updates supported.
  *
  * Field names (all optional):
@@ -22,6 +70,13 @@ void handleSimulatorSerial();
  *   vs    - vertical speed (ft/min or m/s)
  *
  * Example: {"spd":85,"alt":2500,"pitch":2.5,"roll":-1,"hdg":270,"vs":0}\n
+ *
+ * Binary alternative: the same fields as a COBS frame between 0x00 bytes,
+ * plus a sequence number and sim timestamp (layout in sim_protocol.h).
+ * Detected automatically; a sender may switch formats at any time.
+ *
+ * Optional:
+ *   ack   - id of the last feed request (@SIMREQ line) the bridge follows
  */
 
 #endif // SIMULATOR_SERIAL_H
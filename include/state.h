@@ -2,6 +2,8 @@
 #define STATE_H
 
 #include <Arduino.h>
+#include "axis_filter.h"
+#include "response_curve.h"
 
 // =============================================================================
 // Application State - Autopilot & Monitoring
@@ -64,8 +66,9 @@ struct AutopilotState {
 
 struct SimulatorState {
     bool valid = false;           // Have we received data recently?
-    bool dataUpdated = false;     // Flag set to true when new data arrives, must be reset by consumer
     unsigned long lastUpdateMs = 0;  // Timestamp of last update
+    int64_t lastUpdateUs = 0;     // esp_timer time of last update (latency tracing)
+    uint32_t simTimeMs = 0;       // Sim clock of the last binary message (0 = JSON only)
 
     float speed = 0.0f;           // knots or m/s
     float altitude = 0.0f;        // feet or meters
@@ -96,6 +99,10 @@ struct SensorState {
     int16_t collectiveCalibrated = 5000;
 
     bool cyclicValid = false;  // Is cyclic serial data current?
+
+    // Adaptive filter tuning (calibrated values above are filtered)
+    AxisFilterSettings cyclicFilter;      // Shared by X and Y
+    AxisFilterSettings collectiveFilter;
 };
 
 // -----------------------------------------------------------------------------
@@ -110,6 +117,11 @@ struct JoystickState {
     int16_t collective = 5000;  // Not controlled by AP - always from sensors
 
     uint32_t buttons = 0;    // Bitmask for 32 buttons
+
+    // Response curves for the pilot's input (not applied to AP output)
+    ResponseCurveSettings cyclicXCurve;
+    ResponseCurveSettings cyclicYCurve;
+    ResponseCurveSettings collectiveCurve;
 };
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,54 @@
+#ifndef XPLANE_RREF_H
+#define XPLANE_RREF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sim_protocol.h"
+
+// =============================================================================
+// X-Plane RREF dataref protocol (hardware independent)
+// =============================================================================
+// Subscription (to X-Plane's UDP port, 413 bytes):
+//   "RREF\0" | frequency int32 LE (Hz, 0 = unsubscribe) | index int32 LE |
+//   dataref path, NUL padded to 400 bytes
+//
+// Reply (to the port the subscription came from), sent at the frequency:
+//   "RREF" + one byte (',' or '\0') | n x (index int32 LE | value float LE)
+// One reply carries every subscribed dataref that is due.
+//
+// The index we subscribe with is the XPlaneDataref value, so replies map
+// straight back to SimMessage fields. Values are passed on in X-Plane's own
+// units and signs; the receiver applies its conventions.
+// =============================================================================
+
+#define XPLANE_RREF_REQUEST_SIZE  413
+#define XPLANE_RREF_PATH_SIZE     400
+#define XPLANE_RREF_HEADER_SIZE   5
+#define XPLANE_RREF_PAIR_SIZE     8
+
+enum XPlaneDataref : uint8_t {
+    XPLANE_REF_SPEED,     // Indicated airspeed, knots
+    XPLANE_REF_ALTITUDE,  // Indicated altitude, feet
+    XPLANE_REF_PITCH,     // theta, degrees, positive nose up
+    XPLANE_REF_ROLL,      // phi, degrees, positive right wing down
+    XPLANE_REF_HEADING,   // Magnetic heading, degrees
+    XPLANE_REF_VS,        // Vertical speed, ft/min
+    XPLANE_REF_PITCH_RATE,  // Q, deg/s, positive nose up
+    XPLANE_REF_ROLL_RATE,   // P, deg/s, positive rolling right
+    XPLANE_REF_YAW_RATE,    // R, deg/s, positive yawing right
+    XPLANE_REF_TIME,      // Sim running time, seconds (-> SimMessage::simTimeMs)
+    XPLANE_REF_COUNT
+};
+
+extern const char* const xplaneDatarefPaths[XPLANE_REF_COUNT];
+
+// Build the subscription for one dataref into out (XPLANE_RREF_REQUEST_SIZE
+// bytes). Returns the request length.
+size_t buildXPlaneRrefRequest(XPlaneDataref ref, uint32_t freqHz, uint8_t* out);
+
+// Decode a reply. Fills the fields present (and hasTime for the running
+// time); unknown indexes are skipped. False if the packet is not an RREF
+// reply.
+bool decodeXPlaneRref(const uint8_t* data, size_t len, SimMessage* msg);
+
+#endif // XPLANE_RREF_H
@@ -3,8 +3,14 @@
 #include "state.h"
 #include "logger.h"
 #include "joystick.h"
-#include <PID_v1.h>
+#include "pid_controller.h"
 #include "buzzer.h"
+#include "profile.h"
+#include "simulator_serial.h"
+#include <esp_timer.h>
+
+#define AP_DT  (1.0f / AP_LOOP_HZ)  // Nominal loop period (s)
+#define AP_STICK_RANGE  ((float)(AXIS_MAX - AXIS_CENTER))  // Max stick offset from center
 
 static bool isSimulatorDataValid() {
     if (state.simulator.lastUpdateMs == 0) {
@@ -23,25 +29,19 @@ bool canAutopilotBeOn() {
     return true;
 }
 
-// PID for pitch hold: setpoint=selectedPitch, input=actual pitch, output=cyclic Y offset
-static double pitchInput = 0;
-static double pitchOutput = 0;
-static double pitchSetpoint = 0;
-static PID pitchPid(&pitchInput, &pitchOutput, &pitchSetpoint,
-                    AP_PITCH_KP, AP_PITCH_KI, AP_PITCH_KD, REVERSE);  // REVERSE mode was working correctly
-
-// PID for roll hold: setpoint=selectedRoll, input=actual roll, output=cyclic X offset
-static double rollInput = 0;
-static double rollOutput = 0;
-static double rollSetpoint = 0;
-static PID rollPid(&rollInput, &rollOutput, &rollSetpoint,
-                   AP_ROLL_KP, AP_ROLL_KI, AP_ROLL_KD, REVERSE);  // REVERSE mode was working correctly
+// Inner loops: attitude -> cyclic offset from center. Reverse acting (the
+// stick moves with measurement - setpoint), as the loops always were. D comes
+// from the simulator's rate, else the derived one (estimateSimulatorRate).
+static PidController<float> pitchPid;
+static PidController<float> rollPid;
 
-// Vertical speed (Outer loop) state
-static double vsIntegral = 0;
+// Outer loops: heading error -> roll target (P), vertical speed -> pitch
+// target (PI), altitude -> VS target (P)
+static PidController<float> headingPid;
+static PidController<float> vsPid;
+static PidController<float> altPid;
 
-// Heading hold: smoothed roll command (rate-limited to avoid kick on heading change)
-static float smoothedHeadingRoll = 0.0f;
+static int64_t lastRunUs = 0;
 
 void initAP() {
     state.autopilot.enabled = false;
@@ -58,22 +58,54 @@ void initAP() {
     state.autopilot.headingKp = AP_HEADING_KP;
     state.autopilot.vsKp = AP_VS_KP;
 
-    pitchPid.SetTunings(state.autopilot.pitchKp, state.autopilot.pitchKi, state.autopilot.pitchKd);
-    pitchPid.SetOutputLimits(-5000, 5000);
-    pitchPid.SetSampleTime(0);
-    pitchPid.SetMode(0); // Start in MANUAL
-
-    rollPid.SetTunings(state.autopilot.rollKp, state.autopilot.rollKi, state.autopilot.rollKd);
-    rollPid.SetOutputLimits(-5000, 5000);
-    rollPid.SetSampleTime(0);
-    rollPid.SetMode(0); // Start in MANUAL
+    PidSettings<float> stick;
+    stick.outputMin = -AP_STICK_RANGE;
+    stick.outputMax = AP_STICK_RANGE;
+    stick.derivativeFilterS = AP_PID_D_FILTER_S;
+    stick.trackingS = AP_PID_TRACKING_S;
+    stick.outputRateLimit = AP_STICK_RATE_LIMIT;
+    stick.reverse = true;
+    pitchPid.configure(stick);
+    rollPid.configure(stick);
+
+    PidSettings<float> heading;
+    heading.outputMin = -AP_MAX_BANK_ANGLE;
+    heading.outputMax = AP_MAX_BANK_ANGLE;
+    heading.reverse = true;
+    headingPid.configure(heading);
+
+    PidSettings<float> vs;
+    vs.ki = AP_VS_KI;
+    vs.outputMin = -AP_MAX_PITCH_ANGLE;
+    vs.outputMax = AP_MAX_PITCH_ANGLE;
+    vs.trackingS = AP_PID_TRACKING_S;
+    vs.reverse = true;
+    vsPid.configure(vs);
+
+    PidSettings<float> alt;
+    alt.kp = AP_ALTS_GAIN;
+    alt.outputMin = -AP_ALTS_MAX_VS;
+    alt.outputMax = AP_ALTS_MAX_VS;
+    altPid.configure(alt);
+
+    syncAPPidTunings();
 
     LOG_INFO("Autopilot module initialized");
 }
 
 void syncAPPidTunings() {
-    pitchPid.SetTunings(state.autopilot.pitchKp, state.autopilot.pitchKi, state.autopilot.pitchKd);
-    rollPid.SetTunings(state.autopilot.rollKp, state.autopilot.rollKi, state.autopilot.rollKd);
+    pitchPid.setTunings(state.autopilot.pitchKp, state.autopilot.pitchKi, state.autopilot.pitchKd);
+    rollPid.setTunings(state.autopilot.rollKp, state.autopilot.rollKi, state.autopilot.rollKd);
+    headingPid.setTunings(state.autopilot.headingKp, 0.0f, 0.0f);
+    vsPid.setTunings(state.autopilot.vsKp, AP_VS_KI, 0.0f);
+}
+
+static void stopAllLoops() {
+    pitchPid.stop();
+    rollPid.stop();
+    headingPid.stop();
+    vsPid.stop();
+    altPid.stop();
 }
 
 void setAPEnabled(bool enabled) {
@@ -108,19 +140,17 @@ void setAPEnabled(bool enabled) {
             state.autopilot.selectedPitch = 0.0f;
         }
 
-        // Initialize PID outputs to current physical stick positions for "bumpless" transfer
+        // Start the inner loops at the current physical stick positions for "bumpless" transfer
         // This prevents the "kick" when AP first takes over
-        pitchOutput = (double)(state.joystick.cyclicY - AXIS_CENTER);
-        rollOutput = (double)(state.joystick.cyclicX - AXIS_CENTER);
-
-        pitchPid.SetMode(1);  // 1=AUTOMATIC - library will re-init I-term based on current Input/Setpoint/Output
-        rollPid.SetMode(1);
+        pitchPid.start(state.autopilot.selectedPitch, state.simulator.pitch,
+                       (float)(state.joystick.cyclicY - AXIS_CENTER));
+        rollPid.start(state.autopilot.selectedRoll, state.simulator.roll,
+                      (float)(state.joystick.cyclicX - AXIS_CENTER));
         LOG_INFO("Autopilot ON (RollHold + PitchHold)");
     } else {
         state.autopilot.horizontalMode = APHorizontalMode::Off;
         state.autopilot.verticalMode = APVerticalMode::Off;
-        pitchPid.SetMode(0);  // 0=MANUAL
-        rollPid.SetMode(0);
+        stopAllLoops();
         LOG_INFO("Autopilot OFF");
     }
 }
@@ -151,28 +181,54 @@ void setAPVerticalMode(APVerticalMode mode) {
         }
     } else if (mode == APVerticalMode::VerticalSpeed) {
         state.autopilot.hasSelectedVerticalSpeed = true;
-        // Initialize integrator to current pitch to prevent falling to 0.0 on engagement
-        // Note: Seeding math assumes current error is 0, so pitch/KI = integral
+        // Start the VS loop at the current pitch to prevent falling to 0.0 on engagement
+        // (otherwise handleAP starts it from the selected pitch)
         if (state.simulator.valid) {
-            vsIntegral = state.simulator.pitch / AP_VS_KI; 
             state.autopilot.selectedVerticalSpeed = state.simulator.verticalSpeed;
+            vsPid.start(state.simulator.verticalSpeed, state.simulator.verticalSpeed, state.simulator.pitch);
         } else {
-            vsIntegral = 0;
+            vsPid.stop();
         }
     }
 }
 
-void handleAP() {
-    bool newData = state.simulator.dataUpdated;
-    state.simulator.dataUpdated = false;
+// Simulator channel for this loop run: the estimate, or the last received
+// value while the channel has no data
+static float simValue(SimChannel ch, int64_t nowUs, float raw) {
+    float value;
+    return estimateSimulator(ch, nowUs, &value) ? value : raw;
+}
 
+// Time since the last run. The first run after engaging, or one after a
+// stall, counts as one nominal period.
+static float loopDt(int64_t nowUs) {
+    float dt = (nowUs - lastRunUs) * 1e-6f;
+    lastRunUs = nowUs;
+    if (dt <= 0.0f || dt > 4.0f * AP_DT) {
+        return AP_DT;
+    }
+    return dt;
+}
+
+// Inner loop step: D from the axis rate while there is one, else from the
+// difference of the (estimated) attitude
+static float computeAttitude(PidController<float>& pid, SimRateAxis axis, float setpoint,
+                             float measurement, int64_t nowUs, float dt) {
+    float rate;
+    if (estimateSimulatorRate(axis, nowUs, &rate) != SIM_RATE_NONE) {
+        return pid.compute(setpoint, measurement, rate, dt);
+    }
+    return pid.compute(setpoint, measurement, dt);
+}
+
+// Runs at AP_LOOP_HZ whether or not a packet arrived since the last run
+void handleAP() {
     // 1. Safety check: Turn AP OFF if conditions lost
     if (state.autopilot.enabled && !canAutopilotBeOn()) {
         state.autopilot.enabled = false;
         state.autopilot.horizontalMode = APHorizontalMode::Off;
         state.autopilot.verticalMode = APVerticalMode::Off;
-        pitchPid.SetMode(0);  // 0=MANUAL
-        rollPid.SetMode(0);
+        stopAllLoops();
         tripleBeep(100, 50);  // Alert pilot of safety disconnect
         LOG_WARN("Autopilot OFF (simulator data lost or speed too low)");
     }
@@ -181,113 +237,117 @@ void handleAP() {
         return;
     }
 
+    int64_t nowUs = esp_timer_get_time();
+    float dt = loopDt(nowUs);
+    float simPitch = simValue(SIM_CH_PITCH, nowUs, state.simulator.pitch);
+    float simRoll = simValue(SIM_CH_ROLL, nowUs, state.simulator.roll);
+    float simHeading = simValue(SIM_CH_HEADING, nowUs, state.simulator.heading);
+    float simVs = simValue(SIM_CH_VS, nowUs, state.simulator.verticalSpeed);
+    float simAltitude = simValue(SIM_CH_ALTITUDE, nowUs, state.simulator.altitude);
+
     // 2. Vertical: pitch hold, vertical speed, or altitude hold via PID
     if (state.autopilot.verticalMode == APVerticalMode::PitchHold ||
         state.autopilot.verticalMode == APVerticalMode::VerticalSpeed ||
         state.autopilot.verticalMode == APVerticalMode::AltitudeHold) {
-        if (newData) {
-            pitchPid.SetTunings(state.autopilot.pitchKp, state.autopilot.pitchKi, state.autopilot.pitchKd);
-            
-            // Handle VS and AltitudeHold (Cascaded control: Alt -> VS -> Pitch)
-            if (state.autopilot.verticalMode == APVerticalMode::VerticalSpeed ||
-                state.autopilot.verticalMode == APVerticalMode::AltitudeHold) 
-            {
-                float targetVS = 0;
-                if (state.autopilot.verticalMode == APVerticalMode::VerticalSpeed) {
-                    targetVS = state.autopilot.selectedVerticalSpeed;
-                } else {
-                    // Altitude Hold: Outer loop (Altitude -> VS)
-                    float altError = state.autopilot.capturedAltitude - state.simulator.altitude;
-                    targetVS = altError * AP_ALTS_GAIN;
-                    if (targetVS > AP_ALTS_MAX_VS) targetVS = AP_ALTS_MAX_VS;
-                    if (targetVS < -AP_ALTS_MAX_VS) targetVS = -AP_ALTS_MAX_VS;
+        syncAPPidTunings();
+
+        // Handle VS and AltitudeHold (Cascaded control: Alt -> VS -> Pitch)
+        if (state.autopilot.verticalMode == APVerticalMode::VerticalSpeed ||
+            state.autopilot.verticalMode == APVerticalMode::AltitudeHold) 
+        {
+            float targetVS = 0;
+            if (state.autopilot.verticalMode == APVerticalMode::VerticalSpeed) {
+                targetVS = state.autopilot.selectedVerticalSpeed;
+                altPid.stop();
+            } else {
+                // Altitude Hold: Outer loop (Altitude -> VS, P, limited to AP_ALTS_MAX_VS)
+                if (!altPid.isActive()) {
+                    altPid.start(state.autopilot.capturedAltitude, simAltitude, 0.0f);
                 }
+                targetVS = altPid.compute(state.autopilot.capturedAltitude, simAltitude, dt);
+            }
 
-                // Inner VS-to-Pitch PI Control
-                // Sign Convention: Positive Pitch = Nose DOWN.
-                // If actual VS (climbing) > target VS, error is positive -> Commands +Pitch (Nose DOWN).
-                float vsError = state.simulator.verticalSpeed - targetVS;
-                float requestedPitch = vsError * state.autopilot.vsKp;
-                vsIntegral += vsError;
-
-                // Anti-windup (limit I-term contribution)
-                float maxIContribution = AP_MAX_PITCH_ANGLE * 0.8f; // Limit I to 80% of max throw
-                if (vsIntegral * AP_VS_KI > maxIContribution) vsIntegral = maxIContribution / AP_VS_KI;
-                if (vsIntegral * AP_VS_KI < -maxIContribution) vsIntegral = -maxIContribution / AP_VS_KI;
-
-                requestedPitch += (vsIntegral * AP_VS_KI);
-
-                // Clamp final target pitch to safe limits
-                if (requestedPitch > AP_MAX_PITCH_ANGLE) requestedPitch = AP_MAX_PITCH_ANGLE;
-                if (requestedPitch < -AP_MAX_PITCH_ANGLE) requestedPitch = -AP_MAX_PITCH_ANGLE;
-
-                // Simple smoothing
-                state.autopilot.selectedPitch = (state.autopilot.selectedPitch * 0.9f) + (requestedPitch * 0.1f);
+            // Inner VS-to-Pitch PI Control
+            // Sign Convention: Positive Pitch = Nose DOWN.
+            // If actual VS (climbing) > target VS, error is positive -> Commands +Pitch (Nose DOWN).
+            // Limited to AP_MAX_PITCH_ANGLE; the integrator backs off while the
+            // target pitch is at the limit (anti-windup)
+            if (!vsPid.isActive()) {
+                vsPid.start(targetVS, simVs, state.autopilot.selectedPitch);
             }
+            float requestedPitch = vsPid.compute(targetVS, simVs, dt);
 
-            // --- ALTS Capture Logic (Monitor when armed) ---
-            if (state.autopilot.altHoldArmed) {
-                float altDiff = fabsf(state.simulator.altitude - state.autopilot.selectedAltitude);
-                if (altDiff < AP_ALT_CAPTURE_WINDOW) {
-                    LOG_INFO("ALTS CAPTURE: Switching to Altitude Hold");
-                    state.autopilot.verticalMode = APVerticalMode::AltitudeHold;
-                    state.autopilot.altHoldArmed = false;
-                    state.autopilot.capturedAltitude = state.autopilot.selectedAltitude;
-                    // Note: vsIntegral is already active from current mode, 
-                    // which provides a smooth transition
-                }
+            // Simple smoothing (first-order low-pass, AP_VS_PITCH_SMOOTHING_S)
+            float smoothing = 1.0f - expf(-dt / AP_VS_PITCH_SMOOTHING_S);
+            state.autopilot.selectedPitch += (requestedPitch - state.autopilot.selectedPitch) * smoothing;
+        } else {
+            vsPid.stop();
+            altPid.stop();
+        }
+
+        // --- ALTS Capture Logic (Monitor when armed) ---
+        if (state.autopilot.altHoldArmed) {
+            float altDiff = fabsf(simAltitude - state.autopilot.selectedAltitude);
+            if (altDiff < AP_ALT_CAPTURE_WINDOW) {
+                LOG_INFO("ALTS CAPTURE: Switching to Altitude Hold");
+                state.autopilot.verticalMode = APVerticalMode::AltitudeHold;
+                state.autopilot.altHoldArmed = false;
+                state.autopilot.capturedAltitude = state.autopilot.selectedAltitude;
+                // Note: the VS loop is already running in VS mode and keeps
+                // its integrator, which provides a smooth transition
             }
+        }
 
-            pitchSetpoint = state.autopilot.selectedPitch;
-            pitchInput = state.simulator.pitch;
-            pitchPid.Compute();
+        float pitchCommand;
+        {
+            PROFILE_ZONE("ap.pitchPid");
+            pitchCommand = computeAttitude(pitchPid, SIM_RATE_PITCH, state.autopilot.selectedPitch,
+                                           simPitch, nowUs, dt);
         }
 
-        int16_t cyclicY = (int16_t)(AXIS_CENTER + pitchOutput);
+        int16_t cyclicY = (int16_t)(AXIS_CENTER + pitchCommand);
         if (cyclicY < AXIS_MIN) cyclicY = AXIS_MIN;
         if (cyclicY > AXIS_MAX) cyclicY = AXIS_MAX;
-        setJoystickAxis(AXIS_CYCLIC_Y, cyclicY);
+        setJoystickAxis(AXIS_CYCLIC_Y, cyclicY, SOURCE_AUTOPILOT, state.simulator.lastUpdateUs);
     }
 
     // 3. Horizontal: roll hold or heading hold
     if (state.autopilot.horizontalMode == APHorizontalMode::RollHold || 
         state.autopilot.horizontalMode == APHorizontalMode::HeadingHold) {
-        
-        if (newData) {
-            float targetRoll = state.autopilot.selectedRoll;
-
-            if (state.autopilot.horizontalMode == APHorizontalMode::HeadingHold) {
-                // Outer Loop: Heading -> Target Roll
-                float headingError = state.simulator.heading - state.autopilot.selectedHeading;
-                while (headingError > 180.0f) headingError -= 360.0f;
-                while (headingError < -180.0f) headingError += 360.0f;
-
-                // Compute desired bank (P-controller)
-                float desiredRoll = headingError * state.autopilot.headingKp;
-                if (desiredRoll > AP_MAX_BANK_ANGLE) desiredRoll = AP_MAX_BANK_ANGLE;
-                if (desiredRoll < -AP_MAX_BANK_ANGLE) desiredRoll = -AP_MAX_BANK_ANGLE;
-
-                // Rate-limit: from current roll, move towards desired by max AP_HEADING_ROLL_RATE per update
-                float delta = desiredRoll - state.simulator.roll;
-                if (delta > AP_HEADING_ROLL_RATE) delta = AP_HEADING_ROLL_RATE;
-                if (delta < -AP_HEADING_ROLL_RATE) delta = -AP_HEADING_ROLL_RATE;
-                targetRoll = state.simulator.roll + delta;
-                smoothedHeadingRoll = targetRoll;  // For display / consistency
-
-                state.autopilot.selectedRoll = desiredRoll;  // Display: show desired (target)
-            } else {
-                smoothedHeadingRoll = targetRoll;
+        float targetRoll = state.autopilot.selectedRoll;
+
+        if (state.autopilot.horizontalMode == APHorizontalMode::HeadingHold) {
+            // Outer Loop: Heading -> Target Roll
+            float headingError = simHeading - state.autopilot.selectedHeading;
+            while (headingError > 180.0f) headingError -= 360.0f;
+            while (headingError < -180.0f) headingError += 360.0f;
+
+            // Compute desired bank (P-controller on the wrapped error, limited to AP_MAX_BANK_ANGLE)
+            if (!headingPid.isActive()) {
+                headingPid.start(0.0f, headingError, 0.0f);
             }
+            float desiredRoll = headingPid.compute(0.0f, headingError, dt);
+
+            // Limit the target to AP_HEADING_ROLL_RATE ahead of the current roll
+            float delta = desiredRoll - simRoll;
+            if (delta > AP_HEADING_ROLL_RATE) delta = AP_HEADING_ROLL_RATE;
+            if (delta < -AP_HEADING_ROLL_RATE) delta = -AP_HEADING_ROLL_RATE;
+            targetRoll = simRoll + delta;
+
+            state.autopilot.selectedRoll = desiredRoll;  // Display: show desired (target)
+        } else {
+            headingPid.stop();
+        }
 
-            rollPid.SetTunings(state.autopilot.rollKp, state.autopilot.rollKi, state.autopilot.rollKd);
-            rollSetpoint = targetRoll;
-            rollInput = state.simulator.roll;
-            rollPid.Compute();
+        float rollCommand;
+        {
+            PROFILE_ZONE("ap.rollPid");
+            rollCommand = computeAttitude(rollPid, SIM_RATE_ROLL, targetRoll, simRoll, nowUs, dt);
         }
 
-        int16_t cyclicX = (int16_t)(AXIS_CENTER + rollOutput);
+        int16_t cyclicX = (int16_t)(AXIS_CENTER + rollCommand);
         if (cyclicX < AXIS_MIN) cyclicX = AXIS_MIN;
         if (cyclicX > AXIS_MAX) cyclicX = AXIS_MAX;
-        setJoystickAxis(AXIS_CYCLIC_X, cyclicX);
+        setJoystickAxis(AXIS_CYCLIC_X, cyclicX, SOURCE_AUTOPILOT, state.simulator.lastUpdateUs);
     }
 }
@@ -0,0 +1,82 @@
+#include "axis_filter.h"
+
+AxisFilter::AxisFilter()
+    : minCutoffMilliHz(0), dCutoffMilliHz(0), betaMicro(0) {
+    reset();
+}
+
+void AxisFilter::configure(const AxisFilterSettings& settings) {
+    if (settings.enabled == current.enabled &&
+        settings.minCutoffHz == current.minCutoffHz &&
+        settings.beta == current.beta &&
+        settings.dCutoffHz == current.dCutoffHz) {
+        return;
+    }
+    if (settings.enabled != current.enabled) {
+        reset();
+    }
+    current = settings;
+    minCutoffMilliHz = (settings.minCutoffHz > 0.0f) ? (uint32_t)(settings.minCutoffHz * 1000.0f) : 0;
+    dCutoffMilliHz = (settings.dCutoffHz > 0.0f) ? (uint32_t)(settings.dCutoffHz * 1000.0f) : 0;
+    betaMicro = (settings.beta > 0.0f) ? (uint32_t)(settings.beta * 1000000.0f) : 0;
+}
+
+void AxisFilter::reset() {
+    primed = false;
+    valueQ8 = 0;
+    speed = 0;
+    lastUs = 0;
+}
+
+// Smoothing factor of a first-order low-pass for one step:
+// alpha = w / (1 + w), w = 2*pi*fc*dt
+int32_t AxisFilter::alphaQ16(uint32_t cutoffMilliHz, uint32_t dtUs) {
+    // 411775 = 2*pi * 65536; mHz * us = 1e-9
+    int64_t wQ16 = (int64_t)cutoffMilliHz * dtUs * 411775 / 1000000000LL;
+    return (int32_t)((wQ16 << 16) / (65536 + wQ16));
+}
+
+int16_t AxisFilter::update(int16_t value, int64_t timeUs) {
+    if (!current.enabled) {
+        return value;
+    }
+
+    int32_t xQ8 = (int32_t)value << 8;
+    if (!primed) {
+        primed = true;
+        valueQ8 = xQ8;
+        speed = 0;
+        lastUs = timeUs;
+        return value;
+    }
+
+    int64_t dt = timeUs - lastUs;
+    if (dt < AXIS_FILTER_MIN_DT_US) {
+        // Frames read in one batch share a timestamp - still let them count
+        dt = AXIS_FILTER_MIN_DT_US;
+    } else if (dt > AXIS_FILTER_MAX_DT_US) {
+        dt = AXIS_FILTER_MAX_DT_US;
+    }
+    if (timeUs > lastUs) {
+        lastUs = timeUs;
+    }
+    uint32_t dtUs = (uint32_t)dt;
+
+    // Speed against the previous filtered value, then smoothed
+    int64_t rawSpeed = ((int64_t)(xQ8 - valueQ8) * 1000000 / dtUs) >> 8;
+    if (rawSpeed > AXIS_FILTER_MAX_SPEED) rawSpeed = AXIS_FILTER_MAX_SPEED;
+    if (rawSpeed < -AXIS_FILTER_MAX_SPEED) rawSpeed = -AXIS_FILTER_MAX_SPEED;
+    int32_t aD = alphaQ16(dCutoffMilliHz, dtUs);
+    speed += (int32_t)(((int64_t)aD * (rawSpeed - speed)) >> 16);
+
+    // Faster movement -> higher cutoff -> less lag
+    uint32_t absSpeed = (uint32_t)(speed < 0 ? -speed : speed);
+    uint64_t cutoff = minCutoffMilliHz + (uint64_t)betaMicro * absSpeed / 1000;
+    if (cutoff > AXIS_FILTER_MAX_CUTOFF_MHZ) {
+        cutoff = AXIS_FILTER_MAX_CUTOFF_MHZ;
+    }
+
+    int32_t a = alphaQ16((uint32_t)cutoff, dtUs);
+    valueQ8 += (int32_t)(((int64_t)a * (xQ8 - valueQ8)) >> 16);
+    return (int16_t)((valueQ8 + 128) >> 8);
+}
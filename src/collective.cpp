@@ -3,42 +3,181 @@
 #include "joystick.h"
 #include "logger.h"
 #include "state.h"
+#include "axis_filter.h"
+#include "axis_pipeline.h"
+#include "response_curve.h"
+#include "decimator.h"
 #include <Wire.h>
 #include <AS5600.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 // AS5600 sensor instance using I2C bus 1 (to avoid USB conflicts)
 static AS5600 collectiveSensor(&Wire1);
 
+// AS5600 I2C address and RAW ANGLE register (high byte, low byte follows)
+static const uint8_t SENSOR_ADDRESS = 0x36;
+static const uint8_t REG_RAW_ANGLE = 0x0C;
+
 // Sensor connection status
 static bool sensorConnected = false;
 
-// Timing for sensor reading (20Hz = 50ms interval)
-static unsigned long lastReadTime = 0;
-static const unsigned long READ_INTERVAL_MS = 50;
+// Raw angle -> axis value (lookup table built at compile time)
+using CollectivePipeline = AxisPipeline<COLLECTIVE_SENSOR_MIN, COLLECTIVE_SENSOR_MAX,
+                                        COLLECTIVE_INVERT, COLLECTIVE_SENSOR_WRAPS>;
+
+// Oversampling (COLLECTIVE_DECIMATION reads per axis update)
+static Decimator decimator;
+
+// Adaptive noise filter (settings in state.sensors.collectiveFilter)
+static AxisFilter collectiveFilter;
+
+// Response curve (settings in state.joystick.collectiveCurve)
+static ResponseCurve collectiveCurve;
+
+// Latest sample, written by the acquisition task and picked up by the
+// control task. seq counts samples so the control task sees each one once.
+static portMUX_TYPE sampleMux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t latestRaw = 0;
+static int64_t latestUs = 0;
+static uint32_t latestSeq = 0;
+static uint32_t handledSeq = 0;
+
+// Acquisition counters (written by the acquisition task only)
+static CollectiveStats stats;
+static uint32_t rateWindowReads = 0;
+static int64_t rateWindowStartUs = 0;
+
+// Sensor settings that are lost when the bus or sensor resets
+static void configureSensor() {
+    collectiveSensor.setSlowFilter(COLLECTIVE_AS5600_SLOW_FILTER);
+    collectiveSensor.setFastFilter(COLLECTIVE_AS5600_FAST_FILTER);
+    collectiveSensor.setHysteresis(COLLECTIVE_AS5600_HYSTERESIS);
+}
+
+static void startBus() {
+    // Using Wire1 (I2C1) instead of Wire (I2C0) to avoid USB peripheral conflicts
+    Wire1.begin(PIN_COL_I2C_D, PIN_COL_I2C_C);
+    Wire1.setClock(COLLECTIVE_I2C_CLOCK);
+    // A stuck transfer must not hold the acquisition task for the default 50 ms
+    Wire1.setTimeOut(COLLECTIVE_I2C_TIMEOUT_MS);
+}
+
+// Free a bus held by a sensor stuck mid-byte (SDA low): clock SCL until the
+// sensor lets go, issue a STOP, then restart the controller and the sensor
+static void recoverBus() {
+    Wire1.end();
+
+    pinMode(PIN_COL_I2C_D, INPUT_PULLUP);
+    pinMode(PIN_COL_I2C_C, OUTPUT_OPEN_DRAIN);
+    digitalWrite(PIN_COL_I2C_C, HIGH);
+    for (int i = 0; i < 9 && digitalRead(PIN_COL_I2C_D) == LOW; i++) {
+        digitalWrite(PIN_COL_I2C_C, LOW);
+        delayMicroseconds(5);
+        digitalWrite(PIN_COL_I2C_C, HIGH);
+        delayMicroseconds(5);
+    }
+    // STOP: SDA rises while SCL is high
+    pinMode(PIN_COL_I2C_D, OUTPUT_OPEN_DRAIN);
+    digitalWrite(PIN_COL_I2C_D, LOW);
+    delayMicroseconds(5);
+    digitalWrite(PIN_COL_I2C_D, HIGH);
+    delayMicroseconds(5);
+
+    startBus();
+    configureSensor();
+    stats.recoveries++;
+}
+
+// One RAW ANGLE read; false on any bus error (NACK, timeout, short read)
+static bool readRawAngle(uint16_t* raw) {
+    Wire1.beginTransmission(SENSOR_ADDRESS);
+    Wire1.write(REG_RAW_ANGLE);
+    if (Wire1.endTransmission(false) != 0) {
+        return false;
+    }
+    if (Wire1.requestFrom(SENSOR_ADDRESS, (uint8_t)2) != 2) {
+        return false;
+    }
+    uint8_t hi = (uint8_t)Wire1.read();
+    uint8_t lo = (uint8_t)Wire1.read();
+    *raw = (uint16_t)(((hi << 8) | lo) & 0x0FFF);
+    return true;
+}
+
+// Reads the sensor at a fixed rate on core 0, so the I2C transfers never
+// block the control task
+static void acquisitionTask(void* param) {
+    uint8_t errorsInRow = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(COLLECTIVE_SAMPLE_PERIOD_MS));
+
+        uint16_t raw;
+        int64_t sampleUs = esp_timer_get_time();
+        if (!readRawAngle(&raw)) {
+            stats.busErrors++;
+            if (++errorsInRow >= COLLECTIVE_RECOVERY_ERRORS) {
+                errorsInRow = 0;
+                recoverBus();
+            }
+            continue;
+        }
+        errorsInRow = 0;
+        stats.reads++;
+
+        portENTER_CRITICAL(&sampleMux);
+        latestRaw = raw;
+        latestUs = sampleUs;
+        latestSeq++;
+        portEXIT_CRITICAL(&sampleMux);
+
+        rateWindowReads++;
+        if (sampleUs - rateWindowStartUs >= 1000000) {
+            stats.rateHz = (uint32_t)((int64_t)rateWindowReads * 1000000 / (sampleUs - rateWindowStartUs));
+            rateWindowStartUs = sampleUs;
+            rateWindowReads = 0;
+        }
+    }
+}
 
 void initCollective() {
+    state.sensors.collectiveFilter.enabled = COLLECTIVE_FILTER_ENABLED;
+    state.sensors.collectiveFilter.minCutoffHz = COLLECTIVE_FILTER_MIN_CUTOFF_HZ;
+    state.sensors.collectiveFilter.beta = COLLECTIVE_FILTER_BETA;
+    state.sensors.collectiveFilter.dCutoffHz = COLLECTIVE_FILTER_D_CUTOFF_HZ;
+    decimator.setRatio(COLLECTIVE_DECIMATION);
+    state.joystick.collectiveCurve.type = COLLECTIVE_CURVE;
+    state.joystick.collectiveCurve.amount = COLLECTIVE_CURVE_AMOUNT;
+    state.joystick.collectiveCurve.revision++;
+
     // Initialize I2C bus 1 with custom pins for collective sensor
-    // Using Wire1 (I2C1) instead of Wire (I2C0) to avoid USB peripheral conflicts
     // SDA = PIN_COL_I2C_D, SCL = PIN_COL_I2C_C
-    Wire1.begin(PIN_COL_I2C_D, PIN_COL_I2C_C);
-    
-    // Set I2C clock speed to 100kHz (standard mode) for stability
-    Wire1.setClock(100000);
+    startBus();
     
     // Initialize AS5600 sensor
     collectiveSensor.begin();
     
     // Check if sensor is connected and store the status
     sensorConnected = collectiveSensor.isConnected();
+    if (sensorConnected) {
+        configureSensor();
+        xTaskCreatePinnedToCore(acquisitionTask, "collective", COLLECTIVE_TASK_STACK, NULL,
+                                COLLECTIVE_TASK_PRIORITY, NULL, COLLECTIVE_TASK_CORE);
+    }
     
     LOG_INFO("Collective axis initialized");
     LOG_INFOF("  I2C Bus: Wire1 (I2C1, avoids USB conflicts)");
     LOG_INFOF("  I2C SDA Pin: GPIO%d", PIN_COL_I2C_D);
     LOG_INFOF("  I2C SCL Pin: GPIO%d", PIN_COL_I2C_C);
-    LOG_INFOF("  I2C Clock: 100 kHz");
+    LOG_INFOF("  I2C Clock: %d kHz", COLLECTIVE_I2C_CLOCK / 1000);
     LOG_INFOF("  AS5600 Sensor: %s", sensorConnected ? "Connected" : "NOT FOUND");
-    LOG_INFOF("  Update Rate: 20 Hz (50ms interval)");
-    LOG_INFOF("  Calibration: %d - %d (wraps at 0/4095)", COLLECTIVE_SENSOR_MIN, COLLECTIVE_SENSOR_MAX);
+    LOG_INFOF("  Read rate: %d Hz (task on core %d), %d reads per axis update",
+              1000 / COLLECTIVE_SAMPLE_PERIOD_MS, COLLECTIVE_TASK_CORE, COLLECTIVE_DECIMATION);
+    LOG_INFOF("  Calibration: %d - %d%s", COLLECTIVE_SENSOR_MIN, COLLECTIVE_SENSOR_MAX,
+              COLLECTIVE_SENSOR_WRAPS ? " (wraps at 4095/0)" : "");
     LOG_INFOF("  Inverted: %s", COLLECTIVE_INVERT ? "true" : "false");
     
     if (!sensorConnected) {
@@ -47,87 +186,33 @@ void initCollective() {
 }
 
 void handleCollective() {
-    // Skip processing if sensor is not connected
-    if (!sensorConnected) {
+    // Pick up the latest sample from the acquisition task, if there is a new one
+    portENTER_CRITICAL(&sampleMux);
+    uint32_t seq = latestSeq;
+    uint16_t raw = latestRaw;
+    int64_t sampleUs = latestUs;
+    portEXIT_CRITICAL(&sampleMux);
+    if (seq == handledSeq) {
         return;
     }
+    handledSeq = seq;
+    state.sensors.collectiveRaw = raw;
     
-    // Limit reading frequency to 20Hz (every 50ms)
-    unsigned long currentTime = millis();
-    if (currentTime - lastReadTime < READ_INTERVAL_MS) {
+    // Unwrap, clamp, map and invert in one lookup, then combine consecutive
+    // reads into one finer-grained value
+    if (!decimator.add(CollectivePipeline::map(raw), sampleUs)) {
         return;
     }
-    lastReadTime = currentTime;
-    
-    // Read raw angle from AS5600 sensor
-    // AS5600 returns 12-bit value (0-4095) representing 0-360 degrees
-    state.sensors.collectiveRaw = collectiveSensor.rawAngle();
-    
-    // Handle overflow: The axis wraps around at the ADC boundary
-    // Physical range: 1370 (down) → 4095 → 0 → 1500 (up)
-    // We need to "unwrap" this into a continuous range
-    
-    uint16_t sensorValue = state.sensors.collectiveRaw;
-    uint16_t sensorMin = COLLECTIVE_SENSOR_MIN;  // 1370
-    uint16_t sensorMax = COLLECTIVE_SENSOR_MAX;  // 1500
-    
-    // Detect overflow: if max < min, OR if the range is suspiciously small (< 200)
-    // indicating it wraps around the 0/4095 boundary
-    // In our case: 1500 - 1370 = 130, which is small, so this wraps around
-    bool hasOverflow = (sensorMax < sensorMin) || ((sensorMax - sensorMin) < 200 && sensorMax < 2000);
-    
-    int32_t normalizedValue;
-    int32_t normalizedMin;
-    int32_t normalizedMax;
-    
-    if (hasOverflow) {
-        // Overflow case: range wraps around 0/4095
-        // Physical path: sensorMin → 4095 → 0 → sensorMax
-        // Convert to continuous range by adding 4096 to wrapped values
-        
-        if (sensorValue <= sensorMax) {
-            // Value has wrapped around (it's in the 0 to sensorMax range)
-            normalizedValue = sensorValue + 4096;
-        } else {
-            // Value hasn't wrapped yet (it's in the sensorMin to 4095 range)
-            normalizedValue = sensorValue;
-        }
-        
-        normalizedMin = (int32_t)sensorMin;
-        normalizedMax = (int32_t)sensorMax + 4096;
-        
-    } else {
-        // Normal case: no overflow, direct mapping
-        normalizedValue = (int32_t)sensorValue;
-        normalizedMin = (int32_t)sensorMin;
-        normalizedMax = (int32_t)sensorMax;
-    }
-    
-    // Clamp to calibration range
-    if (normalizedValue < normalizedMin) {
-        normalizedValue = normalizedMin;
-    }
-    if (normalizedValue > normalizedMax) {
-        normalizedValue = normalizedMax;
-    }
-    
-    // Map from normalized range to joystick axis range (0 to 10000)
-    int32_t inputOffset = normalizedValue - normalizedMin;
-    int32_t inputRange = normalizedMax - normalizedMin;
-    int32_t outputRange = AXIS_MAX - AXIS_MIN;  // 10000
-    
-    // Multiply first, then divide to preserve precision
-    long mapped = ((long)inputOffset * (long)outputRange) / (long)inputRange + AXIS_MIN;
-    
-    state.sensors.collectiveCalibrated = (int16_t)mapped;
-    
-    // Apply inversion if needed
-    if (COLLECTIVE_INVERT) {
-        state.sensors.collectiveCalibrated = AXIS_MAX - (state.sensors.collectiveCalibrated - AXIS_MIN);
-    }
+    state.sensors.collectiveCalibrated = decimator.value();
+    sampleUs = decimator.timeUs();
+
+    // Smooth sensor noise
+    collectiveFilter.configure(state.sensors.collectiveFilter);
+    state.sensors.collectiveCalibrated = collectiveFilter.update(state.sensors.collectiveCalibrated, sampleUs);
 
     // Update the joystick collective axis (Z axis)
-    setJoystickAxis(AXIS_COLLECTIVE, state.sensors.collectiveCalibrated);
+    int16_t axis = collectiveCurve.apply(state.joystick.collectiveCurve, state.sensors.collectiveCalibrated);
+    setJoystickAxis(AXIS_COLLECTIVE, axis, SOURCE_COLLECTIVE_SENSOR, sampleUs);
 }
 
 uint16_t getCollectiveRaw() {
@@ -137,3 +222,12 @@ uint16_t getCollectiveRaw() {
 int16_t getCollectiveAxis() {
     return state.sensors.collectiveCalibrated;
 }
+
+CollectiveStats getCollectiveStats() {
+    CollectiveStats s = stats;
+    // A stalled task has no rate, whatever the last window said
+    if (esp_timer_get_time() - rateWindowStartUs > 2000000) {
+        s.rateHz = 0;
+    }
+    return s;
+}
@@ -0,0 +1,174 @@
+#include "cyclic_parser.h"
+#include <string.h>
+
+static_assert((CYCLIC_PARSER_RING_SIZE & (CYCLIC_PARSER_RING_SIZE - 1)) == 0,
+              "CYCLIC_PARSER_RING_SIZE must be a power of two");
+static_assert(CYCLIC_PARSER_RING_SIZE >= 2 * PACKET_V2_SIZE,
+              "CYCLIC_PARSER_RING_SIZE must hold at least two packets");
+
+// Nibble-wise CRC table: 32 bytes instead of 512, still no per-bit loop
+static const uint16_t crc16Nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t cyclicCrc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ crc16Nibble[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+CyclicParser::CyclicParser() {
+    reset();
+}
+
+void CyclicParser::reset() {
+    head = 0;
+    tail = 0;
+    stats = CyclicParserStats();
+    synced = false;
+    haveSeq = false;
+    lastSeq = 0;
+    olderInRow = 0;
+}
+
+uint8_t* CyclicParser::writeSpan(size_t* len) {
+    size_t free = CYCLIC_PARSER_RING_SIZE - available();
+    size_t pos = head & MASK;
+    size_t toEnd = CYCLIC_PARSER_RING_SIZE - pos;
+    *len = (free < toEnd) ? free : toEnd;
+    return &ring[pos];
+}
+
+void CyclicParser::commit(size_t len) {
+    size_t free = CYCLIC_PARSER_RING_SIZE - available();
+    head += (len < free) ? len : free;
+}
+
+size_t CyclicParser::write(const uint8_t* data, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+        size_t space;
+        uint8_t* dst = writeSpan(&space);
+        if (space == 0) {
+            break;
+        }
+        size_t n = (len - written < space) ? len - written : space;
+        memcpy(dst, data + written, n);
+        commit(n);
+        written += n;
+    }
+    return written;
+}
+
+bool CyclicParser::next(CyclicSample* sample) {
+    while (available() > 0) {
+        uint8_t marker = at(0);
+        size_t need = (marker == PACKET_START_MARKER) ? PACKET_SIZE :
+                      (marker == PACKET_V2_START_MARKER) ? PACKET_V2_SIZE : 0;
+        if (need == 0) {
+            if (synced) {
+                synced = false;
+                stats.resyncs++;
+            }
+            tail++;
+            stats.skippedBytes++;
+            continue;
+        }
+        if (available() < need) {
+            return false;  // Wait for the rest of the frame
+        }
+
+        bool ok = (need == PACKET_SIZE) ? decodeV1(sample) : decodeV2(sample);
+        if (!ok) {
+            // Not a frame after all - resync from the next byte
+            if (synced) {
+                synced = false;
+                stats.resyncs++;
+            }
+            tail++;
+            stats.badFrames++;
+            stats.skippedBytes++;
+            continue;
+        }
+        tail += need;
+        synced = true;
+
+        if (sample->version == 2 && !acceptSeq(sample->seq)) {
+            continue;  // Duplicate or stale - valid but not passed on
+        }
+        stats.frames++;
+        if (sample->version == 2) {
+            stats.framesV2++;
+        }
+        stats.lastVersion = sample->version;
+        return true;
+    }
+    return false;
+}
+
+bool CyclicParser::decodeV1(CyclicSample* sample) {
+    uint8_t b1 = at(1);
+    uint8_t b2 = at(2);
+    uint8_t b3 = at(3);
+    uint8_t b4 = at(4);
+    if (at(6) != PACKET_END_MARKER || (uint8_t)(b1 ^ b2 ^ b3 ^ b4) != at(5)) {
+        return false;
+    }
+    sample->sensor1 = (uint16_t)(b1 | (b2 << 8));
+    sample->sensor2 = (uint16_t)(b3 | (b4 << 8));
+    sample->version = 1;
+    sample->seq = 0;
+    sample->sensorUs = 0;
+    return true;
+}
+
+bool CyclicParser::decodeV2(CyclicSample* sample) {
+    if (at(1) != PACKET_V2_VERSION) {
+        return false;
+    }
+    uint8_t f[PACKET_V2_SIZE];
+    for (size_t i = 0; i < PACKET_V2_SIZE; i++) {
+        f[i] = at(i);
+    }
+    uint16_t crc = (uint16_t)(f[11] | (f[12] << 8));
+    if (cyclicCrc16(&f[1], 10) != crc) {
+        return false;
+    }
+    sample->version = 2;
+    sample->seq = f[2];
+    sample->sensor1 = (uint16_t)(f[3] | (f[4] << 8));
+    sample->sensor2 = (uint16_t)(f[5] | (f[6] << 8));
+    sample->sensorUs = (uint32_t)f[7] | ((uint32_t)f[8] << 8) |
+                       ((uint32_t)f[9] << 16) | ((uint32_t)f[10] << 24);
+    return true;
+}
+
+bool CyclicParser::acceptSeq(uint8_t seq) {
+    if (!haveSeq) {
+        haveSeq = true;
+        lastSeq = seq;
+        return true;
+    }
+
+    uint8_t delta = (uint8_t)(seq - lastSeq);
+    if (delta == 0) {
+        stats.duplicates++;
+        return false;
+    }
+    if (delta >= 128) {
+        // Older than the last frame - unless the sender restarted
+        stats.reordered++;
+        if (++olderInRow < CYCLIC_PARSER_SEQ_RESYNC) {
+            return false;
+        }
+    } else {
+        stats.lost += delta - 1;
+    }
+    olderInRow = 0;
+    lastSeq = seq;
+    return true;
+}
@@ -3,13 +3,35 @@
 #include "joystick.h"
 #include "logger.h"
 #include "state.h"
+#include "scheduler.h"
+#include "link_monitor.h"
+#include "axis_filter.h"
+#include "axis_pipeline.h"
+#include "response_curve.h"
+#include "decimator.h"
+#include <esp_timer.h>
 
 // Use Serial1 for cyclic data (separate from USB debug Serial)
 HardwareSerial CyclicSerial(1);
 
-// Receive buffer for building packets
-static uint8_t rxBuffer[PACKET_SIZE];
-static uint8_t rxIndex = 0;
+// Receive ring buffer and frame decoder
+static CyclicParser parser;
+
+// Raw sensor value -> axis value (lookup tables built at compile time)
+using CyclicXPipeline = AxisPipeline<CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX, CYCLIC_X_INVERT>;
+using CyclicYPipeline = AxisPipeline<CYCLIC_Y_SENSOR_MIN, CYCLIC_Y_SENSOR_MAX, CYCLIC_Y_INVERT>;
+
+// Oversampling (CYCLIC_DECIMATION frames per axis update)
+static Decimator decimX;
+static Decimator decimY;
+
+// Adaptive noise filters (settings in state.sensors.cyclicFilter)
+static AxisFilter filterX;
+static AxisFilter filterY;
+
+// Response curves (settings in state.joystick.cyclic*Curve)
+static ResponseCurve curveX;
+static ResponseCurve curveY;
 
 // Timestamp of last valid packet (for validity timeout / age calculation)
 static unsigned long lastValidPacketTime = 0;
@@ -17,87 +39,238 @@ static unsigned long lastValidPacketTime = 0;
 // Data validity timeout (milliseconds)
 #define DATA_VALID_TIMEOUT 500
 
+// A v2 frame arriving this much later than the best case means the sensor
+// board restarted (new clock) - re-anchor the clock mapping
+#define SENSOR_CLOCK_RESYNC_US 100000
+
+// Current UART rate: alternates between the v2 and v1 rate until frames arrive
+static uint32_t currentBaud = CYCLIC_SERIAL_BAUD;
+static unsigned long lastBaudChangeMs = 0;
+
+// Sensor board clock -> esp_timer mapping for v2 sample timestamps
+static bool clockSynced = false;
+static uint32_t clockOffsetUs = 0;  // Smallest (arrival - sensor time) seen, mod 2^32
+static uint8_t clockCreep = 0;
+
+// Sample age at processing (sensor sample time for v2, arrival for v1), us
+static uint32_t lastSampleAgeUs = 0;
+static uint32_t maxSampleAgeUs = 0;
+
+// UART receive events (written by the UART event task, read by the control
+// task under rxEventMux): when each fired and how many bytes had arrived in
+// total by then, so every frame gets the time of the event that delivered
+// its last byte
+#define RX_EVENT_SLOTS 16
+struct RxEvent {
+    int64_t timeUs;
+    uint32_t received;  // Bytes received since start (wraps)
+};
+static RxEvent rxEvents[RX_EVENT_SLOTS];
+static uint8_t rxEventHead = 0;   // Oldest pending event
+static uint8_t rxEventCount = 0;
+static uint32_t rxConsumed = 0;   // Bytes read out of the driver (wraps)
+static portMUX_TYPE rxEventMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Arrival-to-processing latency of received frames (us)
+static uint32_t lastLatencyUs = 0;
+static uint32_t maxLatencyUs = 0;
+static uint32_t avgLatencyUs = 0;  // Exponential moving average (1/16)
+
 // Forward declarations
-static bool validatePacket(const uint8_t* packet);
-static void processPacket(const uint8_t* packet);
-static int16_t mapSensorToAxis(uint16_t sensorValue, uint16_t sensorMin, uint16_t sensorMax, bool invert);
+static void processPacket(const CyclicSample& sample, int64_t arrivalUs);
+static void setCyclicBaud(uint32_t baud);
+
+#if CYCLIC_SERIAL_RX_EVENTS
+// UART receive event (runs in the UART driver's event task). Fires once per
+// frame thanks to the low FIFO threshold: timestamp it and wake the control
+// task so the frame is parsed right away instead of at the next tick.
+static void onCyclicReceive() {
+    int64_t now = esp_timer_get_time();
+
+    // Consumed count first, then the driver's fill level: a read completing
+    // in between can only make the total too small, which at worst hands
+    // the frame a later event's time, never one from before it arrived
+    portENTER_CRITICAL(&rxEventMux);
+    uint32_t consumed = rxConsumed;
+    portEXIT_CRITICAL(&rxEventMux);
+    int available = CyclicSerial.available();  // Takes the driver's mutex: outside the spinlock
+    uint32_t received = consumed + (uint32_t)(available > 0 ? available : 0);
+
+    portENTER_CRITICAL(&rxEventMux);
+    if (rxEventCount > 0) {
+        // Totals never go backwards
+        const RxEvent& last = rxEvents[(rxEventHead + rxEventCount - 1) % RX_EVENT_SLOTS];
+        if ((int32_t)(received - last.received) < 0) {
+            received = last.received;
+        }
+    }
+    if (rxEventCount == RX_EVENT_SLOTS) {
+        rxEventHead = (rxEventHead + 1) % RX_EVENT_SLOTS;  // Full: drop the oldest
+        rxEventCount--;
+    }
+    rxEvents[(rxEventHead + rxEventCount) % RX_EVENT_SLOTS] = {now, received};
+    rxEventCount++;
+    portEXIT_CRITICAL(&rxEventMux);
+
+    controlScheduler.wake();
+}
+#endif
+
+// Arrival time of the frame whose last byte is byte number frameEnd: the
+// first receive event by which that many bytes had arrived. Older events are
+// dropped. Without such an event (events off, or its event not handled yet)
+// the frame counts as arriving at readUs.
+static int64_t frameArrivalUs(uint32_t frameEnd, int64_t readUs) {
+#if CYCLIC_SERIAL_RX_EVENTS
+    int64_t arrivalUs = readUs;
+    portENTER_CRITICAL(&rxEventMux);
+    while (rxEventCount > 0) {
+        const RxEvent& ev = rxEvents[rxEventHead];
+        if ((int32_t)(ev.received - frameEnd) >= 0) {
+            if (ev.timeUs <= readUs) {
+                arrivalUs = ev.timeUs;
+            }
+            break;  // Keep it: the next frame may have come with it too
+        }
+        rxEventHead = (rxEventHead + 1) % RX_EVENT_SLOTS;
+        rxEventCount--;
+    }
+    portEXIT_CRITICAL(&rxEventMux);
+    return arrivalUs;
+#else
+    (void)frameEnd;
+    return readUs;
+#endif
+}
 
 void initCyclicSerial() {
+    state.sensors.cyclicFilter.enabled = CYCLIC_FILTER_ENABLED;
+    state.sensors.cyclicFilter.minCutoffHz = CYCLIC_FILTER_MIN_CUTOFF_HZ;
+    state.sensors.cyclicFilter.beta = CYCLIC_FILTER_BETA;
+    state.sensors.cyclicFilter.dCutoffHz = CYCLIC_FILTER_D_CUTOFF_HZ;
+    decimX.setRatio(CYCLIC_DECIMATION);
+    decimY.setRatio(CYCLIC_DECIMATION);
+    state.joystick.cyclicXCurve.type = CYCLIC_X_CURVE;
+    state.joystick.cyclicXCurve.amount = CYCLIC_X_CURVE_AMOUNT;
+    state.joystick.cyclicXCurve.revision++;
+    state.joystick.cyclicYCurve.type = CYCLIC_Y_CURVE;
+    state.joystick.cyclicYCurve.amount = CYCLIC_Y_CURVE_AMOUNT;
+    state.joystick.cyclicYCurve.revision++;
+
     // Initialize Serial1 with custom pins
     CyclicSerial.begin(CYCLIC_SERIAL_BAUD, SERIAL_8N1, PIN_CYCLIC_RX, PIN_CYCLIC_TX);
+    // The v2 rate gets a full hunt window from now, however long boot took
+    lastBaudChangeMs = millis();
+
+#if CYCLIC_SERIAL_RX_EVENTS
+    // By default the driver holds bytes until ~120 are in the FIFO or the line
+    // has been idle for a while. Drop the threshold to one frame so every
+    // frame raises an event as soon as its last byte arrives.
+    CyclicSerial.setRxFIFOFull(PACKET_V2_SIZE);
+    CyclicSerial.setRxTimeout(CYCLIC_SERIAL_RX_TIMEOUT);
+    CyclicSerial.onReceive(onCyclicReceive);
+    controlScheduler.addWakeHandler(handleCyclicSerial);
+#endif
+    cyclicLink.attachUart(CyclicSerial);
     
     LOG_INFO("Cyclic serial receiver initialized");
     LOG_INFOF("  RX Pin: GPIO%d", PIN_CYCLIC_RX);
-    LOG_INFOF("  Baud rate: %d", CYCLIC_SERIAL_BAUD);
+    LOG_INFOF("  Baud rate: %d (v2), %d (v1, auto-detected)", CYCLIC_SERIAL_BAUD, CYCLIC_SERIAL_BAUD_V1);
+#if CYCLIC_SERIAL_RX_EVENTS
+    LOG_INFOF("  RX events: FIFO full 1 frame, timeout %d symbols", CYCLIC_SERIAL_RX_TIMEOUT);
+#else
+    LOG_INFO("  RX events: off (polled)");
+#endif
     LOG_INFOF("  X calibration: %d - %d", CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX);
     LOG_INFOF("  Y calibration: %d - %d", CYCLIC_Y_SENSOR_MIN, CYCLIC_Y_SENSOR_MAX);
 }
 
-void handleCyclicSerial() {
-    // Read all available bytes
-    while (CyclicSerial.available() > 0) {
-        uint8_t byte = CyclicSerial.read();
-        
-        // If we're starting fresh, look for start marker
-        if (rxIndex == 0) {
-            if (byte == PACKET_START_MARKER) {
-                rxBuffer[rxIndex++] = byte;
-            }
-            // Otherwise ignore the byte (out of sync)
-            continue;
-        }
-        
-        // Add byte to buffer
-        rxBuffer[rxIndex++] = byte;
-        
-        // Check if we have a complete packet
-        if (rxIndex >= PACKET_SIZE) {
-            // Validate and process the packet
-            if (validatePacket(rxBuffer)) {
-                processPacket(rxBuffer);
-            }
-            // Reset for next packet
-            rxIndex = 0;
-        }
+static void setCyclicBaud(uint32_t baud) {
+    currentBaud = baud;
+    lastBaudChangeMs = millis();
+    CyclicSerial.updateBaudRate(baud);
+#if CYCLIC_SERIAL_RX_EVENTS
+    // One event per frame of the protocol expected at this rate
+    CyclicSerial.setRxFIFOFull(baud == CYCLIC_SERIAL_BAUD_V1 ? PACKET_SIZE : PACKET_V2_SIZE);
+#endif
+    clockSynced = false;
+    LOG_DEBUGF("Cyclic serial: trying %lu baud", baud);
+}
+
+// Local (esp_timer) time at which a v2 sample was taken. The smallest
+// arrival - sensor time seen is the clock offset plus the minimum transfer
+// delay; it creeps up by 1 us every 8 frames (125 ppm) to follow drift.
+static int64_t sensorSampleLocalUs(uint32_t sensorUs, int64_t arrivalUs) {
+    uint32_t offset = (uint32_t)arrivalUs - sensorUs;
+    int32_t excess = (int32_t)(offset - clockOffsetUs);
+    if (!clockSynced || excess < 0 || excess > SENSOR_CLOCK_RESYNC_US) {
+        clockSynced = true;
+        clockOffsetUs = offset;
+        excess = 0;
+    } else if (++clockCreep >= 8) {
+        clockCreep = 0;
+        clockOffsetUs++;
     }
+    // The minimum delay is at least the time to shift the frame out
+    uint32_t wireUs = (uint32_t)((uint64_t)PACKET_V2_SIZE * 10 * 1000000ULL / currentBaud);
+    return arrivalUs - excess - wireUs;
 }
 
-static bool validatePacket(const uint8_t* packet) {
-    // Check start marker
-    if (packet[0] != PACKET_START_MARKER) {
-        return false;
+void handleCyclicSerial() {
+    // No valid frame for a while: the board may use the other protocol's rate
+    unsigned long nowMs = millis();
+    unsigned long quietSince = (lastValidPacketTime > lastBaudChangeMs) ? lastValidPacketTime : lastBaudChangeMs;
+    if (nowMs - quietSince >= CYCLIC_SERIAL_BAUD_HUNT_MS) {
+        setCyclicBaud(currentBaud == CYCLIC_SERIAL_BAUD ? CYCLIC_SERIAL_BAUD_V1 : CYCLIC_SERIAL_BAUD);
     }
-    
-    // Check end marker
-    if (packet[6] != PACKET_END_MARKER) {
-        // Bad end marker - we're probably out of sync
-        // Try to find start marker in the buffer and shift
-        for (int i = 1; i < PACKET_SIZE; i++) {
-            if (packet[i] == PACKET_START_MARKER) {
-                // Shift buffer to realign
-                memmove(rxBuffer, &packet[i], PACKET_SIZE - i);
-                rxIndex = PACKET_SIZE - i;
-                return false;
-            }
-        }
-        return false;
+
+    int pending = CyclicSerial.available();
+    if (pending <= 0) {
+        return;
     }
-    
-    // Calculate checksum (XOR of angle bytes)
-    uint8_t checksum = packet[1] ^ packet[2] ^ packet[3] ^ packet[4];
-    
-    if (checksum != packet[5]) {
-        // Checksum mismatch
-        return false;
+
+    // Frame arrival = the receive event that delivered its last byte,
+    // else the read time
+    int64_t readUs = esp_timer_get_time();
+
+    // The link counters take the change of the parser totals, so a counter
+    // reset from the web UI sticks
+    CyclicParserStats before = parser.getStats();
+
+    // Copy straight from the UART driver into the ring (at most two spans
+    // when the write position wraps), decoding frames as space is freed
+    while (pending > 0) {
+        size_t space;
+        uint8_t* dst = parser.writeSpan(&space);
+        size_t n = CyclicSerial.readBytes(dst, ((size_t)pending < space) ? (size_t)pending : space);
+        if (n == 0) {
+            break;
+        }
+        parser.commit(n);
+        pending -= (int)n;
+        portENTER_CRITICAL(&rxEventMux);
+        rxConsumed += (uint32_t)n;
+        uint32_t consumed = rxConsumed;
+        portEXIT_CRITICAL(&rxEventMux);
+
+        CyclicSample sample;
+        while (parser.next(&sample)) {
+            // Bytes still buffered come after this frame
+            int64_t arrivalUs = frameArrivalUs(consumed - (uint32_t)parser.available(), readUs);
+            cyclicLink.frameReceived(arrivalUs);
+            processPacket(sample, arrivalUs);
+        }
     }
-    
-    return true;
+
+    const CyclicParserStats& ps = parser.getStats();
+    cyclicLink.counters.checksumErrors += ps.badFrames - before.badFrames;
+    cyclicLink.counters.resyncs += ps.resyncs - before.resyncs;
+    cyclicLink.counters.discardedBytes += ps.skippedBytes - before.skippedBytes;
 }
 
-static void processPacket(const uint8_t* packet) {
-    // Extract sensor values (little-endian uint16_t)
-    uint16_t sensor1 = packet[1] | (packet[2] << 8);
-    uint16_t sensor2 = packet[3] | (packet[4] << 8);
+static void processPacket(const CyclicSample& sample, int64_t arrivalUs) {
+    uint16_t sensor1 = sample.sensor1;
+    uint16_t sensor2 = sample.sensor2;
     
     // Store in global state
     state.sensors.cyclicXRaw = sensor1;
@@ -105,18 +278,54 @@ static void processPacket(const uint8_t* packet) {
     state.sensors.cyclicValid = true;
     
     // Map sensor values to joystick axis range
-    int16_t axisX = mapSensorToAxis(sensor1, CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX, CYCLIC_X_INVERT);
-    int16_t axisY = mapSensorToAxis(sensor2, CYCLIC_Y_SENSOR_MIN, CYCLIC_Y_SENSOR_MAX, CYCLIC_Y_INVERT);
-    state.sensors.cyclicXCalibrated = axisX;
-    state.sensors.cyclicYCalibrated = axisY;
+    int16_t axisX = CyclicXPipeline::map(sensor1);
+    int16_t axisY = CyclicYPipeline::map(sensor2);
     
     // Update timestamp for validity timeout
     lastValidPacketTime = millis();
 
-    // Update joystick values in state
+    // Arrival-to-processing latency
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = (uint32_t)(now - arrivalUs);
+    lastLatencyUs = latency;
+    if (latency > maxLatencyUs) {
+        maxLatencyUs = latency;
+    }
+    avgLatencyUs = (avgLatencyUs * 15 + latency) / 16;
+
+    // v2 frames say when the sensor was read; trace latency from there
+    int64_t sampleUs = (sample.version == 2) ? sensorSampleLocalUs(sample.sensorUs, arrivalUs) : arrivalUs;
+    uint32_t age = (now > sampleUs) ? (uint32_t)(now - sampleUs) : 0;
+    lastSampleAgeUs = age;
+    if (age > maxSampleAgeUs) {
+        maxSampleAgeUs = age;
+    }
+
+    // Combine consecutive frames into one finer-grained value (X and Y
+    // blocks always complete together)
+    bool blockX = decimX.add(axisX, sampleUs);
+    bool blockY = decimY.add(axisY, sampleUs);
+    if (!blockX || !blockY) {
+        return;
+    }
+    axisX = decimX.value();
+    axisY = decimY.value();
+    sampleUs = decimX.timeUs();
+
+    // Smooth sensor noise (filtered by sample time, so batching doesn't matter)
+    filterX.configure(state.sensors.cyclicFilter);
+    filterY.configure(state.sensors.cyclicFilter);
+    axisX = filterX.update(axisX, sampleUs);
+    axisY = filterY.update(axisY, sampleUs);
+    state.sensors.cyclicXCalibrated = axisX;
+    state.sensors.cyclicYCalibrated = axisY;
+
+    // Update joystick values in state. Response curves shape the pilot's
+    // input only: the calibrated sensor values above (used by cyclic
+    // feedback) and the AP output stay linear.
     // Roll (X) is only updated by sensor if AP is not holding it
     if (!state.autopilot.enabled || state.autopilot.horizontalMode != APHorizontalMode::RollHold) {
-        setJoystickAxis(AXIS_CYCLIC_X, axisX);
+        setJoystickAxis(AXIS_CYCLIC_X, curveX.apply(state.joystick.cyclicXCurve, axisX), SOURCE_CYCLIC_SENSOR, sampleUs);
     }
 
     // Pitch (Y) is only updated by sensor if AP is not controlling it
@@ -124,31 +333,10 @@ static void processPacket(const uint8_t* packet) {
         (state.autopilot.verticalMode == APVerticalMode::PitchHold ||
          state.autopilot.verticalMode == APVerticalMode::VerticalSpeed);
     if (!apControlsPitch) {
-        setJoystickAxis(AXIS_CYCLIC_Y, axisY);
+        setJoystickAxis(AXIS_CYCLIC_Y, curveY.apply(state.joystick.cyclicYCurve, axisY), SOURCE_CYCLIC_SENSOR, sampleUs);
     }
 }
 
-static int16_t mapSensorToAxis(uint16_t sensorValue, uint16_t sensorMin, uint16_t sensorMax, bool invert) {
-    // Clamp sensor value to calibration range
-    if (sensorValue < sensorMin) {
-        sensorValue = sensorMin;
-    }
-    if (sensorValue > sensorMax) {
-        sensorValue = sensorMax;
-    }
-    
-    // Map from sensor range to joystick axis range (0 to 10000)
-    // Using long to avoid overflow during calculation
-    long mapped = (long)(sensorValue - sensorMin) * (AXIS_MAX - AXIS_MIN) / (sensorMax - sensorMin) + AXIS_MIN;
-    
-    // Apply inversion if needed
-    if (invert) {
-        mapped = AXIS_MAX - (mapped - AXIS_MIN);
-    }
-    
-    return (int16_t)mapped;
-}
-
 uint16_t getCyclicXRaw() {
     return state.sensors.cyclicXRaw;
 }
@@ -172,3 +360,31 @@ unsigned long getCyclicDataAge() {
     }
     return millis() - lastValidPacketTime;
 }
+
+uint32_t getCyclicRxLatencyUs() {
+    return lastLatencyUs;
+}
+
+uint32_t getCyclicRxLatencyAvgUs() {
+    return avgLatencyUs;
+}
+
+uint32_t getCyclicRxLatencyMaxUs() {
+    return maxLatencyUs;
+}
+
+const CyclicParserStats& getCyclicParserStats() {
+    return parser.getStats();
+}
+
+uint32_t getCyclicSampleAgeUs() {
+    return lastSampleAgeUs;
+}
+
+uint32_t getCyclicSampleAgeMaxUs() {
+    return maxSampleAgeUs;
+}
+
+uint32_t getCyclicBaud() {
+    return currentBaud;
+}
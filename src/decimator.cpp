@@ -0,0 +1,32 @@
+#include "decimator.h"
+
+Decimator::Decimator() : ratio(1), out(0), outUs(0) {
+    reset();
+}
+
+void Decimator::setRatio(uint8_t newRatio) {
+    ratio = (newRatio < 1) ? 1 : newRatio;
+    reset();
+}
+
+void Decimator::reset() {
+    sum = 0;
+    count = 0;
+    firstUs = 0;
+}
+
+bool Decimator::add(int16_t sample, int64_t sampleUs) {
+    if (count == 0) {
+        firstUs = sampleUs;
+    }
+    sum += sample;
+    if (++count < ratio) {
+        return false;
+    }
+
+    // Rounded average; the block represents the middle of its time span
+    out = (int16_t)((sum + ratio / 2) / ratio);
+    outUs = firstUs + (sampleUs - firstUs) / 2;
+    reset();
+    return true;
+}
@@ -0,0 +1,595 @@
+#include "ffb.h"
+#include "ffb_engine.h"
+#include "config.h"
+#include "state.h"
+#include "steppers.h"
+#include "joystick.h"
+#include "logger.h"
+#include "tusb.h"
+#include <esp_timer.h>
+
+static_assert(SCHED_FFB_PERIOD_MS * 1000 == FFB_ENGINE_TICK_US,
+              "The effect engine must tick at its fixed rate");
+static_assert(FFB_MAX_STEP_RATE * SCHED_FFB_PERIOD_MS <= 1000,
+              "At most one step per axis per FFB tick");
+
+// =============================================================================
+// PID report descriptor
+// =============================================================================
+// Layouts match the report structs in ffb_engine.h (all fields byte aligned).
+
+#define PID_EFFECT_BLOCK_INDEX    0x22
+#define PID_PARAM_BLOCK_OFFSET    0x23
+#define PID_EFFECT_TYPE           0x25
+#define PID_ET_CONSTANT           0x26
+#define PID_ET_RAMP               0x27
+#define PID_ET_SQUARE             0x30
+#define PID_ET_SINE               0x31
+#define PID_ET_TRIANGLE           0x32
+#define PID_ET_SAWTOOTH_UP        0x33
+#define PID_ET_SAWTOOTH_DOWN      0x34
+#define PID_ET_SPRING             0x40
+#define PID_ET_DAMPER             0x41
+#define PID_ET_INERTIA            0x42
+#define PID_ET_FRICTION           0x43
+#define PID_SET_EFFECT_REPORT     0x21
+#define PID_DURATION              0x50
+#define PID_SAMPLE_PERIOD         0x51
+#define PID_GAIN                  0x52
+#define PID_TRIGGER_BUTTON        0x53
+#define PID_TRIGGER_REPEAT        0x54
+#define PID_AXES_ENABLE           0x55
+#define PID_DIRECTION_ENABLE      0x56
+#define PID_DIRECTION             0x57
+#define PID_START_DELAY           0xA7
+#define PID_SET_ENVELOPE_REPORT   0x5A
+#define PID_ATTACK_LEVEL          0x5B
+#define PID_ATTACK_TIME           0x5C
+#define PID_FADE_LEVEL            0x5D
+#define PID_FADE_TIME             0x5E
+#define PID_SET_CONDITION_REPORT  0x5F
+#define PID_CP_OFFSET             0x60
+#define PID_POSITIVE_COEFFICIENT  0x61
+#define PID_NEGATIVE_COEFFICIENT  0x62
+#define PID_POSITIVE_SATURATION   0x63
+#define PID_NEGATIVE_SATURATION   0x64
+#define PID_DEAD_BAND             0x65
+#define PID_SET_PERIODIC_REPORT   0x6E
+#define PID_OFFSET                0x6F
+#define PID_MAGNITUDE             0x70
+#define PID_PHASE                 0x71
+#define PID_PERIOD                0x72
+#define PID_SET_CONSTANT_REPORT   0x73
+#define PID_SET_RAMP_REPORT       0x74
+#define PID_RAMP_START            0x75
+#define PID_RAMP_END              0x76
+#define PID_EFFECT_OP_REPORT      0x77
+#define PID_EFFECT_OPERATION      0x78
+#define PID_OP_START              0x79
+#define PID_OP_START_SOLO         0x7A
+#define PID_OP_STOP               0x7B
+#define PID_LOOP_COUNT            0x7C
+#define PID_DEVICE_GAIN_REPORT    0x7D
+#define PID_DEVICE_GAIN           0x7E
+#define PID_POOL_REPORT           0x7F
+#define PID_RAM_POOL_SIZE         0x80
+#define PID_SIMULTANEOUS_MAX      0x83
+#define PID_BLOCK_LOAD_REPORT     0x89
+#define PID_BLOCK_LOAD_STATUS     0x8B
+#define PID_LOAD_SUCCESS          0x8C
+#define PID_LOAD_FULL             0x8D
+#define PID_LOAD_ERROR            0x8E
+#define PID_BLOCK_FREE_REPORT     0x90
+#define PID_STATE_REPORT          0x92
+#define PID_EFFECT_PLAYING        0x94
+#define PID_DEVICE_CONTROL_REPORT 0x95
+#define PID_DEVICE_CONTROL        0x96
+#define PID_DC_ENABLE_ACTUATORS   0x97
+#define PID_DC_DISABLE_ACTUATORS  0x98
+#define PID_DC_STOP_ALL           0x99
+#define PID_DC_RESET              0x9A
+#define PID_DC_PAUSE              0x9B
+#define PID_DC_CONTINUE           0x9C
+#define PID_DEVICE_PAUSED         0x9F
+#define PID_ACTUATORS_ENABLED     0xA0
+#define PID_SAFETY_SWITCH         0xA4
+#define PID_ACTUATOR_OVERRIDE     0xA5
+#define PID_ACTUATOR_POWER        0xA6
+#define PID_DEVICE_MANAGED_POOL   0xA9
+#define PID_SHARED_PARAM_BLOCKS   0xAA
+#define PID_CREATE_EFFECT_REPORT  0xAB
+#define PID_RAM_POOL_AVAILABLE    0xAC
+
+#define PID_UNIT_MS               HID_UNIT_N(0x1003, 2), HID_UNIT_EXPONENT(0x0D)  // SI time, 10^-3 s
+#define PID_UNIT_ANGLE            HID_UNIT(0x14), HID_UNIT_EXPONENT(0x0E)         // Degrees, 10^-2
+#define PID_UNIT_NONE             HID_UNIT(0), HID_UNIT_EXPONENT(0)
+
+#define PID_BLOCK_INDEX_FIELD(io) \
+    HID_USAGE(PID_EFFECT_BLOCK_INDEX), \
+    HID_LOGICAL_MIN(1), \
+    HID_LOGICAL_MAX(FFB_MAX_EFFECTS), \
+    HID_REPORT_SIZE(8), \
+    HID_REPORT_COUNT(1), \
+    io(HID_DATA | HID_VARIABLE | HID_ABSOLUTE)
+
+#define PID_EFFECT_TYPE_FIELD(io) \
+    HID_USAGE(PID_EFFECT_TYPE), \
+    HID_COLLECTION(HID_COLLECTION_LOGICAL), \
+        HID_USAGE(PID_ET_CONSTANT), \
+        HID_USAGE(PID_ET_RAMP), \
+        HID_USAGE(PID_ET_SQUARE), \
+        HID_USAGE(PID_ET_SINE), \
+        HID_USAGE(PID_ET_TRIANGLE), \
+        HID_USAGE(PID_ET_SAWTOOTH_UP), \
+        HID_USAGE(PID_ET_SAWTOOTH_DOWN), \
+        HID_USAGE(PID_ET_SPRING), \
+        HID_USAGE(PID_ET_DAMPER), \
+        HID_USAGE(PID_ET_INERTIA), \
+        HID_USAGE(PID_ET_FRICTION), \
+        HID_LOGICAL_MIN(1), \
+        HID_LOGICAL_MAX(FFB_EFFECT_TYPE_COUNT - 1), \
+        HID_REPORT_SIZE(8), \
+        HID_REPORT_COUNT(1), \
+        io(HID_DATA | HID_ARRAY | HID_ABSOLUTE), \
+    HID_COLLECTION_END
+
+const uint8_t ffbReportDescriptor[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_PID),
+
+    // PID State (input)
+    HID_USAGE(PID_STATE_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_STATE)
+        HID_USAGE(PID_DEVICE_PAUSED),
+        HID_USAGE(PID_ACTUATORS_ENABLED),
+        HID_USAGE(PID_SAFETY_SWITCH),
+        HID_USAGE(PID_ACTUATOR_OVERRIDE),
+        HID_USAGE(PID_ACTUATOR_POWER),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_SIZE(1),
+        HID_REPORT_COUNT(5),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_REPORT_COUNT(3),
+        HID_INPUT(HID_CONSTANT | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_EFFECT_PLAYING),
+        HID_REPORT_COUNT(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_EFFECT_BLOCK_INDEX),
+        HID_LOGICAL_MIN(1),
+        HID_LOGICAL_MAX(FFB_MAX_EFFECTS),
+        HID_REPORT_SIZE(7),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Set Effect
+    HID_USAGE(PID_SET_EFFECT_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_EFFECT)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        PID_EFFECT_TYPE_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_DURATION),
+        HID_USAGE(PID_TRIGGER_REPEAT),
+        HID_USAGE(PID_SAMPLE_PERIOD),
+        HID_USAGE(PID_START_DELAY),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_PHYSICAL_MIN(0),
+        HID_PHYSICAL_MAX_N(0xFFFF, 3),
+        PID_UNIT_MS,
+        HID_REPORT_SIZE(16),
+        HID_REPORT_COUNT(4),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        PID_UNIT_NONE,
+        HID_PHYSICAL_MAX(0),
+        HID_USAGE(PID_GAIN),
+        HID_LOGICAL_MAX_N(255, 2),
+        HID_REPORT_SIZE(8),
+        HID_REPORT_COUNT(1),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_TRIGGER_BUTTON),
+        HID_LOGICAL_MAX(32),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_AXES_ENABLE),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+            HID_USAGE(HID_USAGE_DESKTOP_X),
+            HID_USAGE(HID_USAGE_DESKTOP_Y),
+            HID_LOGICAL_MAX(1),
+            HID_REPORT_SIZE(1),
+            HID_REPORT_COUNT(2),
+            HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_COLLECTION_END,
+        HID_USAGE_PAGE(HID_USAGE_PAGE_PID),
+        HID_USAGE(PID_DIRECTION_ENABLE),
+        HID_REPORT_COUNT(1),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_REPORT_COUNT(5),
+        HID_OUTPUT(HID_CONSTANT | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_DIRECTION),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE_N(((uint32_t)HID_USAGE_PAGE_ORDINAL << 16) | 1, 3),
+            HID_USAGE_N(((uint32_t)HID_USAGE_PAGE_ORDINAL << 16) | 2, 3),
+            HID_LOGICAL_MAX_N(35999, 3),
+            HID_PHYSICAL_MAX_N(35999, 3),
+            PID_UNIT_ANGLE,
+            HID_REPORT_SIZE(16),
+            HID_REPORT_COUNT(2),
+            HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+            PID_UNIT_NONE,
+            HID_PHYSICAL_MAX(0),
+        HID_COLLECTION_END,
+    HID_COLLECTION_END,
+
+    // Set Envelope
+    HID_USAGE(PID_SET_ENVELOPE_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_ENVELOPE)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_ATTACK_LEVEL),
+        HID_USAGE(PID_FADE_LEVEL),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(FFB_FORCE_MAX, 2),
+        HID_REPORT_SIZE(16),
+        HID_REPORT_COUNT(2),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_ATTACK_TIME),
+        HID_USAGE(PID_FADE_TIME),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_PHYSICAL_MAX_N(0xFFFF, 3),
+        PID_UNIT_MS,
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        PID_UNIT_NONE,
+        HID_PHYSICAL_MAX(0),
+    HID_COLLECTION_END,
+
+    // Set Condition
+    HID_USAGE(PID_SET_CONDITION_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_CONDITION)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_PARAM_BLOCK_OFFSET),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(FFB_AXES - 1),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_CP_OFFSET),
+        HID_USAGE(PID_POSITIVE_COEFFICIENT),
+        HID_USAGE(PID_NEGATIVE_COEFFICIENT),
+        HID_LOGICAL_MIN_N(-FFB_FORCE_MAX, 2),
+        HID_LOGICAL_MAX_N(FFB_FORCE_MAX, 2),
+        HID_REPORT_SIZE(16),
+        HID_REPORT_COUNT(3),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_POSITIVE_SATURATION),
+        HID_USAGE(PID_NEGATIVE_SATURATION),
+        HID_USAGE(PID_DEAD_BAND),
+        HID_LOGICAL_MIN(0),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Set Periodic
+    HID_USAGE(PID_SET_PERIODIC_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_PERIODIC)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_MAGNITUDE),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(FFB_FORCE_MAX, 2),
+        HID_REPORT_SIZE(16),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_OFFSET),
+        HID_LOGICAL_MIN_N(-FFB_FORCE_MAX, 2),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_PHASE),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(35999, 3),
+        HID_PHYSICAL_MAX_N(35999, 3),
+        PID_UNIT_ANGLE,
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_PERIOD),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_PHYSICAL_MAX_N(0xFFFF, 3),
+        PID_UNIT_MS,
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        PID_UNIT_NONE,
+        HID_PHYSICAL_MAX(0),
+    HID_COLLECTION_END,
+
+    // Set Constant Force
+    HID_USAGE(PID_SET_CONSTANT_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_CONSTANT)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_MAGNITUDE),
+        HID_LOGICAL_MIN_N(-FFB_FORCE_MAX, 2),
+        HID_LOGICAL_MAX_N(FFB_FORCE_MAX, 2),
+        HID_REPORT_SIZE(16),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Set Ramp Force
+    HID_USAGE(PID_SET_RAMP_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_SET_RAMP)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_RAMP_START),
+        HID_USAGE(PID_RAMP_END),
+        HID_LOGICAL_MIN_N(-FFB_FORCE_MAX, 2),
+        HID_LOGICAL_MAX_N(FFB_FORCE_MAX, 2),
+        HID_REPORT_SIZE(16),
+        HID_REPORT_COUNT(2),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Effect Operation
+    HID_USAGE(PID_EFFECT_OP_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_EFFECT_OP)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+        HID_USAGE(PID_EFFECT_OPERATION),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE(PID_OP_START),
+            HID_USAGE(PID_OP_START_SOLO),
+            HID_USAGE(PID_OP_STOP),
+            HID_LOGICAL_MIN(1),
+            HID_LOGICAL_MAX(3),
+            HID_OUTPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE),
+        HID_COLLECTION_END,
+        HID_USAGE(PID_LOOP_COUNT),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(255, 2),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // PID Block Free
+    HID_USAGE(PID_BLOCK_FREE_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_BLOCK_FREE)
+        PID_BLOCK_INDEX_FIELD(HID_OUTPUT),
+    HID_COLLECTION_END,
+
+    // PID Device Control
+    HID_USAGE(PID_DEVICE_CONTROL_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_DEVICE_CONTROL)
+        HID_USAGE(PID_DEVICE_CONTROL),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE(PID_DC_ENABLE_ACTUATORS),
+            HID_USAGE(PID_DC_DISABLE_ACTUATORS),
+            HID_USAGE(PID_DC_STOP_ALL),
+            HID_USAGE(PID_DC_RESET),
+            HID_USAGE(PID_DC_PAUSE),
+            HID_USAGE(PID_DC_CONTINUE),
+            HID_LOGICAL_MIN(1),
+            HID_LOGICAL_MAX(6),
+            HID_REPORT_SIZE(8),
+            HID_REPORT_COUNT(1),
+            HID_OUTPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE),
+        HID_COLLECTION_END,
+    HID_COLLECTION_END,
+
+    // Device Gain
+    HID_USAGE(PID_DEVICE_GAIN_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_DEVICE_GAIN)
+        HID_USAGE(PID_DEVICE_GAIN),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(255, 2),
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // Create New Effect (feature, set)
+    HID_USAGE(PID_CREATE_EFFECT_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_CREATE_EFFECT)
+        PID_EFFECT_TYPE_FIELD(HID_FEATURE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_BYTE_COUNT),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_REPORT_SIZE(16),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_PID),
+    HID_COLLECTION_END,
+
+    // PID Block Load (feature, get)
+    HID_USAGE(PID_BLOCK_LOAD_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_BLOCK_LOAD)
+        PID_BLOCK_INDEX_FIELD(HID_FEATURE),
+        HID_USAGE(PID_BLOCK_LOAD_STATUS),
+        HID_COLLECTION(HID_COLLECTION_LOGICAL),
+            HID_USAGE(PID_LOAD_SUCCESS),
+            HID_USAGE(PID_LOAD_FULL),
+            HID_USAGE(PID_LOAD_ERROR),
+            HID_LOGICAL_MIN(1),
+            HID_LOGICAL_MAX(3),
+            HID_FEATURE(HID_DATA | HID_ARRAY | HID_ABSOLUTE),
+        HID_COLLECTION_END,
+        HID_USAGE(PID_RAM_POOL_AVAILABLE),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_REPORT_SIZE(16),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+
+    // PID Pool (feature, get)
+    HID_USAGE(PID_POOL_REPORT),
+    HID_COLLECTION(HID_COLLECTION_LOGICAL),
+        HID_REPORT_ID(FFB_REPORT_POOL)
+        HID_USAGE(PID_RAM_POOL_SIZE),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0xFFFF, 3),
+        HID_REPORT_SIZE(16),
+        HID_REPORT_COUNT(1),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_SIMULTANEOUS_MAX),
+        HID_LOGICAL_MAX_N(255, 2),
+        HID_REPORT_SIZE(8),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE(PID_DEVICE_MANAGED_POOL),
+        HID_USAGE(PID_SHARED_PARAM_BLOCKS),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_SIZE(1),
+        HID_REPORT_COUNT(2),
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_REPORT_COUNT(6),
+        HID_FEATURE(HID_CONSTANT | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END,
+};
+
+const uint16_t ffbReportDescriptorSize = sizeof(ffbReportDescriptor);
+
+// =============================================================================
+// Effect engine and stepper drive
+// =============================================================================
+// The engine is shared by the TinyUSB task (reports) and the control task
+// (ticks); every access holds the spinlock. Both sides are short.
+
+static FfbEngine engine;
+static portMUX_TYPE engineMux = portMUX_INITIALIZER_UNLOCKED;
+
+static int16_t force[FFB_AXES] = {0};
+static FfbStepDrive drives[FFB_AXES] = {
+    FfbStepDrive(FFB_MAX_STEP_RATE, FFB_RELEASE_FORCE, FFB_TRAVEL_LIMIT),
+    FfbStepDrive(FFB_MAX_STEP_RATE, FFB_RELEASE_FORCE, FFB_TRAVEL_LIMIT)
+};
+static bool engaged = false;
+static FfbStateReport sentState = {0, 0};
+
+// Output report -> first engine tick that sees it
+static volatile int64_t reportPendingUs = 0;
+static ProfileZone reportToForce("ffb.reportToForce", 0);
+
+void initFfb() {
+    portENTER_CRITICAL(&engineMux);
+    engine.reset();
+    portEXIT_CRITICAL(&engineMux);
+    LOG_INFOF("Force feedback: %d effect blocks, %d Hz, max %d steps/s%s",
+              FFB_MAX_EFFECTS, 1000 / SCHED_FFB_PERIOD_MS, FFB_MAX_STEP_RATE,
+              FFB_ENABLED ? "" : " (motors disabled)");
+}
+
+void ffbOutputReport(uint8_t reportId, const uint8_t* data, uint16_t len) {
+    portENTER_CRITICAL(&engineMux);
+    engine.handleOutput(reportId, data, len);
+    portEXIT_CRITICAL(&engineMux);
+    if (reportPendingUs == 0) {
+        reportPendingUs = esp_timer_get_time();
+    }
+}
+
+void ffbSetFeature(uint8_t reportId, const uint8_t* data, uint16_t len) {
+    portENTER_CRITICAL(&engineMux);
+    engine.handleSetFeature(reportId, data, len);
+    portEXIT_CRITICAL(&engineMux);
+}
+
+uint16_t ffbGetFeature(uint8_t reportId, uint8_t* buffer, uint16_t len) {
+    portENTER_CRITICAL(&engineMux);
+    uint16_t written = engine.handleGetFeature(reportId, buffer, len);
+    portEXIT_CRITICAL(&engineMux);
+    return written;
+}
+
+bool ffbStateReportPending(FfbStateReport* report) {
+    portENTER_CRITICAL(&engineMux);
+    *report = engine.stateReport();
+    portEXIT_CRITICAL(&engineMux);
+    return report->status != sentState.status || report->effect != sentState.effect;
+}
+
+void ffbStateReportSent(const FfbStateReport& report) {
+    sentState = report;
+}
+
+// Calibrated axis (0-10000) -> engine position (-10000..10000)
+static int16_t toFfbPosition(int16_t value) {
+    return (int16_t)((value - AXIS_CENTER) * 2);
+}
+
+// One step towards the force if the accumulated force-time allows it
+static void driveAxis(uint8_t axis, int16_t position) {
+    int8_t step = drives[axis].update(force[axis], position);
+    if (step == 0) {
+        return;
+    }
+    if (axis == 0) {
+        stepCyclicX((step > 0) ? (bool)CYCLIC_FEEDBACK_X_DIR_POS : !(bool)CYCLIC_FEEDBACK_X_DIR_POS);
+    } else {
+        stepCyclicY((step > 0) ? (bool)CYCLIC_FEEDBACK_Y_DIR_POS : !(bool)CYCLIC_FEEDBACK_Y_DIR_POS);
+    }
+}
+
+void handleFfb() {
+    int16_t position[FFB_AXES] = {
+        toFfbPosition(state.sensors.cyclicXCalibrated),
+        toFfbPosition(state.sensors.cyclicYCalibrated)
+    };
+
+    portENTER_CRITICAL(&engineMux);
+    engine.tick(position, force);
+    portEXIT_CRITICAL(&engineMux);
+
+    if (reportPendingUs != 0) {
+        reportToForce.record((uint32_t)(esp_timer_get_time() - reportPendingUs));
+        reportPendingUs = 0;
+    }
+
+    // The AP's cyclic feedback and the motor debug page own the steppers
+    // while they are active; without a sensor there is no position to guard
+    bool apOwnsCyclic = state.cyclicFeedbackEnabled && state.autopilot.enabled && isCyclicHeld();
+    if (!FFB_ENABLED || apOwnsCyclic || state.motorDebugActive || !state.sensors.cyclicValid) {
+        engaged = false;
+        drives[0].reset();
+        drives[1].reset();
+        return;
+    }
+
+    // Energise the motors while an effect pushes, with hysteresis
+    int32_t peak = abs(force[0]);
+    if (abs(force[1]) > peak) {
+        peak = abs(force[1]);
+    }
+    if (!engaged && peak >= FFB_ENGAGE_FORCE) {
+        engaged = true;
+    } else if (engaged && peak < FFB_RELEASE_FORCE) {
+        engaged = false;
+    }
+    if (!engaged && !isCyclicHeld()) {
+        drives[0].reset();
+        drives[1].reset();
+        return;
+    }
+
+    driveAxis(0, position[0]);
+    driveAxis(1, position[1]);
+}
+
+bool isFfbEngaged() {
+    return engaged;
+}
+
+FfbStats getFfbStats() {
+    FfbStats s;
+    portENTER_CRITICAL(&engineMux);
+    const FfbEngineStats& e = engine.getStats();
+    s.outputReports = e.outputReports;
+    s.featureReports = e.featureReports;
+    s.badReports = e.badReports;
+    s.effectsCreated = e.effectsCreated;
+    s.poolFull = e.poolFull;
+    s.playing = engine.playingCount();
+    s.actuatorsEnabled = engine.actuatorsEnabled();
+    s.paused = engine.paused();
+    s.deviceGain = engine.deviceGain();
+    portEXIT_CRITICAL(&engineMux);
+
+    s.engaged = engaged;
+    s.forceX = force[0];
+    s.forceY = force[1];
+    s.stepsX = drives[0].getSteps();
+    s.stepsY = drives[1].getSteps();
+    s.reportToForce = reportToForce.summary();
+    return s;
+}
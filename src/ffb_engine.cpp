@@ -0,0 +1,513 @@
+#include "ffb_engine.h"
+#include <string.h>
+
+// Quarter sine wave, 64 segments, Q14
+static const int16_t sineQuarter[65] = {
+    0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196, 3590, 3981, 4370, 4756,
+    5139, 5520, 5897, 6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434,
+    9760, 10080, 10394, 10702, 11003, 11297, 11585, 11866, 12140, 12406, 12665, 12916, 13160,
+    13395, 13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978, 15137, 15286, 15426, 15557,
+    15679, 15791, 15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379, 16384,
+};
+
+int32_t ffbSinQ14(int32_t angle) {
+    angle %= 36000;
+    if (angle < 0) angle += 36000;
+
+    int32_t sign = 1;
+    if (angle >= 18000) {
+        angle -= 18000;
+        sign = -1;
+    }
+    if (angle > 9000) {
+        angle = 18000 - angle;
+    }
+
+    int32_t pos = angle * 64;
+    int32_t idx = pos / 9000;
+    int32_t frac = pos % 9000;
+    int32_t value = sineQuarter[idx];
+    if (idx < 64) {
+        value += (sineQuarter[idx + 1] - sineQuarter[idx]) * frac / 9000;
+    }
+    return sign * value;
+}
+
+static int32_t clampForce(int32_t force, int32_t limit) {
+    if (force > limit) return limit;
+    if (force < -limit) return -limit;
+    return force;
+}
+
+FfbEngine::FfbEngine() {
+    reset();
+}
+
+void FfbEngine::reset() {
+    for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+        effects[i] = FfbEffect();
+    }
+    blockLoad = {0, 3, FFB_MAX_EFFECTS};
+    actuators = false;
+    devicePaused = false;
+    gain = 255;
+    nowMs = 0;
+    lastPlayed = 0;
+    primed = false;
+    for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+        lastPosition[axis] = 0;
+        velocity[axis] = 0;
+        acceleration[axis] = 0;
+    }
+}
+
+FfbEffect* FfbEngine::block(uint8_t blockIndex) {
+    if (blockIndex < 1 || blockIndex > FFB_MAX_EFFECTS) {
+        return nullptr;
+    }
+    return &effects[blockIndex - 1];
+}
+
+void FfbEngine::start(FfbEffect& e, uint8_t loopCount) {
+    e.playing = true;
+    e.loopCount = loopCount;
+    e.startMs = nowMs + e.startDelayMs;
+    lastPlayed = (uint8_t)(&e - effects + 1);
+}
+
+void FfbEngine::stopAll() {
+    for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+        effects[i].playing = false;
+    }
+}
+
+uint8_t FfbEngine::playingCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+        if (effects[i].playing) count++;
+    }
+    return count;
+}
+
+// Copy a packed report payload, rejecting short ones
+template <typename T>
+static bool readReport(T* report, const uint8_t* data, uint16_t len) {
+    if (len < sizeof(T)) {
+        return false;
+    }
+    memcpy(report, data, sizeof(T));
+    return true;
+}
+
+bool FfbEngine::handleOutput(uint8_t reportId, const uint8_t* data, uint16_t len) {
+    bool ok = false;
+
+    switch (reportId) {
+        case FFB_REPORT_SET_EFFECT: {
+            FfbSetEffectReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr || r.effectType == FFB_EFFECT_NONE || r.effectType >= FFB_EFFECT_TYPE_COUNT) {
+                break;
+            }
+            // Hosts that skip Create New Effect claim the block here
+            e->type = (FfbEffectType)r.effectType;
+            e->durationMs = r.durationMs;
+            e->startDelayMs = (r.startDelayMs == FFB_DURATION_INFINITE) ? 0 : r.startDelayMs;
+            e->gain = r.gain;
+            e->enable = r.enable;
+            e->direction = r.direction[0];
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_SET_ENVELOPE: {
+            FfbSetEnvelopeReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr) break;
+            e->attackLevel = r.attackLevel;
+            e->fadeLevel = r.fadeLevel;
+            e->attackTimeMs = r.attackTimeMs;
+            e->fadeTimeMs = r.fadeTimeMs;
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_SET_CONDITION: {
+            FfbSetConditionReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr || (r.parameterBlockOffset & 0x0F) >= FFB_AXES) break;
+            uint8_t axis = r.parameterBlockOffset & 0x0F;
+            FfbCondition& c = e->conditions[axis];
+            c.cpOffset = r.cpOffset;
+            c.positiveCoefficient = r.positiveCoefficient;
+            c.negativeCoefficient = r.negativeCoefficient;
+            // Zero saturation means "not set" - full force
+            c.positiveSaturation = r.positiveSaturation ? r.positiveSaturation : FFB_FORCE_MAX;
+            c.negativeSaturation = r.negativeSaturation ? r.negativeSaturation : FFB_FORCE_MAX;
+            c.deadBand = r.deadBand;
+            if (axis + 1 > e->conditionCount) {
+                e->conditionCount = axis + 1;
+            }
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_SET_PERIODIC: {
+            FfbSetPeriodicReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr) break;
+            e->magnitude = (int16_t)clampForce(r.magnitude, FFB_FORCE_MAX);
+            e->offset = r.offset;
+            e->phase = r.phase;
+            e->periodMs = r.periodMs;
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_SET_CONSTANT: {
+            FfbSetConstantReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr) break;
+            e->magnitude = r.magnitude;
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_SET_RAMP: {
+            FfbSetRampReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr) break;
+            e->rampStart = r.start;
+            e->rampEnd = r.end;
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_EFFECT_OP: {
+            FfbEffectOperationReport r;
+            FfbEffect* e = readReport(&r, data, len) ? block(r.blockIndex) : nullptr;
+            if (e == nullptr || e->type == FFB_EFFECT_NONE) break;
+            switch (r.operation) {
+                case 1: start(*e, r.loopCount); ok = true; break;
+                case 2: stopAll(); start(*e, r.loopCount); ok = true; break;
+                case 3: e->playing = false; ok = true; break;
+                default: break;
+            }
+            break;
+        }
+        case FFB_REPORT_BLOCK_FREE: {
+            if (len < 1) break;
+            if (data[0] == 0xFF) {
+                // All blocks
+                for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+                    effects[i] = FfbEffect();
+                }
+                ok = true;
+                break;
+            }
+            FfbEffect* e = block(data[0]);
+            if (e == nullptr) break;
+            *e = FfbEffect();
+            ok = true;
+            break;
+        }
+        case FFB_REPORT_DEVICE_CONTROL: {
+            if (len < 1) break;
+            ok = true;
+            switch (data[0]) {
+                case 1: actuators = true; break;
+                case 2: actuators = false; break;
+                case 3: stopAll(); break;
+                case 4: {
+                    FfbEngineStats keep = stats;
+                    reset();
+                    stats = keep;
+                    break;
+                }
+                case 5: devicePaused = true; break;
+                case 6: devicePaused = false; break;
+                default: ok = false; break;
+            }
+            break;
+        }
+        case FFB_REPORT_DEVICE_GAIN: {
+            if (len < 1) break;
+            gain = data[0];
+            ok = true;
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (ok) {
+        stats.outputReports++;
+    } else {
+        stats.badReports++;
+    }
+    return ok;
+}
+
+bool FfbEngine::handleSetFeature(uint8_t reportId, const uint8_t* data, uint16_t len) {
+    FfbCreateEffectReport r;
+    if (reportId != FFB_REPORT_CREATE_EFFECT || !readReport(&r, data, len) ||
+        r.effectType == FFB_EFFECT_NONE || r.effectType >= FFB_EFFECT_TYPE_COUNT) {
+        stats.badReports++;
+        return false;
+    }
+    stats.featureReports++;
+
+    uint8_t freeBlocks = 0;
+    uint8_t index = 0;
+    for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+        if (effects[i].type == FFB_EFFECT_NONE) {
+            if (index == 0) index = i + 1;
+            freeBlocks++;
+        }
+    }
+    if (index == 0) {
+        blockLoad = {0, 2, 0};
+        stats.poolFull++;
+        return true;
+    }
+
+    effects[index - 1] = FfbEffect();
+    effects[index - 1].type = (FfbEffectType)r.effectType;
+    blockLoad = {index, 1, (uint16_t)(freeBlocks - 1)};
+    stats.effectsCreated++;
+    return true;
+}
+
+uint16_t FfbEngine::handleGetFeature(uint8_t reportId, uint8_t* buffer, uint16_t len) {
+    switch (reportId) {
+        case FFB_REPORT_BLOCK_LOAD:
+            if (len < sizeof(blockLoad)) return 0;
+            memcpy(buffer, &blockLoad, sizeof(blockLoad));
+            stats.featureReports++;
+            return sizeof(blockLoad);
+        case FFB_REPORT_POOL: {
+            // Pool sizes are counted in effect blocks
+            FfbPoolReport pool = {FFB_MAX_EFFECTS, FFB_MAX_EFFECTS, 0x01};
+            if (len < sizeof(pool)) return 0;
+            memcpy(buffer, &pool, sizeof(pool));
+            stats.featureReports++;
+            return sizeof(pool);
+        }
+        default:
+            stats.badReports++;
+            return 0;
+    }
+}
+
+FfbStateReport FfbEngine::stateReport() const {
+    FfbStateReport r;
+    // Safety switch and actuator power are always on
+    r.status = (devicePaused ? 0x01 : 0) | (actuators ? 0x02 : 0) | 0x04 | 0x10;
+    bool playing = lastPlayed != 0 && effects[lastPlayed - 1].playing;
+    r.effect = (uint8_t)((playing ? 0x01 : 0) | (lastPlayed << 1));
+    return r;
+}
+
+// One smoothing step of a motion estimate toward raw, saturated at +-limit.
+// A remainder under 1 << FFB_VELOCITY_SHIFT is taken whole, so the estimate
+// settles at rest instead of sticking a few units off zero.
+static int32_t smooth(int32_t estimate, int64_t raw, int32_t limit) {
+    int64_t diff = raw - estimate;
+    int64_t step = diff / (1 << FFB_VELOCITY_SHIFT);
+    int64_t value = estimate + (step != 0 ? step : diff);
+    if (value > limit) return limit;
+    if (value < -limit) return -limit;
+    return (int32_t)value;
+}
+
+void FfbEngine::updateMotion(const int16_t position[FFB_AXES]) {
+    const int32_t ticksPerSecond = 1000000 / FFB_ENGINE_TICK_US;
+    for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+        if (!primed) {
+            lastPosition[axis] = position[axis];
+            continue;
+        }
+        // In int64: a position jump (sensor glitch, recalibration, the
+        // sensor coming back) times the tick rate overflows int32. Both
+        // estimates saturate at the full scale of the conditions that use
+        // them; past it the force is the same.
+        int64_t rawSpeed = (int64_t)(position[axis] - lastPosition[axis]) * ticksPerSecond;
+        int32_t lastSpeed = velocity[axis];
+        velocity[axis] = smooth(velocity[axis], rawSpeed, FFB_DAMPER_SPEED);
+        int64_t rawAccel = (int64_t)(velocity[axis] - lastSpeed) * ticksPerSecond;
+        acceleration[axis] = smooth(acceleration[axis], rawAccel, FFB_INERTIA_ACCEL);
+        lastPosition[axis] = position[axis];
+    }
+    primed = true;
+}
+
+// Envelope-shaped magnitude at time t into the current loop
+int32_t FfbEngine::envelope(const FfbEffect& e, uint32_t t, int32_t level) const {
+    if (e.attackTimeMs > 0 && t < e.attackTimeMs) {
+        level = e.attackLevel + (level - e.attackLevel) * (int32_t)t / e.attackTimeMs;
+    }
+    if (e.fadeTimeMs > 0 && e.durationMs != FFB_DURATION_INFINITE &&
+        t + e.fadeTimeMs > e.durationMs) {
+        int32_t remaining = (t < e.durationMs) ? (int32_t)(e.durationMs - t) : 0;
+        level = e.fadeLevel + (level - e.fadeLevel) * remaining / e.fadeTimeMs;
+    }
+    return level;
+}
+
+int32_t FfbEngine::periodic(const FfbEffect& e, uint32_t t) const {
+    int32_t angle = e.phase;
+    if (e.periodMs > 0) {
+        angle += (int32_t)((t % e.periodMs) * 36000 / e.periodMs);
+    }
+    angle %= 36000;
+
+    int32_t amplitude = envelope(e, t, e.magnitude);
+    int32_t wave;  // -10000..10000
+    switch (e.type) {
+        case FFB_EFFECT_SQUARE:
+            wave = (angle < 18000) ? FFB_FORCE_MAX : -FFB_FORCE_MAX;
+            break;
+        case FFB_EFFECT_SINE:
+            wave = ffbSinQ14(angle) * FFB_FORCE_MAX / 16384;
+            break;
+        case FFB_EFFECT_TRIANGLE:
+            if (angle < 9000) wave = angle * FFB_FORCE_MAX / 9000;
+            else if (angle < 27000) wave = (18000 - angle) * FFB_FORCE_MAX / 9000;
+            else wave = (angle - 36000) * FFB_FORCE_MAX / 9000;
+            break;
+        case FFB_EFFECT_SAWTOOTH_UP:
+            wave = (angle - 18000) * FFB_FORCE_MAX / 18000;
+            break;
+        case FFB_EFFECT_SAWTOOTH_DOWN:
+        default:
+            wave = (18000 - angle) * FFB_FORCE_MAX / 18000;
+            break;
+    }
+    return e.offset + amplitude * wave / FFB_FORCE_MAX;
+}
+
+int32_t FfbEngine::condition(const FfbCondition& c, FfbEffectType type, uint8_t axis,
+                             const int16_t position[FFB_AXES]) const {
+    if (type == FFB_EFFECT_FRICTION) {
+        // Constant force against the direction of motion, eased in over
+        // FFB_FRICTION_SPEED so it doesn't chatter at rest
+        int32_t v = velocity[axis];
+        int32_t amount = clampForce(v, FFB_FRICTION_SPEED) * FFB_FORCE_MAX / FFB_FRICTION_SPEED;
+        if (v >= 0) {
+            return clampForce(-c.positiveCoefficient * amount / FFB_FORCE_MAX, c.positiveSaturation);
+        }
+        return clampForce(-c.negativeCoefficient * amount / FFB_FORCE_MAX, c.negativeSaturation);
+    }
+
+    int32_t metric;
+    if (type == FFB_EFFECT_SPRING) {
+        metric = position[axis];
+    } else if (type == FFB_EFFECT_DAMPER) {
+        metric = (int32_t)((int64_t)velocity[axis] * FFB_FORCE_MAX / FFB_DAMPER_SPEED);
+    } else {
+        metric = (int32_t)((int64_t)acceleration[axis] * FFB_FORCE_MAX / FFB_INERTIA_ACCEL);
+    }
+    metric = clampForce(metric, FFB_FORCE_MAX);
+
+    // Force opposes the metric's excursion past the dead band
+    int32_t hi = c.cpOffset + c.deadBand;
+    int32_t lo = c.cpOffset - c.deadBand;
+    if (metric > hi) {
+        return clampForce(-c.positiveCoefficient * (metric - hi) / FFB_FORCE_MAX, c.positiveSaturation);
+    }
+    if (metric < lo) {
+        return clampForce(-c.negativeCoefficient * (metric - lo) / FFB_FORCE_MAX, c.negativeSaturation);
+    }
+    return 0;
+}
+
+void FfbEngine::tick(const int16_t position[FFB_AXES], int16_t force[FFB_AXES]) {
+    stats.ticks++;
+    updateMotion(position);
+
+    int32_t total[FFB_AXES] = {0};
+    for (uint8_t i = 0; i < FFB_MAX_EFFECTS; i++) {
+        FfbEffect& e = effects[i];
+        if (!e.playing || nowMs < e.startMs) {
+            continue;
+        }
+
+        // Time into the current loop; finished effects stop themselves
+        uint32_t t = nowMs - e.startMs;
+        if (e.durationMs != FFB_DURATION_INFINITE && e.durationMs > 0) {
+            uint32_t loop = t / e.durationMs;
+            if (e.loopCount != FFB_LOOP_INFINITE && loop >= (e.loopCount ? e.loopCount : 1)) {
+                e.playing = false;
+                continue;
+            }
+            t %= e.durationMs;
+        }
+
+        int32_t effectForce[FFB_AXES] = {0};
+        if (e.type >= FFB_EFFECT_SPRING) {
+            for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+                if (e.conditionCount == 0 || (!(e.enable & (1 << axis)) && e.conditionCount > 1)) {
+                    continue;
+                }
+                const FfbCondition& c = e.conditions[e.conditionCount > 1 ? axis : 0];
+                effectForce[axis] = condition(c, e.type, axis, position);
+            }
+        } else {
+            int32_t level;
+            if (e.type == FFB_EFFECT_CONSTANT) {
+                level = envelope(e, t, e.magnitude < 0 ? -e.magnitude : e.magnitude);
+                if (e.magnitude < 0) level = -level;
+            } else if (e.type == FFB_EFFECT_RAMP) {
+                level = e.rampStart;
+                if (e.durationMs != FFB_DURATION_INFINITE && e.durationMs > 0) {
+                    level += (e.rampEnd - e.rampStart) * (int32_t)t / e.durationMs;
+                }
+                int32_t magnitude = envelope(e, t, level < 0 ? -level : level);
+                level = (level < 0) ? -magnitude : magnitude;
+            } else {
+                level = periodic(e, t);
+            }
+
+            if (e.enable & 0x04) {
+                // Polar: the force comes from the direction, so it pushes the
+                // stick the opposite way (0 = from the front -> towards +Y)
+                effectForce[0] = -level * ffbSinQ14(e.direction) / 16384;
+                effectForce[1] = level * ffbSinQ14(e.direction + 9000) / 16384;
+            } else {
+                for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+                    if (e.enable & (1 << axis)) effectForce[axis] = level;
+                }
+            }
+        }
+
+        for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+            total[axis] += effectForce[axis] * e.gain / 255;
+        }
+    }
+
+    bool active = actuators && !devicePaused;
+    for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+        force[axis] = active ? (int16_t)clampForce(total[axis] * gain / 255, FFB_FORCE_MAX) : 0;
+    }
+
+    if (!devicePaused) {
+        nowMs += FFB_ENGINE_TICK_US / 1000;
+    }
+}
+
+FfbStepDrive::FfbStepDrive(uint16_t maxStepRate, uint16_t releaseForce, int16_t travelLimit)
+    : maxStepRate(maxStepRate), releaseForce(releaseForce), travelLimit(travelLimit),
+      accumulator(0), steps(0) {
+}
+
+int8_t FfbStepDrive::update(int16_t force, int16_t position) {
+    int32_t f = force;
+    uint32_t magnitude = (uint32_t)(f < 0 ? -f : f);
+    if (magnitude < releaseForce ||
+        (f > 0 && position >= travelLimit) || (f < 0 && position <= -travelLimit)) {
+        accumulator = 0;
+        return 0;
+    }
+
+    accumulator += magnitude * maxStepRate * (FFB_ENGINE_TICK_US / 1000);
+    if (accumulator < (uint32_t)FFB_FORCE_MAX * 1000) {
+        return 0;
+    }
+    accumulator -= (uint32_t)FFB_FORCE_MAX * 1000;
+    steps++;
+    return (f > 0) ? 1 : -1;
+}
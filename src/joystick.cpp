@@ -1,30 +1,105 @@
 #include "joystick.h"
+#include "ffb.h"
 #include "state.h"
-#include <Joystick_ESP32S2.h>
 #include "USB.h"
+#include "USBHID.h"
+#include "tusb.h"
 #include "logger.h"
+#include "config.h"
+#include <esp_timer.h>
 
-// Create joystick instance
-// Parameters: (hidReportId, joystickType, buttonCount, hatSwitchCount, 
-//              includeXAxis, includeYAxis, includeZAxis, includeRxAxis, includeRyAxis, includeRzAxis,
-//              includeRudder, includeThrottle, includeAccelerator, includeBrake, includeSteering)
-Joystick_ Joystick(
-    JOYSTICK_DEFAULT_REPORT_ID,
-    JOYSTICK_TYPE_JOYSTICK,
-    32,     // 32 buttons
-    0,      // 0 hat switches
-    true,   // X axis (Cyclic X)
-    true,   // Y axis (Cyclic Y)
-    true,   // Z axis (Collective)
-    false,  // No Rx
-    false,  // No Ry
-    false,  // No Rz
-    false,  // No rudder
-    false,  // No throttle
-    false,  // No accelerator
-    false,  // No brake
-    false   // No steering
-);
+// =============================================================================
+// HID joystick device
+// =============================================================================
+// Own report descriptor on the core's USBHID interface (1 ms polling
+// interval). Reports are handed straight to TinyUSB without waiting for the
+// transfer; a report that changes while the previous one is still in flight
+// goes out on the first poll after that transfer completes.
+//
+// The force-feedback (PID) reports from ffb.cpp sit inside the joystick's
+// application collection, so hosts see one FFB-capable joystick.
+
+#define HID_REPORT_ID_JOYSTICK 1
+
+// Joystick application collection up to the point where the PID reports go
+static const uint8_t reportDescriptorHead[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_JOYSTICK),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_REPORT_ID(HID_REPORT_ID_JOYSTICK)
+        // X (cyclic X), Y (cyclic Y), Z (collective): full signed 16-bit range
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_X),
+        HID_USAGE(HID_USAGE_DESKTOP_Y),
+        HID_USAGE(HID_USAGE_DESKTOP_Z),
+        HID_LOGICAL_MIN_N(-32767, 2),
+        HID_LOGICAL_MAX_N(32767, 2),
+        HID_REPORT_COUNT(3),
+        HID_REPORT_SIZE(16),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        // 32 buttons
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE_MIN(1),
+        HID_USAGE_MAX(32),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(32),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+};
+
+static const uint8_t reportDescriptorTail[] = {
+    HID_COLLECTION_END
+};
+
+struct __attribute__((packed)) JoystickReport {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint32_t buttons;
+};
+
+class HeliJoystickDevice : public USBHIDDevice {
+public:
+  HeliJoystickDevice() {
+      USBHID::addDevice(this, descriptorSize());
+  }
+
+  uint16_t _onGetDescriptor(uint8_t* buffer) override {
+      memcpy(buffer, reportDescriptorHead, sizeof(reportDescriptorHead));
+      buffer += sizeof(reportDescriptorHead);
+      memcpy(buffer, ffbReportDescriptor, ffbReportDescriptorSize);
+      buffer += ffbReportDescriptorSize;
+      memcpy(buffer, reportDescriptorTail, sizeof(reportDescriptorTail));
+      return descriptorSize();
+  }
+
+  // Force-feedback reports from the host (TinyUSB task)
+  void _onOutput(uint8_t reportId, const uint8_t* buffer, uint16_t len) override {
+      ffbOutputReport(reportId, buffer, len);
+  }
+
+  void _onSetFeature(uint8_t reportId, const uint8_t* buffer, uint16_t len) override {
+      ffbSetFeature(reportId, buffer, len);
+  }
+
+  uint16_t _onGetFeature(uint8_t reportId, uint8_t* buffer, uint16_t len) override {
+      return ffbGetFeature(reportId, buffer, len);
+  }
+
+private:
+  static uint16_t descriptorSize() {
+      return sizeof(reportDescriptorHead) + ffbReportDescriptorSize + sizeof(reportDescriptorTail);
+  }
+};
+
+static USBHID hid;
+static HeliJoystickDevice joystickDevice;
+
+// Axis units (AXIS_MIN..AXIS_MAX) -> HID logical range (-32767..32767)
+static int16_t toHidAxis(int16_t value) {
+    return (int16_t)((int32_t)(value - AXIS_MIN) * 65534 / (AXIS_MAX - AXIS_MIN) - 32767);
+}
 
 // State is in global state.joystick
 
@@ -33,34 +108,102 @@ static unsigned long lastUpdateTime = 0;
 static float animationPhase = 0.0f;
 
 void initJoystick() {
-    // Configure USB device name BEFORE starting joystick
+    // Configure USB device name and register the HID interface BEFORE starting USB
     USB.productName("esp-heli-v1");
     USB.manufacturerName("ESP32");
+    hid.begin();
     USB.begin();
-    
-    // Set axis ranges (0 to 10000 for 16-bit precision)
-    Joystick.setXAxisRange(AXIS_MIN, AXIS_MAX);
-    Joystick.setYAxisRange(AXIS_MIN, AXIS_MAX);
-    Joystick.setZAxisRange(AXIS_MIN, AXIS_MAX);
-    
-    // Begin joystick with manual send mode (false = disable AutoSendState)
-    Joystick.begin(false);
 
-    // Initialize state and HID to center position
+    // Initialize state to center position (sent as the first report)
     state.joystick.cyclicX = AXIS_CENTER;
     state.joystick.cyclicY = AXIS_CENTER;
     state.joystick.collective = AXIS_CENTER;
-    Joystick.setXAxis(AXIS_CENTER);
-    Joystick.setYAxis(AXIS_CENTER);
-    Joystick.setZAxis(AXIS_CENTER);
     
     LOG_INFO("USB HID Joystick initialized: esp-heli-v1");
     LOG_INFO("3 axes (Cyclic X, Cyclic Y, Collective) + 32 buttons");
 }
 
 static bool joystickDirty = true; // Start true to send initial state
+static int64_t dirtySinceUs = 0;   // When the state first differed from the last report (0 = initial state)
+
+// Report path statistics
+static HidStats hidStats;
+static uint32_t rateWindowReports = 0;
+static int64_t rateWindowStartUs = 0;
+static ProfileZone sendLatency("hid.send", 0);  // State change -> report handed to USB
+
+static void markDirty() {
+    if (!joystickDirty) {
+        joystickDirty = true;
+        dirtySinceUs = esp_timer_get_time();
+    }
+}
+
+// Latency tracing: timestamp/source of the sample behind each axis value that
+// has not been reported yet (0 = nothing pending or untraced). The AP path
+// includes PID sample time, so these zones never log SLOW warnings.
+static int64_t pendingSampleUs[JOYSTICK_AXIS_COUNT] = {0};
+static AxisSource pendingSource[JOYSTICK_AXIS_COUNT];
+
+static ProfileZone latencyCyclicX("latency.cyclicX", 0);
+static ProfileZone latencyCyclicY("latency.cyclicY", 0);
+static ProfileZone latencyCollective("latency.collective", 0);
+static ProfileZone latencyCyclicSensor("latency.src.cyclicSensor", 0);
+static ProfileZone latencyCollectiveSensor("latency.src.collectiveI2C", 0);
+static ProfileZone latencyAutopilot("latency.src.autopilot", 0);
+
+static ProfileZone* const axisLatency[JOYSTICK_AXIS_COUNT] = {
+    &latencyCyclicX, &latencyCyclicY, &latencyCollective
+};
+static ProfileZone* const sourceLatency[SOURCE_COUNT] = {
+    &latencyCyclicSensor, &latencyCollectiveSensor, &latencyAutopilot
+};
+
+// Report suppression: small changes (sensor noise) are held back instead of
+// triggering a report. A held value goes out once it has been held for
+// HID_SUPPRESS_SETTLE_MS, so the reported value always ends up exact.
+struct AxisSuppression {
+    int8_t lastDir = 0;        // Direction of the last reported change (-1, 0, +1)
+    bool held = false;         // A value differing from the reported one is held back
+    int16_t heldValue = 0;
+    AxisSource heldSource = SOURCE_COUNT;
+    int64_t heldSampleUs = 0;
+    unsigned long heldSinceMs = 0;
+};
+static AxisSuppression suppression[JOYSTICK_AXIS_COUNT];
+static AxisReportStats reportStats[JOYSTICK_AXIS_COUNT];
+static uint32_t reportsSent = 0;
+
+static const int16_t minChange[JOYSTICK_AXIS_COUNT] = {
+    HID_CYCLIC_MIN_CHANGE, HID_CYCLIC_MIN_CHANGE, HID_COLLECTIVE_MIN_CHANGE
+};
+static const int16_t hysteresis[JOYSTICK_AXIS_COUNT] = {
+    HID_CYCLIC_HYSTERESIS, HID_CYCLIC_HYSTERESIS, HID_COLLECTIVE_HYSTERESIS
+};
+
+static int16_t* axisValue(uint8_t axis) {
+    switch (axis) {
+        case AXIS_CYCLIC_X: return &state.joystick.cyclicX;
+        case AXIS_CYCLIC_Y: return &state.joystick.cyclicY;
+        case AXIS_COLLECTIVE: return &state.joystick.collective;
+        default: return nullptr;
+    }
+}
+
+// Put a value into the next report
+static void reportAxis(uint8_t axis, int16_t value, AxisSource source, int64_t sampleUs) {
+    int16_t* currentVal = axisValue(axis);
+    suppression[axis].lastDir = (value > *currentVal) ? 1 : -1;
+    suppression[axis].held = false;
+    *currentVal = value;
+    markDirty();
+
+    // Newer sample supersedes any unreported one
+    pendingSampleUs[axis] = (source < SOURCE_COUNT) ? sampleUs : 0;
+    pendingSource[axis] = source;
+}
 
-void setJoystickAxis(uint8_t axis, int16_t value) {
+void setJoystickAxis(uint8_t axis, int16_t value, AxisSource source, int64_t sampleUs) {
     if (axis >= JOYSTICK_AXIS_COUNT) return;
     
     // Clamp value to valid range
@@ -68,22 +211,32 @@ void setJoystickAxis(uint8_t axis, int16_t value) {
     if (value > AXIS_MAX) value = AXIS_MAX;
     
     // Check if value actually changed
-    int16_t* currentVal = nullptr;
-    switch (axis) {
-        case AXIS_CYCLIC_X: currentVal = &state.joystick.cyclicX; break;
-        case AXIS_CYCLIC_Y: currentVal = &state.joystick.cyclicY; break;
-        case AXIS_COLLECTIVE: currentVal = &state.joystick.collective; break;
+    AxisSuppression& s = suppression[axis];
+    int16_t delta = value - *axisValue(axis);
+    if (delta == 0) {
+        s.held = false;  // Back at the reported value - nothing to settle
+        return;
     }
 
-    if (currentVal && *currentVal != value) {
-        *currentVal = value;
-        joystickDirty = true;
-        
-        // Update joystick internal state
-        if (axis == AXIS_CYCLIC_X) Joystick.setXAxis(value);
-        else if (axis == AXIS_CYCLIC_Y) Joystick.setYAxis(value);
-        else if (axis == AXIS_COLLECTIVE) Joystick.setZAxis(value);
+    // Keep moving the same way: min change. Reverse: the hysteresis band.
+    int8_t dir = (delta > 0) ? 1 : -1;
+    int16_t needed = (s.lastDir == 0 || dir == s.lastDir) ? minChange[axis] : hysteresis[axis];
+    if (abs(delta) >= needed) {
+        reportAxis(axis, value, source, sampleUs);
+        reportStats[axis].sent++;
+        return;
+    }
+
+    // Hold back; updateJoystick() sends it if it is still pending after the
+    // settle time
+    if (!s.held) {
+        s.held = true;
+        s.heldSinceMs = millis();
     }
+    s.heldValue = value;
+    s.heldSource = source;
+    s.heldSampleUs = sampleUs;
+    reportStats[axis].suppressed++;
 }
 
 void setJoystickButton(uint8_t button, bool pressed) {
@@ -98,31 +251,86 @@ void setJoystickButton(uint8_t button, bool pressed) {
             } else {
                 state.joystick.buttons &= ~mask;
             }
-            
-            // Update joystick internal state
-            Joystick.setButton(button, pressed);
-            joystickDirty = true;
+            markDirty();
         }
     }
 }
 
-// Rate limit joystick updates to 100Hz (10ms)
-// Note: Errors in logs ("wait failed") can be ignored as long as joy.cpl works.
-// The dirty flag logic below helps minimize these by only sending on actual movement.
-static unsigned long lastHidSendMs = 0;
-#define HID_SEND_INTERVAL_MS 10
+// Force-feedback PID State input report, when it changed and the endpoint is free
+static void sendFfbState() {
+    FfbStateReport pidState;
+    if (!ffbStateReportPending(&pidState) || !tud_mounted() || tud_suspended() ||
+        !tud_hid_n_ready(0)) {
+        return;
+    }
+    if (tud_hid_n_report(0, FFB_REPORT_STATE, &pidState, sizeof(pidState))) {
+        ffbStateReportSent(pidState);
+    }
+}
 
+// Called every control tick (1 ms). A changed state is handed to TinyUSB as
+// soon as the endpoint is free, so it goes out on the next 1 ms poll; report
+// suppression in setJoystickAxis() keeps noise from sending every poll.
 void updateJoystick() {
     unsigned long now = millis();
-    if (now - lastHidSendMs >= HID_SEND_INTERVAL_MS) {
-        lastHidSendMs = now;
-        
-        // Only send if state has changed
-        if (joystickDirty) {
-            Joystick.sendState();
-            joystickDirty = false;
+
+    // Held-back values that have settled go into the next report
+    for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; axis++) {
+        AxisSuppression& s = suppression[axis];
+        if (s.held && now - s.heldSinceMs >= HID_SUPPRESS_SETTLE_MS) {
+            reportAxis(axis, s.heldValue, s.heldSource, s.heldSampleUs);
+            reportStats[axis].settled++;
         }
     }
+
+    // Only send if state has changed, and only to a host that is listening.
+    // PID state changes (effect started/stopped) use ticks without a
+    // joystick report.
+    if (!joystickDirty) {
+        sendFfbState();
+        return;
+    }
+    if (!tud_mounted() || tud_suspended()) {
+        return;
+    }
+    if (!tud_hid_n_ready(0)) {
+        hidStats.busy++;  // Previous report still in flight - retry next tick
+        return;
+    }
+
+    JoystickReport report;
+    report.x = toHidAxis(state.joystick.cyclicX);
+    report.y = toHidAxis(state.joystick.cyclicY);
+    report.z = toHidAxis(state.joystick.collective);
+    report.buttons = state.joystick.buttons;
+    if (!tud_hid_n_report(0, HID_REPORT_ID_JOYSTICK, &report, sizeof(report))) {
+        hidStats.failed++;
+        return;
+    }
+    joystickDirty = false;
+    reportsSent++;
+
+    // Sample-to-report latency for every axis carried by this report
+    int64_t sentUs = esp_timer_get_time();
+    // The initial state waits for enumeration, not for the report path
+    if (dirtySinceUs != 0) {
+        sendLatency.record((uint32_t)(sentUs - dirtySinceUs));
+    }
+    for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; axis++) {
+        if (pendingSampleUs[axis] != 0) {
+            uint32_t latency = (uint32_t)(sentUs - pendingSampleUs[axis]);
+            axisLatency[axis]->record(latency);
+            sourceLatency[pendingSource[axis]]->record(latency);
+            pendingSampleUs[axis] = 0;
+        }
+    }
+
+    rateWindowReports++;
+    if (sentUs - rateWindowStartUs >= 1000000) {
+        hidStats.rateHz = (uint32_t)((int64_t)rateWindowReports * 1000000 / (sentUs - rateWindowStartUs));
+        rateWindowStartUs = sentUs;
+        rateWindowReports = 0;
+    }
 }
 
 int16_t getJoystickAxis(uint8_t axis) {
@@ -135,6 +343,32 @@ int16_t getJoystickAxis(uint8_t axis) {
     }
 }
 
+AxisReportStats getAxisReportStats(uint8_t axis) {
+    if (axis >= JOYSTICK_AXIS_COUNT) return AxisReportStats();
+    return reportStats[axis];
+}
+
+HidStats getHidStats() {
+    HidStats s = hidStats;
+    s.reports = reportsSent;
+    // No reports for a while (idle stick) means no rate
+    if (esp_timer_get_time() - rateWindowStartUs > 2000000) {
+        s.rateHz = 0;
+    }
+    s.sendLatency = sendLatency.summary();
+    return s;
+}
+
+ProfileSummary getAxisLatency(uint8_t axis) {
+    if (axis >= JOYSTICK_AXIS_COUNT) return ProfileSummary();
+    return axisLatency[axis]->summary();
+}
+
+ProfileSummary getSourceLatency(AxisSource source) {
+    if (source >= SOURCE_COUNT) return ProfileSummary();
+    return sourceLatency[source]->summary();
+}
+
 bool getJoystickButton(uint8_t button) {
     if (button < JOYSTICK_BUTTON_COUNT) {
         return (state.joystick.buttons & (1UL << button)) != 0;
@@ -0,0 +1,94 @@
+#include "link_monitor.h"
+#include <esp_timer.h>
+
+// Histogram and rate are written by the control task and read by the web task
+static portMUX_TYPE linkMux = portMUX_INITIALIZER_UNLOCKED;
+
+LinkMonitor* LinkMonitor::head = nullptr;
+
+// Links
+LinkMonitor cyclicLink("cyclic");
+LinkMonitor simulatorLink("simulator");
+LinkMonitor simulatorUsbLink("simulatorUsb");
+LinkMonitor simulatorUdpLink("simulatorUdp");
+LinkMonitor xplaneLink("xplane");
+
+LinkMonitor::LinkMonitor(const char* name) : name(name), next(nullptr) {
+    reset();
+
+    LinkMonitor** link = &head;
+    while (*link != nullptr) {
+        link = &(*link)->next;
+    }
+    *link = this;
+}
+
+void LinkMonitor::reset() {
+    portENTER_CRITICAL(&linkMux);
+    counters = LinkCounters();
+    gaps.reset();
+    lastFrameUs = 0;
+    windowStartUs = 0;
+    windowFrames = 0;
+    rateHz = 0;
+    portEXIT_CRITICAL(&linkMux);
+}
+
+void LinkMonitor::frameReceived(int64_t arrivalUs) {
+    counters.goodFrames++;
+
+    portENTER_CRITICAL(&linkMux);
+    if (lastFrameUs != 0 && arrivalUs >= lastFrameUs) {
+        gaps.record((uint32_t)(arrivalUs - lastFrameUs));
+    }
+    lastFrameUs = arrivalUs;
+
+    if (windowStartUs == 0) {
+        windowStartUs = arrivalUs;
+    }
+    windowFrames++;
+    int64_t elapsed = arrivalUs - windowStartUs;
+    if (elapsed >= LINK_RATE_WINDOW_US) {
+        rateHz = (uint32_t)((int64_t)windowFrames * 1000000 / elapsed);
+        windowStartUs = arrivalUs;
+        windowFrames = 0;
+    }
+    portEXIT_CRITICAL(&linkMux);
+}
+
+void LinkMonitor::attachUart(HardwareSerial& serial) {
+    // Runs in the UART driver's event task
+    serial.onReceiveError([this](hardwareSerial_error_t err) {
+        switch (err) {
+            case UART_BUFFER_FULL_ERROR:
+            case UART_FIFO_OVF_ERROR:
+                counters.lineOverflows++;
+                break;
+            case UART_BREAK_ERROR:
+            case UART_FRAME_ERROR:
+            case UART_PARITY_ERROR:
+                counters.uartErrors++;
+                break;
+            default:
+                break;
+        }
+    });
+}
+
+uint32_t LinkMonitor::getRateHz() const {
+    portENTER_CRITICAL(&linkMux);
+    // A link that went quiet has no rate, whatever the last window said
+    bool stale = lastFrameUs == 0 || esp_timer_get_time() - lastFrameUs > 2 * LINK_RATE_WINDOW_US;
+    uint32_t hz = stale ? 0 : rateHz;
+    portEXIT_CRITICAL(&linkMux);
+    return hz;
+}
+
+ProfileSummary LinkMonitor::getInterArrival() const {
+    ProfileSummary s;
+    s.name = name;
+    portENTER_CRITICAL(&linkMux);
+    gaps.summarize(s);
+    portEXIT_CRITICAL(&linkMux);
+    return s;
+}
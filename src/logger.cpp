@@ -5,34 +5,45 @@
 // Global logger instance
 Logger logger;
 
-Logger::Logger() : maxEntries(LOG_BUFFER_SIZE) {}
+Logger::Logger() : maxEntries(LOG_BUFFER_SIZE), mutex(NULL) {}
 
 void Logger::begin(size_t maxEntries) {
   this->maxEntries = maxEntries;
   entries.reserve(maxEntries);
+  mutex = xSemaphoreCreateMutex();
 }
 
 void Logger::log(LogLevel level, const String& message) {
   unsigned long now = millis();
   String timestamp = formatTimestamp(now);
   String levelName = getLevelName(level);
-  
-  // Always output to Serial
-  Serial.printf("[%s] %s: %s\n", timestamp.c_str(), levelName, message.c_str());
+
+  // Always output to Serial: the whole line in one write, outside the lock.
+  // The UART driver keeps a single write together, so lines from different
+  // tasks don't interleave, and the control task never waits on the mutex
+  // while another task's line drains.
+  String line = "[" + timestamp + "] " + levelName + ": " + message + "\n";
+  Serial.write((const uint8_t*)line.c_str(), line.length());
   
   // Store in memory only if level >= INFO
-  if (level >= LOG_LEVEL_INFO) {
-    LogEntry entry;
-    entry.timestamp = now;
-    entry.level = level;
-    entry.message = message;
-    
-    // Add to circular buffer
-    if (entries.size() >= maxEntries) {
-      entries.erase(entries.begin());  // Remove oldest entry
-    }
-    entries.push_back(entry);
+  if (level < LOG_LEVEL_INFO) {
+    return;
+  }
+
+  LogEntry entry;
+  entry.timestamp = now;
+  entry.level = level;
+  entry.message = message;
+
+  if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
+
+  // Add to circular buffer
+  if (entries.size() >= maxEntries) {
+    entries.erase(entries.begin());  // Remove oldest entry
   }
+  entries.push_back(entry);
+
+  if (mutex) xSemaphoreGive(mutex);
 }
 
 String Logger::formatTimestamp(unsigned long millis) const {
@@ -127,6 +138,8 @@ void Logger::errorf(const char* format, ...) {
 
 String Logger::getEntriesJSON() const {
   String json = "[";
+
+  if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
   
   for (size_t i = 0; i < entries.size(); i++) {
     if (i > 0) json += ",";
@@ -146,10 +159,19 @@ String Logger::getEntriesJSON() const {
     json += "}";
   }
   
+  if (mutex) xSemaphoreGive(mutex);
+
   json += "]";
   return json;
 }
 
 void Logger::clear() {
+  if (mutex) xSemaphoreTake(mutex, portMAX_DELAY);
   entries.clear();
+  if (mutex) xSemaphoreGive(mutex);
+}
+
+void Logger::writeSerial(const uint8_t* data, size_t len) {
+  // One write, like a log line: the UART driver keeps it together
+  Serial.write(data, len);
 }
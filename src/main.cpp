@@ -7,21 +7,28 @@
 #include "buttons.h"
 #include "cyclic_serial.h"
 #include "simulator_serial.h"
+#include "sim_udp.h"
+#include "sim_feed.h"
 #include "collective.h"
 #include "buzzer.h"
 #include "steppers.h"
 #include "ap.h"
 #include "cyclic_feedback.h"
-#include "profile.h"
+#include "ffb.h"
+#include "scheduler.h"
+
+static void logHeartbeat() {
+  LOG_DEBUGF("Heartbeat: %lu ms", millis());
+}
 
 void setup() {
-  // Initialize Serial for debugging
+  // Initialize Serial for debugging; the TX buffer must be set before begin()
+  Serial.setTxBufferSize(LOG_SERIAL_TX_BUFFER);
   Serial.begin(115200);
   delay(1000);
   
   // Initialize logger
   logger.begin(LOG_BUFFER_SIZE);
-  initProfile();
   
   LOG_INFO("=== ESP32 Heli Joystick ===");
   
@@ -52,6 +59,9 @@ void setup() {
   // Initialize cyclic feedback (steppers chase joystick when AP + cyclic held)
   initCyclicFeedback();
 
+  // Initialize force feedback (host effects drive the cyclic steppers)
+  initFfb();
+
   // Initialize status LED
   initStatusLED();
   
@@ -62,6 +72,10 @@ void setup() {
   // Initialize WiFi and web server
   initWebServer();
   startWebServerTask();  // Run web/OTA in background task (low priority)
+
+  // Simulator data over WiFi (needs the network stack started above)
+  initSimulatorUdp();
+  initSimFeed();
   
   // Set LED status based on WiFi state
   if (!isWiFiEnabled()) {
@@ -75,6 +89,27 @@ void setup() {
     LOG_WARN("LED: Red (WiFi Connection Failed)");
   }
   
+  // Control task: sensor input -> AP -> HID (order = run order within a tick)
+  controlScheduler.addTask("buttons", handleButtons, SCHED_BUTTONS_PERIOD_MS, 0);
+  controlScheduler.addTask("cyclicSerial", handleCyclicSerial, SCHED_CYCLIC_SERIAL_PERIOD_MS, 0);
+  controlScheduler.addTask("simulator", handleSimulatorSerial, SCHED_SIMULATOR_PERIOD_MS, 1);
+  controlScheduler.addTask("collective", handleCollective, SCHED_COLLECTIVE_PERIOD_MS, 0);
+  controlScheduler.addTask("ap", handleAP, SCHED_AP_PERIOD_MS, 0);
+  controlScheduler.addTask("steppers", handleSteppers, SCHED_STEPPERS_PERIOD_MS, 0);
+  controlScheduler.addTask("cyclicFeedback", handleCyclicFeedback, SCHED_CYCLIC_FEEDBACK_PERIOD_MS, 0);
+  controlScheduler.addTask("ffb", handleFfb, SCHED_FFB_PERIOD_MS, 0);
+  controlScheduler.addTask("joystick", updateJoystick, SCHED_JOYSTICK_PERIOD_MS, 0);
+
+  // Housekeeping task: everything that may take its time
+  housekeepingScheduler.addTask("buzzer", handleBuzzer, SCHED_BUZZER_PERIOD_MS, 0);
+  housekeepingScheduler.addTask("statusLed", updateStatusLED, SCHED_STATUS_LED_PERIOD_MS, 10);
+  housekeepingScheduler.addTask("heartbeat", logHeartbeat, SCHED_HEARTBEAT_PERIOD_MS, 0);
+  housekeepingScheduler.addTask("simFeed", handleSimFeed, SCHED_SIM_FEED_PERIOD_MS, 0);
+  housekeepingScheduler.addTask("xplane", handleXPlane, SCHED_XPLANE_PERIOD_MS, 0);
+
+  controlScheduler.startTask(CONTROL_TASK_STACK, CONTROL_TASK_PRIORITY, CONTROL_TASK_CORE);
+  housekeepingScheduler.startTask(HOUSEKEEPING_TASK_STACK, HOUSEKEEPING_TASK_PRIORITY, HOUSEKEEPING_TASK_CORE);
+
   LOG_INFO("=== System Ready ===");
   
   // Double beep to indicate system is ready
@@ -82,53 +117,6 @@ void setup() {
 }
 
 void loop() {
-  static unsigned long lastHeartbeat = 0;
-  unsigned long now = millis();
-
-  profileStart(PROFILE_BUTTONS);
-  handleButtons();
-  profileEnd(PROFILE_BUTTONS);
-
-  profileStart(PROFILE_CYCLIC_SERIAL);
-  handleCyclicSerial();
-  profileEnd(PROFILE_CYCLIC_SERIAL);
-
-  profileStart(PROFILE_SIMULATOR);
-  handleSimulatorSerial();
-  profileEnd(PROFILE_SIMULATOR);
-
-  profileStart(PROFILE_COLLECTIVE);
-  handleCollective();
-  profileEnd(PROFILE_COLLECTIVE);
-
-  profileStart(PROFILE_AP);
-  handleAP();
-  profileEnd(PROFILE_AP);
-
-  profileStart(PROFILE_STEPPERS);
-  handleSteppers();
-  profileEnd(PROFILE_STEPPERS);
-
-  profileStart(PROFILE_CYCLIC_FEEDBACK);
-  handleCyclicFeedback();
-  profileEnd(PROFILE_CYCLIC_FEEDBACK);
-
-  profileStart(PROFILE_BUZZER);
-  handleBuzzer();
-  profileEnd(PROFILE_BUZZER);
-
-  profileStart(PROFILE_JOYSTICK);
-  updateJoystick();
-  profileEnd(PROFILE_JOYSTICK);
-
-  profileStart(PROFILE_STATUS_LED);
-  updateStatusLED();
-  profileEnd(PROFILE_STATUS_LED);
-
-  if (now - lastHeartbeat >= 2000) {
-    lastHeartbeat = now;
-    LOG_DEBUGF("Heartbeat: %lu ms", now);
-  }
-  
-  delay(10);
+  // All work runs in the scheduler tasks - the Arduino loop task is not needed
+  vTaskDelete(NULL);
 }
@@ -1,62 +1,152 @@
 #include "profile.h"
 #include "config.h"
 #include "logger.h"
+#include <esp_timer.h>
 
-#define PROFILE_SLOW_MS 50  // Log when any task exceeds this
-
-struct SlotInfo {
-    const char* name;
-    unsigned long lastMs;
-    unsigned long maxMs;
-    unsigned long startMs;
-};
-
-static SlotInfo slots[PROFILE_SLOT_COUNT] = {
-    {"buttons", 0, 0, 0},
-    {"cyclicSerial", 0, 0, 0},
-    {"simulator", 0, 0, 0},
-    {"collective", 0, 0, 0},
-    {"ap", 0, 0, 0},
-    {"steppers", 0, 0, 0},
-    {"cyclicFeedback", 0, 0, 0},
-    {"buzzer", 0, 0, 0},
-    {"joystick", 0, 0, 0},
-    {"statusLed", 0, 0, 0},
-};
-
-void initProfile() {
-    for (int i = 0; i < PROFILE_SLOT_COUNT; i++) {
-        slots[i].lastMs = 0;
-        slots[i].maxMs = 0;
-        slots[i].startMs = 0;
+// Zones are recorded from the control, housekeeping and web tasks; one
+// spinlock keeps the histogram updates and the registry consistent.
+static portMUX_TYPE profileMux = portMUX_INITIALIZER_UNLOCKED;
+
+ProfileZone* ProfileZone::head = nullptr;
+
+// -----------------------------------------------------------------------------
+// Histogram bucketing: values below 2^SUB_BITS get exact buckets, above that
+// each power of two is split into 2^SUB_BITS equal sub-buckets.
+// -----------------------------------------------------------------------------
+
+static uint32_t bucketIndex(uint32_t us) {
+    const uint32_t sub = 1u << PROFILE_HIST_SUB_BITS;
+    if (us < sub) {
+        return us;
     }
+    uint32_t msb = 31 - __builtin_clz(us);
+    uint32_t idx = ((msb - PROFILE_HIST_SUB_BITS + 1) << PROFILE_HIST_SUB_BITS) |
+                   ((us >> (msb - PROFILE_HIST_SUB_BITS)) & (sub - 1));
+    return (idx < PROFILE_HIST_BUCKETS) ? idx : PROFILE_HIST_BUCKETS - 1;
+}
+
+static uint32_t bucketMidpoint(uint32_t idx) {
+    const uint32_t sub = 1u << PROFILE_HIST_SUB_BITS;
+    if (idx < sub) {
+        return idx;
+    }
+    uint32_t msb = (idx >> PROFILE_HIST_SUB_BITS) + PROFILE_HIST_SUB_BITS - 1;
+    uint32_t shift = msb - PROFILE_HIST_SUB_BITS;
+    uint32_t low = (1u << msb) | ((idx & (sub - 1)) << shift);
+    return low + ((1u << shift) >> 1);
+}
+
+// -----------------------------------------------------------------------------
+// ProfileStats
+// -----------------------------------------------------------------------------
+
+void ProfileStats::reset() {
+    count = 0;
+    lastUs = 0;
+    minUs = UINT32_MAX;
+    maxUs = 0;
+    totalUs = 0;
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void ProfileStats::record(uint32_t us) {
+    count++;
+    lastUs = us;
+    if (us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+    totalUs += us;
+    buckets[bucketIndex(us)]++;
 }
 
-void profileStart(uint8_t slot) {
-    if (slot >= PROFILE_SLOT_COUNT) return;
-    slots[slot].startMs = millis();
+uint32_t ProfileStats::avgUs() const {
+    return count ? (uint32_t)(totalUs / count) : 0;
 }
 
-void profileEnd(uint8_t slot) {
-    if (slot >= PROFILE_SLOT_COUNT) return;
-    unsigned long d = millis() - slots[slot].startMs;
-    slots[slot].lastMs = d;
-    if (d > slots[slot].maxMs) {
-        slots[slot].maxMs = d;
+uint32_t ProfileStats::percentileUs(float q) const {
+    if (count == 0) {
+        return 0;
     }
-    if (d > PROFILE_SLOW_MS) {
-        LOG_WARNF("SLOW: %s took %lu ms", slots[slot].name, d);
+    uint32_t target = (uint32_t)ceilf(q * (float)count);
+    if (target < 1) target = 1;
+    if (target > count) target = count;
+
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < PROFILE_HIST_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // Bucket midpoint, but never outside what was actually observed
+            uint32_t v = bucketMidpoint(i);
+            if (v < minUs) v = minUs;
+            if (v > maxUs) v = maxUs;
+            return v;
+        }
     }
+    return maxUs;
 }
 
-unsigned long profileGetLastMs(uint8_t slot) {
-    return (slot < PROFILE_SLOT_COUNT) ? slots[slot].lastMs : 0;
+void ProfileStats::summarize(ProfileSummary& s) const {
+    s.count = count;
+    s.lastUs = lastUs;
+    s.minUs = count ? minUs : 0;
+    s.avgUs = avgUs();
+    s.maxUs = maxUs;
+    s.p50Us = percentileUs(0.50f);
+    s.p95Us = percentileUs(0.95f);
+    s.p99Us = percentileUs(0.99f);
+    s.p999Us = percentileUs(0.999f);
 }
 
-unsigned long profileGetMaxMs(uint8_t slot) {
-    return (slot < PROFILE_SLOT_COUNT) ? slots[slot].maxMs : 0;
+// -----------------------------------------------------------------------------
+// ProfileZone / ProfileScope
+// -----------------------------------------------------------------------------
+
+ProfileZone::ProfileZone(const char* name, uint32_t slowUs)
+    : name(name), slowUs(slowUs), next(nullptr) {
+    stats.reset();
+
+    // Append so the debug API lists zones in order of first use
+    portENTER_CRITICAL(&profileMux);
+    ProfileZone** link = &head;
+    while (*link != nullptr) {
+        link = &(*link)->next;
+    }
+    *link = this;
+    portEXIT_CRITICAL(&profileMux);
+}
+
+void ProfileZone::record(uint32_t us) {
+    portENTER_CRITICAL(&profileMux);
+    stats.record(us);
+    portEXIT_CRITICAL(&profileMux);
+
+    if (slowUs != 0 && us > slowUs) {
+        LOG_WARNF("SLOW: %s took %lu us", name, us);
+    }
+}
+
+void ProfileZone::reset() {
+    portENTER_CRITICAL(&profileMux);
+    stats.reset();
+    portEXIT_CRITICAL(&profileMux);
 }
 
-const char* profileGetName(uint8_t slot) {
-    return (slot < PROFILE_SLOT_COUNT) ? slots[slot].name : "";
+ProfileSummary ProfileZone::summary() const {
+    ProfileSummary s;
+    s.name = name;
+    portENTER_CRITICAL(&profileMux);
+    stats.summarize(s);
+    portEXIT_CRITICAL(&profileMux);
+    return s;
+}
+
+ProfileScope::ProfileScope(ProfileZone& zone) : zone(zone), startUs(esp_timer_get_time()) {}
+
+ProfileScope::~ProfileScope() {
+    zone.record((uint32_t)(esp_timer_get_time() - startUs));
+}
+
+void profileResetAll() {
+    for (ProfileZone* z = ProfileZone::first(); z != nullptr; z = z->getNext()) {
+        z->reset();
+    }
 }
@@ -0,0 +1,121 @@
+#include "response_curve.h"
+#include "joystick.h"
+#include <string.h>
+
+ResponseCurve::ResponseCurve() : builtRevision(0), linear(true) {
+    for (int i = 0; i <= RESPONSE_CURVE_SEGMENTS; i++) {
+        table[i] = (int16_t)(AXIS_MIN + (int32_t)i * (AXIS_MAX - AXIS_MIN) / RESPONSE_CURVE_SEGMENTS);
+    }
+}
+
+// Curve value at input x (axis units), in axis units
+static float evaluate(const ResponseCurveSettings& s, float x) {
+    const float range = (float)(AXIS_MAX - AXIS_MIN);
+    float a = s.amount;
+    if (a < 0.0f) a = 0.0f;
+    if (a > 1.0f) a = 1.0f;
+
+    switch (s.type) {
+        case CURVE_EXPO: {
+            float c = (x - AXIS_CENTER) / (range / 2);
+            float y = (1.0f - a) * c + a * c * c * c;
+            return AXIS_CENTER + y * (range / 2);
+        }
+        case CURVE_SCURVE: {
+            float u = (x - AXIS_MIN) / range;
+            float y = (1.0f - a) * u + a * u * u * (3.0f - 2.0f * u);
+            return AXIS_MIN + y * range;
+        }
+        case CURVE_POINTS: {
+            const ResponseCurvePoint* p = s.points;
+            uint8_t n = s.pointCount;
+            if (x <= p[0].in) {
+                return p[0].out;
+            }
+            for (uint8_t i = 1; i < n; i++) {
+                if (x <= p[i].in) {
+                    float t = (x - p[i - 1].in) / (float)(p[i].in - p[i - 1].in);
+                    return p[i - 1].out + t * (p[i].out - p[i - 1].out);
+                }
+            }
+            return p[n - 1].out;
+        }
+        case CURVE_LINEAR:
+        default:
+            return x;
+    }
+}
+
+void ResponseCurve::build(const ResponseCurveSettings& settings) {
+    builtRevision = settings.revision;
+    linear = settings.type == CURVE_LINEAR ||
+             (settings.type != CURVE_POINTS && settings.amount <= 0.0f) ||
+             (settings.type == CURVE_POINTS &&
+              !responseCurvePointsValid(settings.points, settings.pointCount));
+    if (linear) {
+        return;
+    }
+
+    for (int i = 0; i <= RESPONSE_CURVE_SEGMENTS; i++) {
+        float x = AXIS_MIN + (float)i * (AXIS_MAX - AXIS_MIN) / RESPONSE_CURVE_SEGMENTS;
+        float y = evaluate(settings, x) + 0.5f;
+        if (y < AXIS_MIN) y = AXIS_MIN;
+        if (y > AXIS_MAX) y = AXIS_MAX;
+        table[i] = (int16_t)y;
+    }
+}
+
+int16_t ResponseCurve::apply(const ResponseCurveSettings& settings, int16_t value) {
+    if (settings.revision != builtRevision) {
+        build(settings);
+    }
+    if (linear) {
+        return value;
+    }
+
+    if (value <= AXIS_MIN) return table[0];
+    if (value >= AXIS_MAX) return table[RESPONSE_CURVE_SEGMENTS];
+
+    // Constant divisors: the compiler turns these into multiplies
+    uint32_t pos = (uint32_t)(value - AXIS_MIN) * RESPONSE_CURVE_SEGMENTS;
+    uint32_t idx = pos / (AXIS_MAX - AXIS_MIN);
+    int32_t frac = (int32_t)(pos % (AXIS_MAX - AXIS_MIN));
+    int32_t a = table[idx];
+    int32_t b = table[idx + 1];
+    return (int16_t)(a + (b - a) * frac / (AXIS_MAX - AXIS_MIN));
+}
+
+const char* responseCurveTypeName(ResponseCurveType type) {
+    switch (type) {
+        case CURVE_EXPO: return "expo";
+        case CURVE_SCURVE: return "scurve";
+        case CURVE_POINTS: return "points";
+        case CURVE_LINEAR:
+        default: return "linear";
+    }
+}
+
+bool parseResponseCurveType(const char* name, ResponseCurveType* type) {
+    if (name == nullptr) return false;
+    if (strcmp(name, "linear") == 0) { *type = CURVE_LINEAR; return true; }
+    if (strcmp(name, "expo") == 0) { *type = CURVE_EXPO; return true; }
+    if (strcmp(name, "scurve") == 0) { *type = CURVE_SCURVE; return true; }
+    if (strcmp(name, "points") == 0) { *type = CURVE_POINTS; return true; }
+    return false;
+}
+
+bool responseCurvePointsValid(const ResponseCurvePoint* points, uint8_t count) {
+    if (count < 2 || count > RESPONSE_CURVE_MAX_POINTS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (points[i].in < AXIS_MIN || points[i].in > AXIS_MAX ||
+            points[i].out < AXIS_MIN || points[i].out > AXIS_MAX) {
+            return false;
+        }
+        if (i > 0 && points[i].in <= points[i - 1].in) {
+            return false;
+        }
+    }
+    return true;
+}
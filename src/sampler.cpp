@@ -0,0 +1,195 @@
+#include "sampler.h"
+#include "config.h"
+#include "logger.h"
+#include <esp_freertos_hooks.h>
+#include <freertos/xtensa_context.h>
+
+// Interrupt nesting depth per core (FreeRTOS Xtensa port). 1 inside the tick
+// ISR means the tick preempted task code; more means it preempted another ISR.
+extern "C" volatile uint32_t port_interruptNesting[portNUM_PROCESSORS];
+
+// Samples: PC plus (core << 7 | task index), kept in two arrays to stay at
+// 5 bytes per sample
+static uint32_t* samplePc = nullptr;
+static uint8_t* sampleMeta = nullptr;
+static volatile uint32_t sampleCount = 0;
+static volatile bool running = false;
+static bool hooksRegistered = false;  // Until stopSampler(), also after the buffer filled
+
+// Tasks seen while sampling. Names are resolved outside the ISR.
+struct SamplerTask {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+};
+static SamplerTask tasks[SAMPLER_MAX_TASKS];
+static volatile uint8_t taskCount = 0;
+
+static portMUX_TYPE samplerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// -----------------------------------------------------------------------------
+// Tick hook (ISR context, must stay in IRAM: it also runs while flash is busy)
+// -----------------------------------------------------------------------------
+
+static IRAM_ATTR uint8_t taskIndex(TaskHandle_t handle) {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if (tasks[i].handle == handle) {
+            return i;
+        }
+    }
+    if (taskCount >= SAMPLER_MAX_TASKS) {
+        return SAMPLER_TASK_ISR;  // Table full - lump in with "unknown"
+    }
+    tasks[taskCount].handle = handle;
+    tasks[taskCount].name[0] = '\0';
+    return taskCount++;
+}
+
+static IRAM_ATTR void sampleCore(BaseType_t core) {
+    uint32_t pc = 0;
+    uint8_t task = SAMPLER_TASK_ISR;
+
+    if (port_interruptNesting[core] <= 1) {
+        // On interrupt entry the port saves the preempted context on the task
+        // stack and stores its address in pxTopOfStack, the TCB's first field
+        TaskHandle_t handle = xTaskGetCurrentTaskHandleForCPU(core);
+        if (handle != NULL) {
+            const XtExcFrame* frame = *(XtExcFrame* const*)handle;
+            pc = frame->pc;
+        }
+        portENTER_CRITICAL_ISR(&samplerMux);
+        task = taskIndex(handle);
+    } else {
+        portENTER_CRITICAL_ISR(&samplerMux);
+    }
+
+    uint32_t i = sampleCount;
+    if (i < SAMPLER_MAX_SAMPLES) {
+        samplePc[i] = pc;
+        sampleMeta[i] = (uint8_t)((core << 7) | task);
+        sampleCount = i + 1;
+    } else {
+        running = false;  // Buffer full; hooks are removed by stopSampler()
+    }
+    portEXIT_CRITICAL_ISR(&samplerMux);
+}
+
+static IRAM_ATTR void onTickCore0() {
+    if (running) sampleCore(0);
+}
+
+static IRAM_ATTR void onTickCore1() {
+    if (running) sampleCore(1);
+}
+
+// -----------------------------------------------------------------------------
+// Control
+// -----------------------------------------------------------------------------
+
+// Copy names of all live tasks into the table (unknown handles stay "?")
+static void resolveTaskNames() {
+    UBaseType_t n = uxTaskGetNumberOfTasks();
+    TaskStatus_t* status = (TaskStatus_t*)malloc(n * sizeof(TaskStatus_t));
+    if (status == nullptr) {
+        return;
+    }
+    n = uxTaskGetSystemState(status, n, NULL);
+    for (uint8_t i = 0; i < taskCount; i++) {
+        for (UBaseType_t j = 0; j < n; j++) {
+            if (status[j].xHandle == tasks[i].handle) {
+                strlcpy(tasks[i].name, status[j].pcTaskName, sizeof(tasks[i].name));
+                break;
+            }
+        }
+    }
+    free(status);
+}
+
+bool startSampler() {
+    if (running) {
+        return true;
+    }
+    if (samplePc == nullptr) {
+        samplePc = (uint32_t*)malloc(SAMPLER_MAX_SAMPLES * sizeof(uint32_t));
+        sampleMeta = (uint8_t*)malloc(SAMPLER_MAX_SAMPLES);
+        if (samplePc == nullptr || sampleMeta == nullptr) {
+            free(samplePc);
+            free(sampleMeta);
+            samplePc = nullptr;
+            sampleMeta = nullptr;
+            LOG_ERROR("Sampler: cannot allocate sample buffer");
+            return false;
+        }
+    }
+
+    // Hooks may still be registered if the buffer filled up on its own
+    esp_deregister_freertos_tick_hook_for_cpu(onTickCore0, 0);
+    esp_deregister_freertos_tick_hook_for_cpu(onTickCore1, 1);
+
+    sampleCount = 0;
+    taskCount = 0;
+    running = true;
+    if (esp_register_freertos_tick_hook_for_cpu(onTickCore0, 0) != ESP_OK ||
+        esp_register_freertos_tick_hook_for_cpu(onTickCore1, 1) != ESP_OK) {
+        running = false;
+        esp_deregister_freertos_tick_hook_for_cpu(onTickCore0, 0);
+        LOG_ERROR("Sampler: cannot register tick hooks");
+        return false;
+    }
+    hooksRegistered = true;
+
+    LOG_INFOF("Sampler started (%lu Hz per core, %u samples)", getSamplerSampleHz(), SAMPLER_MAX_SAMPLES);
+    return true;
+}
+
+void stopSampler() {
+    running = false;
+    esp_deregister_freertos_tick_hook_for_cpu(onTickCore0, 0);
+    esp_deregister_freertos_tick_hook_for_cpu(onTickCore1, 1);
+    hooksRegistered = false;
+    resolveTaskNames();
+    LOG_INFOF("Sampler stopped (%lu samples, %u tasks)", sampleCount, taskCount);
+}
+
+bool isSamplerRunning() {
+    return running;
+}
+
+bool isSamplerStopPending() {
+    return hooksRegistered && !running;
+}
+
+uint32_t getSamplerCount() {
+    return sampleCount;
+}
+
+uint32_t getSamplerCapacity() {
+    return SAMPLER_MAX_SAMPLES;
+}
+
+uint32_t getSamplerSampleHz() {
+    return configTICK_RATE_HZ;
+}
+
+bool getSamplerSample(uint32_t index, uint32_t* pc, uint8_t* core, uint8_t* task) {
+    if (running || index >= sampleCount) {
+        return false;
+    }
+    *pc = samplePc[index];
+    *core = sampleMeta[index] >> 7;
+    *task = sampleMeta[index] & 0x7F;
+    return true;
+}
+
+uint8_t getSamplerTaskCount() {
+    return taskCount;
+}
+
+const char* getSamplerTaskName(uint8_t task) {
+    if (task == SAMPLER_TASK_ISR) {
+        return "(isr)";
+    }
+    if (task >= taskCount || tasks[task].name[0] == '\0') {
+        return "?";
+    }
+    return tasks[task].name;
+}
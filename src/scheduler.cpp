@@ -0,0 +1,163 @@
+#include "scheduler.h"
+#include "config.h"
+#include "logger.h"
+#include <esp_timer.h>
+
+// Global scheduler instances
+Scheduler controlScheduler("control", CONTROL_TICK_MS);
+Scheduler housekeepingScheduler("housekeeping", HOUSEKEEPING_TICK_MS);
+
+Scheduler::Scheduler(const char* name, uint32_t tickMs)
+    : name(name), tickMs(tickMs), taskCount(0), wakeHandlerCount(0), started(false),
+      lastWake(0), nextTickUs(0), maxTickLateUs(0), wakeups(0), taskHandle(NULL) {}
+
+bool Scheduler::addTask(const char* name, SchedTaskFn fn, uint32_t periodMs, uint32_t phaseMs) {
+    if (taskCount >= SCHED_MAX_TASKS || fn == nullptr || periodMs == 0) {
+        LOG_ERRORF("Scheduler: cannot add task %s", name);
+        return false;
+    }
+
+    Task& task = tasks[taskCount++];
+    task.fn = fn;
+    task.periodUs = periodMs * 1000UL;
+    // Phase is applied when the scheduler starts (first tick)
+    task.nextDueUs = (int64_t)phaseMs * 1000;
+    task.zone = new ProfileZone(name);
+    task.stats = SchedTaskStats();
+    task.stats.name = name;
+    task.stats.periodMs = periodMs;
+
+    LOG_INFOF("Scheduler %s: %s every %lu ms (phase %lu ms)", this->name, name, periodMs, phaseMs);
+    return true;
+}
+
+bool Scheduler::addWakeHandler(SchedTaskFn fn) {
+    if (wakeHandlerCount >= SCHED_MAX_WAKE_HANDLERS || fn == nullptr) {
+        LOG_ERRORF("Scheduler %s: cannot add wake handler", name);
+        return false;
+    }
+    wakeHandlers[wakeHandlerCount++] = fn;
+    return true;
+}
+
+void Scheduler::wake() {
+    if (taskHandle != NULL) {
+        xTaskNotifyGive(taskHandle);
+    }
+}
+
+void Scheduler::taskEntry(void* arg) {
+    Scheduler* self = static_cast<Scheduler*>(arg);
+    for (;;) {
+        self->tick();
+    }
+}
+
+void Scheduler::startTask(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+    xTaskCreatePinnedToCore(taskEntry, name, stackSize, this, priority, &taskHandle, core);
+    LOG_INFOF("Scheduler %s started (Core %d, priority %u, tick %lu ms)", name, core, priority, tickMs);
+}
+
+void Scheduler::start() {
+    // Deadlines so far hold only the phase offset - anchor them to "now"
+    int64_t now = esp_timer_get_time();
+    for (uint8_t i = 0; i < taskCount; i++) {
+        tasks[i].nextDueUs += now;
+    }
+    lastWake = xTaskGetTickCount();
+    nextTickUs = now;
+    started = true;
+}
+
+void Scheduler::tick() {
+    if (!started) {
+        start();
+    }
+
+    // Equivalent of vTaskDelayUntil(&lastWake, tick), except that wake()
+    // cuts the wait short to run the wake handlers, then keeps waiting.
+    const TickType_t tickTicks = pdMS_TO_TICKS(tickMs);
+    for (;;) {
+        TickType_t elapsed = xTaskGetTickCount() - lastWake;
+        if (elapsed >= tickTicks) {
+            break;
+        }
+        if (ulTaskNotifyTake(pdTRUE, tickTicks - elapsed) == 0) {
+            break;  // Timed out - tick is due
+        }
+        wakeups++;
+        for (uint8_t i = 0; i < wakeHandlerCount; i++) {
+            wakeHandlers[i]();
+        }
+    }
+    lastWake += tickTicks;
+
+    // Wake-up lateness against the ideal tick grid (worst-case period error)
+    int64_t woke = esp_timer_get_time();
+    nextTickUs += (int64_t)tickMs * 1000;
+    if (woke > nextTickUs) {
+        uint32_t late = (uint32_t)(woke - nextTickUs);
+        if (late > maxTickLateUs) {
+            maxTickLateUs = late;
+        }
+        // Re-anchor after a long stall so one hiccup doesn't poison every tick
+        if (late > tickMs * 1000UL) {
+            nextTickUs = woke;
+        }
+    }
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        int64_t now = esp_timer_get_time();
+        if (now >= tasks[i].nextDueUs) {
+            runTask(tasks[i], now);
+        }
+    }
+}
+
+void Scheduler::runTask(Task& task, int64_t now) {
+    SchedTaskStats& s = task.stats;
+
+    // Skip whole periods we are late by instead of bursting to catch up
+    int64_t late = now - task.nextDueUs;
+    if (late >= (int64_t)task.periodUs) {
+        uint32_t skipped = (uint32_t)(late / task.periodUs);
+        s.missed += skipped;
+        task.nextDueUs += (int64_t)skipped * task.periodUs;
+    }
+
+    uint32_t jitter = (uint32_t)(now - task.nextDueUs);
+    s.lastJitterUs = jitter;
+    if (jitter > s.maxJitterUs) {
+        s.maxJitterUs = jitter;
+    }
+
+    task.fn();
+
+    uint32_t exec = (uint32_t)(esp_timer_get_time() - now);
+    task.zone->record(exec);
+    s.lastExecUs = exec;
+    if (exec > s.maxExecUs) {
+        s.maxExecUs = exec;
+    }
+    if (exec > task.periodUs) {
+        s.overruns++;
+    }
+    s.runs++;
+
+    task.nextDueUs += task.periodUs;
+}
+
+void Scheduler::resetStats() {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        SchedTaskStats& s = tasks[i].stats;
+        s.runs = 0;
+        s.overruns = 0;
+        s.missed = 0;
+        s.lastJitterUs = 0;
+        s.maxJitterUs = 0;
+        s.lastExecUs = 0;
+        s.maxExecUs = 0;
+    }
+    maxTickLateUs = 0;
+    wakeups = 0;
+}
@@ -0,0 +1,278 @@
+#include "sim_estimator.h"
+#include <math.h>
+
+#define INNOVATION_AVG  0.05f  // Weight of a new innovation in the running RMS
+
+static float wrap180(float deg) {
+    while (deg > 180.0f) deg -= 360.0f;
+    while (deg < -180.0f) deg += 360.0f;
+    return deg;
+}
+
+static float wrap360(float deg) {
+    while (deg >= 360.0f) deg -= 360.0f;
+    while (deg < 0.0f) deg += 360.0f;
+    return deg;
+}
+
+// =============================================================================
+// SgDifferentiator
+// =============================================================================
+
+void SgDifferentiator::reset() {
+    head = 0;
+    count = 0;
+}
+
+bool SgDifferentiator::push(float value, int64_t timeUs, uint8_t samples, uint8_t order, float* rate) {
+    if (order < 1) order = 1;
+    if (order > 2) order = 2;
+    if (samples > SIM_DIFF_MAX_SAMPLES) samples = SIM_DIFF_MAX_SAMPLES;
+    if (samples < order + 2) samples = order + 2;
+
+    if (count > 0) {
+        uint8_t last = (head + SIM_DIFF_MAX_SAMPLES - 1) % SIM_DIFF_MAX_SAMPLES;
+        if (timeUs <= times[last]) {
+            reset();
+        } else if (wrap360) {
+            value = values[last] + wrap180(value - values[last]);
+        }
+    }
+    values[head] = value;
+    times[head] = timeUs;
+    head = (head + 1) % SIM_DIFF_MAX_SAMPLES;
+    if (count < SIM_DIFF_MAX_SAMPLES) {
+        count++;
+    }
+    if (count < samples) {
+        return false;
+    }
+
+    // Fit over the newest samples: x in seconds relative to the newest
+    // sample, y relative to its value, then centred on the mean x so the
+    // sums stay well conditioned in float
+    float x[SIM_DIFF_MAX_SAMPLES];
+    float y[SIM_DIFF_MAX_SAMPLES];
+    uint8_t newest = (head + SIM_DIFF_MAX_SAMPLES - 1) % SIM_DIFF_MAX_SAMPLES;
+    float meanX = 0.0f;
+    for (uint8_t i = 0; i < samples; i++) {
+        uint8_t idx = (newest + SIM_DIFF_MAX_SAMPLES - i) % SIM_DIFF_MAX_SAMPLES;
+        x[i] = (times[idx] - times[newest]) * 1e-6f;
+        y[i] = values[idx] - values[newest];
+        meanX += x[i];
+    }
+    meanX /= samples;
+
+    float s2 = 0.0f, s3 = 0.0f, s4 = 0.0f;
+    float t0 = 0.0f, t1 = 0.0f, t2 = 0.0f;
+    for (uint8_t i = 0; i < samples; i++) {
+        float u = x[i] - meanX;
+        float u2 = u * u;
+        s2 += u2;
+        s3 += u2 * u;
+        s4 += u2 * u2;
+        t0 += y[i];
+        t1 += u * y[i];
+        t2 += u2 * y[i];
+    }
+    if (s2 <= 0.0f) {
+        return false;
+    }
+    if (order == 1) {
+        *rate = t1 / s2;
+        return true;
+    }
+
+    // y = a + b*u + c*u^2; a eliminated from the normal equations
+    float n = samples;
+    float m = s4 - s2 * s2 / n;
+    float r = t2 - s2 * t0 / n;
+    float det = s2 * m - s3 * s3;
+    if (det <= 1e-6f * s2 * m) {
+        return false;  // Samples (nearly) on too few distinct times
+    }
+    float b = (t1 * m - s3 * r) / det;
+    float c = (s2 * r - s3 * t1) / det;
+    *rate = b - 2.0f * c * meanX;  // Slope at the newest sample (u = -meanX)
+    return true;
+}
+
+// =============================================================================
+// AlphaBetaTracker
+// =============================================================================
+void AlphaBetaTracker::reset() {
+    SimChannelStats fresh;
+    fresh.resets = stats.resets;
+    fresh.updates = stats.updates;
+    stats = fresh;
+    innovationSq = 0.0f;
+    hasSimTime = false;
+    lastSimTimeMs = 0;
+}
+
+void AlphaBetaTracker::update(float z, int64_t arrivalUs, bool hasTime, uint32_t simTimeMs,
+                              const SimEstimatorSettings& settings) {
+    int64_t arrivalDtUs = arrivalUs - stats.lastUs;
+    if (stats.valid && arrivalDtUs > (int64_t)settings.resetUs) {
+        stats.resets++;
+        reset();
+    }
+
+    if (!stats.valid) {
+        stats.valid = true;
+        stats.value = wrap360 ? ::wrap360(z) : z;
+        stats.rate = 0.0f;
+        stats.innovation = 0.0f;
+    } else {
+        // The sim clock when both measurements carry it; a paused sim (no
+        // sim time advance) falls back to arrival times
+        int64_t dtUs = arrivalDtUs;
+        if (hasTime && hasSimTime && (int32_t)(simTimeMs - lastSimTimeMs) > 0) {
+            dtUs = (int64_t)(uint32_t)(simTimeMs - lastSimTimeMs) * 1000;
+        }
+        if (dtUs < SIM_EST_MIN_DT_US) {
+            dtUs = SIM_EST_MIN_DT_US;
+        }
+        float dt = dtUs * 1e-6f;
+
+        float predicted = stats.value + stats.rate * dt;
+        float r = z - predicted;
+        if (wrap360) {
+            r = wrap180(r);
+        }
+        stats.value = predicted + settings.alpha * r;
+        if (wrap360) {
+            stats.value = ::wrap360(stats.value);
+        }
+        stats.rate += settings.beta * r / dt;
+        stats.innovation = r;
+        innovationSq += INNOVATION_AVG * (r * r - innovationSq);
+        stats.innovationRms = sqrtf(innovationSq);
+    }
+
+    stats.lastUs = arrivalUs;
+    stats.updates++;
+    hasSimTime = hasTime;
+    lastSimTimeMs = simTimeMs;
+}
+
+bool AlphaBetaTracker::predict(int64_t nowUs, const SimEstimatorSettings& settings, float* out) const {
+    if (!stats.valid) {
+        return false;
+    }
+    int64_t ageUs = nowUs - stats.lastUs;
+    if (ageUs < 0) {
+        ageUs = 0;
+    }
+    if (ageUs > (int64_t)settings.maxPredictUs) {
+        ageUs = settings.maxPredictUs;  // Hold at the end of the trend
+    }
+    float value = stats.value + stats.rate * (ageUs * 1e-6f);
+    *out = wrap360 ? ::wrap360(value) : value;
+    return true;
+}
+
+// =============================================================================
+// SimEstimator
+// =============================================================================
+
+SimEstimator::SimEstimator() {
+    channels[SIM_CH_HEADING].setWrap360(true);
+    differentiators[SIM_RATE_YAW].setWrap360(true);
+    reset();
+}
+
+void SimEstimator::reset() {
+    for (AlphaBetaTracker& ch : channels) {
+        ch.reset();
+    }
+    for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+        differentiators[axis].reset();
+        rates[axis] = SimRateStats();
+        diffLastUs[axis] = 0;
+        diffSimTime[axis] = false;
+    }
+}
+
+void SimEstimator::update(const SimMessage& msg, int64_t arrivalUs) {
+    struct Source {
+        SimChannel ch;
+        uint8_t field;
+        float value;
+    };
+    const Source sources[] = {
+        {SIM_CH_PITCH,    SIM_FIELD_PITCH,    msg.pitch},
+        {SIM_CH_ROLL,     SIM_FIELD_ROLL,     msg.roll},
+        {SIM_CH_HEADING,  SIM_FIELD_HEADING,  msg.heading},
+        {SIM_CH_VS,       SIM_FIELD_VS,       msg.verticalSpeed},
+        {SIM_CH_ALTITUDE, SIM_FIELD_ALTITUDE, msg.altitude}
+    };
+    for (const Source& s : sources) {
+        if (msg.fields & s.field) {
+            channels[s.ch].update(s.value, arrivalUs, msg.hasTime, msg.simTimeMs, settings);
+        }
+    }
+
+    struct RateSource {
+        uint16_t attitudeField;
+        float attitude;
+        uint16_t rateField;
+        float rate;
+    };
+    const RateSource rateSources[SIM_RATE_COUNT] = {
+        {SIM_FIELD_PITCH,   msg.pitch,   SIM_FIELD_PITCH_RATE, msg.pitchRate},
+        {SIM_FIELD_ROLL,    msg.roll,    SIM_FIELD_ROLL_RATE,  msg.rollRate},
+        {SIM_FIELD_HEADING, msg.heading, SIM_FIELD_YAW_RATE,   msg.yawRate}
+    };
+    for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+        const RateSource& s = rateSources[axis];
+        SimRateStats& r = rates[axis];
+        if (msg.fields & s.rateField) {
+            r.measured = s.rate;
+            r.measuredUs = arrivalUs;
+        }
+        if (!(msg.fields & s.attitudeField)) {
+            continue;
+        }
+
+        // Differentiate on the sim clock when the message has one; a switch
+        // of clocks or a long gap restarts the window
+        int64_t timeUs = msg.hasTime ? (int64_t)msg.simTimeMs * 1000 : arrivalUs;
+        if (msg.hasTime != diffSimTime[axis] ||
+            (diffLastUs[axis] != 0 && timeUs - diffLastUs[axis] > (int64_t)settings.resetUs)) {
+            differentiators[axis].reset();
+        }
+        diffSimTime[axis] = msg.hasTime;
+        diffLastUs[axis] = timeUs;
+
+        float derived;
+        if (differentiators[axis].push(s.attitude, timeUs, settings.diffSamples, settings.diffOrder, &derived)) {
+            r.derived = derived;
+            r.derivedUs = arrivalUs;
+        }
+    }
+}
+
+bool SimEstimator::predict(SimChannel ch, int64_t nowUs, float* out) const {
+    return channels[ch].predict(nowUs, settings, out);
+}
+
+SimRateSource SimEstimator::rate(SimRateAxis axis, int64_t nowUs, float* out) const {
+    const SimRateStats& r = rates[axis];
+    if (r.measuredUs != 0 && nowUs - r.measuredUs <= (int64_t)settings.maxPredictUs) {
+        *out = r.measured;
+        return SIM_RATE_MEASURED;
+    }
+    if (r.derivedUs != 0 && nowUs - r.derivedUs <= (int64_t)settings.maxPredictUs) {
+        *out = r.derived;
+        return SIM_RATE_DERIVED;
+    }
+    return SIM_RATE_NONE;
+}
+
+SimRateStats SimEstimator::getRateStats(SimRateAxis axis, int64_t nowUs) const {
+    SimRateStats stats = rates[axis];
+    float unused;
+    stats.source = rate(axis, nowUs, &unused);
+    return stats;
+}
@@ -0,0 +1,146 @@
+#include "sim_feed.h"
+#include "config.h"
+#include "state.h"
+#include "logger.h"
+#include "simulator_serial.h"
+#include "sim_udp.h"
+
+static SimFeedStats stats;
+static SimulatorPort requestPort = SIM_PORT_NONE;  // Where the current request went
+static unsigned long sentMs = 0;
+static uint8_t attempts = 0;      // Sends of the current request without an ack
+static bool awaitingAck = false;
+
+// Written by the control task
+static portMUX_TYPE ackMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t ackedId = 0;
+static unsigned long ackedMs = 0;
+
+// Fields and rates the autopilot needs right now
+static SimFeedRequest wantedRequest() {
+    SimFeedRequest req;
+    if (!state.autopilot.enabled) {
+        req.fields = SIM_FIELD_STATE;
+        req.hz = SIM_FEED_MONITOR_HZ;
+        req.otherHz = SIM_FEED_MONITOR_HZ;
+        return req;
+    }
+
+    // Speed for the minimum speed check, attitude and its rates for the
+    // inner loops
+    req.fields = SIM_FIELD_SPEED | SIM_FIELD_PITCH | SIM_FIELD_ROLL |
+                 SIM_FIELD_PITCH_RATE | SIM_FIELD_ROLL_RATE;
+    if (state.autopilot.horizontalMode == APHorizontalMode::HeadingHold) {
+        req.fields |= SIM_FIELD_HEADING;
+    }
+    if (state.autopilot.verticalMode == APVerticalMode::VerticalSpeed) {
+        req.fields |= SIM_FIELD_VS;
+    }
+    if (state.autopilot.verticalMode == APVerticalMode::AltitudeHold || state.autopilot.altHoldArmed) {
+        req.fields |= SIM_FIELD_ALTITUDE | SIM_FIELD_VS;
+    }
+    req.hz = SIM_FEED_AP_HZ;
+    req.otherHz = SIM_FEED_MONITOR_HZ;
+    return req;
+}
+
+static void sendRequest(unsigned long now) {
+    char line[SIM_REQUEST_MAX];
+    size_t len = formatSimRequest(stats.request, stats.id, line, sizeof(line));
+    if (len > 0) {
+        sendSimulatorLine(requestPort, line, len);
+    }
+    stats.requestsSent++;
+    sentMs = now;
+    attempts++;
+    awaitingAck = true;
+}
+
+void initSimFeed() {
+    if (!SIM_FEED_REQUESTS) {
+        LOG_INFO("Simulator feed requests disabled");
+        return;
+    }
+    LOG_INFOF("Simulator feed requests: %d Hz monitoring, %d Hz with autopilot",
+              SIM_FEED_MONITOR_HZ, SIM_FEED_AP_HZ);
+}
+
+void handleSimFeed() {
+    if (!SIM_FEED_REQUESTS) {
+        return;
+    }
+    unsigned long now = millis();
+
+    SimFeedRequest want = wantedRequest();
+    if (want.fields != stats.request.fields || want.hz != stats.request.hz ||
+        want.otherHz != stats.request.otherHz || stats.id == 0) {
+        stats.request = want;
+        setXPlaneRates(want);
+        LOG_INFOF("Simulator feed: requesting %d Hz (fields 0x%03x), others %d Hz",
+                  want.hz, want.fields, want.otherHz);
+        stats.id++;
+        requestPort = SIM_PORT_COUNT;  // Send below
+    }
+
+    // X-Plane has no bridge to ask; anything else gets the request on the
+    // port its data comes from
+    SimulatorPort port = getSimulatorPort();
+    if (port == SIM_PORT_XPLANE) {
+        stats.status = SIM_FEED_XPLANE;
+        requestPort = port;
+        awaitingAck = false;
+        return;
+    }
+    if (port != requestPort) {
+        requestPort = port;
+        attempts = 0;
+        stats.status = SIM_FEED_PENDING;
+        sendRequest(now);
+        return;
+    }
+
+    portENTER_CRITICAL(&ackMux);
+    bool acked = ackedId == stats.id && (long)(ackedMs - sentMs) >= 0;
+    portEXIT_CRITICAL(&ackMux);
+
+    if (awaitingAck && acked) {
+        awaitingAck = false;
+        attempts = 0;
+        stats.acks++;
+        if (stats.status != SIM_FEED_ACKED) {
+            stats.status = SIM_FEED_ACKED;
+            LOG_INFOF("Simulator bridge follows feed request %lu", (unsigned long)stats.id);
+        }
+    } else if (awaitingAck) {
+        if (now - sentMs < SIM_FEED_ACK_TIMEOUT_MS) {
+            return;
+        }
+        if (attempts < SIM_FEED_RETRIES) {
+            sendRequest(now);
+        } else {
+            awaitingAck = false;
+            attempts = 0;
+            if (stats.status != SIM_FEED_IGNORED) {
+                stats.status = SIM_FEED_IGNORED;
+                LOG_WARN("Simulator bridge ignores feed requests, using the rate it sends");
+            }
+        }
+    } else {
+        // Repeat now and then: the bridge may have restarted or been replaced
+        unsigned long interval = stats.status == SIM_FEED_ACKED ? SIM_FEED_REFRESH_MS : SIM_FEED_IGNORED_RETRY_MS;
+        if (now - sentMs >= interval) {
+            sendRequest(now);
+        }
+    }
+}
+
+void simFeedAcked(uint32_t id) {
+    portENTER_CRITICAL(&ackMux);
+    ackedId = id;
+    ackedMs = millis();
+    portEXIT_CRITICAL(&ackMux);
+}
+
+SimFeedStats getSimFeedStats() {
+    return stats;
+}
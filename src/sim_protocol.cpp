@@ -0,0 +1,582 @@
+#include "sim_protocol.h"
+#include "cyclic_parser.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert(SIM_BINARY_STATE_SIZE == 10 + 6 * sizeof(float) + 2,
+              "Binary state layout out of sync");
+static_assert(SIM_BINARY_RATES_SIZE == 11 + 9 * sizeof(float) + 2,
+              "Binary rates layout out of sync");
+
+// =============================================================================
+// JSON scanner
+// =============================================================================
+
+// Keys outside the SimField mask
+#define SIM_KEY_SEQ   0x1000
+#define SIM_KEY_TIME  0x1001
+#define SIM_KEY_ACK   0x1002
+
+struct SimKey {
+    const char* name;
+    uint8_t len;
+    uint16_t field;
+};
+
+static const SimKey simKeys[] = {
+    {"spd",   3, SIM_FIELD_SPEED},
+    {"alt",   3, SIM_FIELD_ALTITUDE},
+    {"pitch", 5, SIM_FIELD_PITCH},
+    {"roll",  4, SIM_FIELD_ROLL},
+    {"hdg",   3, SIM_FIELD_HEADING},
+    {"vs",    2, SIM_FIELD_VS},
+    {"prate", 5, SIM_FIELD_PITCH_RATE},
+    {"rrate", 5, SIM_FIELD_ROLL_RATE},
+    {"yrate", 5, SIM_FIELD_YAW_RATE},
+    {"seq",   3, SIM_KEY_SEQ},
+    {"t",     1, SIM_KEY_TIME},
+    {"ack",   3, SIM_KEY_ACK}
+};
+
+static const float pow10Table[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static float* fieldValue(SimMessage* msg, uint16_t field) {
+    switch (field) {
+        case SIM_FIELD_SPEED:      return &msg->speed;
+        case SIM_FIELD_ALTITUDE:   return &msg->altitude;
+        case SIM_FIELD_PITCH:      return &msg->pitch;
+        case SIM_FIELD_ROLL:       return &msg->roll;
+        case SIM_FIELD_HEADING:    return &msg->heading;
+        case SIM_FIELD_PITCH_RATE: return &msg->pitchRate;
+        case SIM_FIELD_ROLL_RATE:  return &msg->rollRate;
+        case SIM_FIELD_YAW_RATE:   return &msg->yawRate;
+        default:                   return &msg->verticalSpeed;
+    }
+}
+
+static void skipSpace(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+}
+
+static float scale10(float value, int exponent) {
+    while (exponent > 10) {
+        value *= 1e10f;
+        exponent -= 10;
+    }
+    while (exponent < -10) {
+        value /= 1e10f;
+        exponent += 10;
+    }
+    return exponent >= 0 ? value * pow10Table[exponent] : value / pow10Table[-exponent];
+}
+
+// JSON number -> float. The first 9 significant digits are kept exactly in an
+// integer, which is more than a float holds.
+static bool parseNumber(const char*& p, const char* end, float* out) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9') {
+        return false;
+    }
+
+    uint32_t mantissa = 0;
+    uint8_t digits = 0;
+    int exponent = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 9) {
+            mantissa = mantissa * 10 + (uint32_t)(*p - '0');
+            if (mantissa != 0) digits++;
+        } else {
+            exponent++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || *p < '0' || *p > '9') {
+            return false;
+        }
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 9) {
+                mantissa = mantissa * 10 + (uint32_t)(*p - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool expNegative = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            expNegative = *p == '-';
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            return false;
+        }
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 1000) e = e * 10 + (*p - '0');
+            p++;
+        }
+        exponent += expNegative ? -e : e;
+    }
+
+    float value = mantissa == 0 ? 0.0f : scale10((float)mantissa, exponent);
+    *out = negative ? -value : value;
+    return true;
+}
+
+// Unsigned 32-bit integer (sequence number, timestamp)
+static bool parseUint(const char*& p, const char* end, uint32_t* out) {
+    if (p >= end || *p < '0' || *p > '9') {
+        return false;
+    }
+    uint64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (uint64_t)(*p - '0');
+        if (value > 0xFFFFFFFFu) return false;
+        p++;
+    }
+    *out = (uint32_t)value;
+    return true;
+}
+
+// Past the closing quote of a string (p on the opening quote)
+static bool skipString(const char*& p, const char* end) {
+    p++;
+    while (p < end) {
+        char c = *p++;
+        if (c == '\\') {
+            if (p >= end) return false;
+            p++;
+        } else if (c == '"') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Skip any value: strings, numbers, literals, nested objects/arrays (the
+// latter only checked for balanced brackets)
+static bool skipValue(const char*& p, const char* end) {
+    if (p >= end) {
+        return false;
+    }
+    if (*p == '"') {
+        return skipString(p, end);
+    }
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                if (!skipString(p, end)) return false;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    p++;
+                    return true;
+                }
+            }
+            p++;
+        }
+        return false;
+    }
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        float ignored;
+        return parseNumber(p, end, &ignored);
+    }
+    static const char* const literals[] = {"true", "false", "null"};
+    for (const char* lit : literals) {
+        size_t n = strlen(lit);
+        if ((size_t)(end - p) >= n && memcmp(p, lit, n) == 0) {
+            p += n;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSimJson(const char* text, size_t len, SimMessage* msg) {
+    const char* p = text;
+    const char* end = text + len;
+
+    msg->fields = 0;
+    msg->binary = false;
+    msg->hasSeq = false;
+    msg->hasTime = false;
+    msg->hasAck = false;
+    msg->seq = 0;
+    msg->simTimeMs = 0;
+    msg->ack = 0;
+
+    skipSpace(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    p++;
+    skipSpace(p, end);
+    if (p < end && *p == '}') {
+        p++;
+    } else {
+        for (;;) {
+            if (p >= end || *p != '"') {
+                return false;
+            }
+            const char* key = ++p;
+            while (p < end && *p != '"' && *p != '\\') {
+                p++;
+            }
+            if (p < end && *p == '\\') {
+                // Escaped key - none of ours, skip it as a string
+                p = key - 1;
+                if (!skipString(p, end)) return false;
+                key = nullptr;
+            } else if (p >= end) {
+                return false;
+            } else {
+                p++;
+            }
+            size_t keyLen = key ? (size_t)(p - 1 - key) : 0;
+
+            skipSpace(p, end);
+            if (p >= end || *p != ':') {
+                return false;
+            }
+            p++;
+            skipSpace(p, end);
+
+            uint16_t field = 0;
+            for (const SimKey& k : simKeys) {
+                if (key && keyLen == k.len && memcmp(key, k.name, keyLen) == 0) {
+                    field = k.field;
+                    break;
+                }
+            }
+
+            float value;
+            const char* valueStart = p;
+            if (field == SIM_KEY_SEQ && parseUint(p, end, &msg->seq)) {
+                msg->hasSeq = true;
+            } else if (field == SIM_KEY_TIME && parseUint(p, end, &msg->simTimeMs)) {
+                msg->hasTime = true;
+            } else if (field == SIM_KEY_ACK && parseUint(p, end, &msg->ack)) {
+                msg->hasAck = true;
+            } else if (field && field < SIM_KEY_SEQ && parseNumber(p, end, &value)) {
+                *fieldValue(msg, field) = value;
+                msg->fields |= field;
+            } else {
+                p = valueStart;
+                if (!skipValue(p, end)) return false;
+            }
+
+            skipSpace(p, end);
+            if (p < end && *p == ',') {
+                p++;
+                skipSpace(p, end);
+                continue;
+            }
+            if (p < end && *p == '}') {
+                p++;
+                break;
+            }
+            return false;
+        }
+    }
+
+    skipSpace(p, end);
+    return p == end;
+}
+
+// =============================================================================
+// Binary messages
+// =============================================================================
+
+static uint32_t getLe32(const uint8_t* b) {
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) |
+           ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static void putLe32(uint8_t* b, uint32_t v) {
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+    b[2] = (uint8_t)(v >> 16);
+    b[3] = (uint8_t)(v >> 24);
+}
+
+// COBS decode in place (output never outruns input). Returns false for a
+// frame that contains a zero code byte or ends inside a block.
+static bool cobsDecode(uint8_t* buf, size_t len, size_t* outLen) {
+    size_t r = 0;
+    size_t w = 0;
+    while (r < len) {
+        uint8_t code = buf[r++];
+        if (code == 0) {
+            return false;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (r >= len) return false;
+            buf[w++] = buf[r++];
+        }
+        if (code < 0xFF && r < len) {
+            buf[w++] = 0;
+        }
+    }
+    *outLen = w;
+    return true;
+}
+
+SimEvent decodeSimBinary(const uint8_t* payload, size_t len, SimMessage* msg) {
+    // Type 1: 1-byte mask, six floats. Type 2: 16-bit mask, nine floats.
+    size_t header;
+    int count;
+    if (len == SIM_BINARY_STATE_SIZE && payload[0] == SIM_BINARY_TYPE_STATE) {
+        header = 2;
+        count = 6;
+    } else if (len == SIM_BINARY_RATES_SIZE && payload[0] == SIM_BINARY_TYPE_RATES) {
+        header = 3;
+        count = 9;
+    } else {
+        return SIM_EVENT_PARSE_ERROR;
+    }
+    uint16_t crc = (uint16_t)payload[len - 2] | ((uint16_t)payload[len - 1] << 8);
+    if (cyclicCrc16(payload, len - 2) != crc) {
+        return SIM_EVENT_CRC_ERROR;
+    }
+
+    uint16_t mask = header == 3 ? (uint16_t)(payload[1] | (payload[2] << 8)) : payload[1];
+    msg->fields = mask & ((1 << count) - 1);
+    msg->binary = true;
+    msg->hasSeq = true;
+    msg->hasTime = true;
+    msg->hasAck = false;
+    msg->seq = getLe32(&payload[header]);
+    msg->simTimeMs = getLe32(&payload[header + 4]);
+    for (int i = 0; i < count; i++) {
+        uint32_t bits = getLe32(&payload[header + 8 + 4 * i]);
+        memcpy(fieldValue(msg, 1 << i), &bits, sizeof(bits));
+    }
+    return SIM_EVENT_MESSAGE;
+}
+
+SimEvent decodeSimDatagram(const uint8_t* data, size_t len, SimMessage* msg) {
+    if (len > 0 && (data[0] == SIM_BINARY_TYPE_STATE || data[0] == SIM_BINARY_TYPE_RATES)) {
+        return decodeSimBinary(data, len, msg);
+    }
+    return parseSimJson((const char*)data, len, msg) ? SIM_EVENT_MESSAGE : SIM_EVENT_PARSE_ERROR;
+}
+
+size_t encodeSimBinary(const SimMessage& msg, uint8_t* out) {
+    uint8_t payload[SIM_BINARY_RATES_SIZE];
+    bool rates = (msg.fields & SIM_FIELD_RATES) != 0;
+    size_t header = rates ? 3 : 2;
+    int count = rates ? 9 : 6;
+    size_t size = rates ? SIM_BINARY_RATES_SIZE : SIM_BINARY_STATE_SIZE;
+    payload[0] = rates ? SIM_BINARY_TYPE_RATES : SIM_BINARY_TYPE_STATE;
+    payload[1] = (uint8_t)msg.fields;
+    if (rates) {
+        payload[2] = (uint8_t)(msg.fields >> 8);
+    }
+    putLe32(&payload[header], msg.seq);
+    putLe32(&payload[header + 4], msg.simTimeMs);
+    SimMessage values = msg;
+    for (int i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, fieldValue(&values, 1 << i), sizeof(bits));
+        putLe32(&payload[header + 8 + 4 * i], bits);
+    }
+    uint16_t crc = cyclicCrc16(payload, size - 2);
+    payload[size - 2] = (uint8_t)crc;
+    payload[size - 1] = (uint8_t)(crc >> 8);
+
+    // 0x00 | COBS | 0x00 (payload < 254 bytes, so one code byte per zero)
+    size_t n = 0;
+    out[n++] = 0;
+    size_t codePos = n++;
+    uint8_t code = 1;
+    for (size_t i = 0; i < size; i++) {
+        if (payload[i] == 0) {
+            out[codePos] = code;
+            codePos = n++;
+            code = 1;
+        } else {
+            out[n++] = payload[i];
+            code++;
+        }
+    }
+    out[codePos] = code;
+    out[n++] = 0;
+    return n;
+}
+
+// =============================================================================
+// Feed requests
+// =============================================================================
+
+size_t formatSimRequest(const SimFeedRequest& req, uint32_t id, char* out, size_t size) {
+    int n = snprintf(out, size, SIM_REQUEST_PREFIX "{\"id\":%lu,\"hz\":%u,\"fields\":[",
+                     (unsigned long)id, (unsigned)req.hz);
+    bool first = true;
+    for (const SimKey& k : simKeys) {
+        if (k.field >= SIM_KEY_SEQ || !(req.fields & k.field) || n < 0 || (size_t)n >= size) {
+            continue;
+        }
+        n += snprintf(out + n, size - n, first ? "\"%s\"" : ",\"%s\"", k.name);
+        first = false;
+    }
+    if (n >= 0 && (size_t)n < size) {
+        n += snprintf(out + n, size - n, "],\"otherHz\":%u}\n", (unsigned)req.otherHz);
+    }
+    return n < 0 || (size_t)n >= size ? 0 : (size_t)n;
+}
+
+// =============================================================================
+// Stream framer
+// =============================================================================
+
+SimParser::SimParser() {
+    reset();
+}
+
+void SimParser::reset() {
+    len = 0;
+    binaryMode = false;
+    discarding = false;
+    seq.reset();
+    stats = SimParserStats();
+}
+
+SimEvent SimParser::overflow() {
+    // Drop this line / frame up to its terminator, which may not have
+    // arrived yet
+    stats.discardedBytes += len + 1;
+    len = 0;
+    discarding = true;
+    return SIM_EVENT_OVERFLOW;
+}
+
+SimEvent SimParser::push(uint8_t c, SimMessage* msg) {
+    if (c == 0x00) {
+        // Frame delimiter: ends a binary frame, or switches a text stream
+        // over to binary framing
+        SimEvent event = SIM_EVENT_NONE;
+        if (discarding) {
+            discarding = false;
+        } else if (binaryMode && len > 0) {
+            event = finishFrame(msg);
+        } else {
+            stats.discardedBytes += len;  // Partial JSON line cut short
+        }
+        len = 0;
+        binaryMode = true;
+        return event;
+    }
+
+    if (binaryMode) {
+        if (len == 0 && !discarding && c == '{') {
+            binaryMode = false;  // Sender went back to JSON lines
+        } else {
+            if (discarding) {
+                stats.discardedBytes++;
+            } else if (len < SIM_FRAME_MAX) {
+                buf[len++] = c;
+            } else {
+                return overflow();
+            }
+            return SIM_EVENT_NONE;
+        }
+    }
+
+    if (c == '\n' || c == '\r') {
+        if (discarding) {
+            // End of the overlong line - back in sync
+            discarding = false;
+        } else if (len > 0) {
+            return finishLine(msg);
+        }
+        return SIM_EVENT_NONE;
+    }
+    if (discarding) {
+        stats.discardedBytes++;
+    } else if (len < SIM_FRAME_MAX) {
+        buf[len++] = c;
+    } else {
+        return overflow();
+    }
+    return SIM_EVENT_NONE;
+}
+
+SimEvent SimParser::finishLine(SimMessage* msg) {
+    bool ok = parseSimJson((const char*)buf, len, msg);
+    len = 0;
+    return ok ? accepted(msg) : SIM_EVENT_PARSE_ERROR;
+}
+
+SimEvent SimParser::finishFrame(SimMessage* msg) {
+    size_t n;
+    if (!cobsDecode(buf, len, &n)) {
+        return SIM_EVENT_PARSE_ERROR;
+    }
+    SimEvent event = decodeSimBinary(buf, n, msg);
+    return event == SIM_EVENT_MESSAGE ? accepted(msg) : event;
+}
+
+SimEvent SimParser::accepted(SimMessage* msg) {
+    if (msg->hasSeq && !seq.accept(msg->seq, stats)) {
+        return SIM_EVENT_NONE;  // Duplicate or stale - valid but not passed on
+    }
+    if (msg->binary) {
+        stats.binaryMessages++;
+    } else {
+        stats.jsonMessages++;
+    }
+    return SIM_EVENT_MESSAGE;
+}
+
+// =============================================================================
+// Sequence numbers
+// =============================================================================
+
+void SimSeqTracker::reset() {
+    haveSeq = false;
+    lastSeq = 0;
+    olderInRow = 0;
+}
+
+bool SimSeqTracker::accept(uint32_t seq, SimParserStats& stats) {
+    if (!haveSeq) {
+        haveSeq = true;
+        lastSeq = seq;
+        return true;
+    }
+
+    uint32_t delta = seq - lastSeq;
+    if (delta == 0) {
+        stats.duplicates++;
+        return false;
+    }
+    if (delta >= 0x80000000u) {
+        // Older than the last message - unless the sender restarted
+        stats.reordered++;
+        if (++olderInRow < SIM_SEQ_RESYNC) {
+            return false;
+        }
+    } else {
+        stats.lost += delta - 1;
+    }
+    olderInRow = 0;
+    lastSeq = seq;
+    return true;
+}
@@ -0,0 +1,352 @@
+#include "sim_udp.h"
+#include "config.h"
+#include "logger.h"
+#include "link_monitor.h"
+#include "scheduler.h"
+#include "web_server.h"
+#include "xplane_rref.h"
+#include <esp_timer.h>
+#include <lwip/pbuf.h>
+#include <lwip/udp.h>
+#include <lwip/ip_addr.h>
+#include <lwip/priv/tcpip_priv.h>
+
+struct SimUdpMail {
+    SimMessage msg;
+    int64_t arrivalUs;
+    SimulatorPort port;
+};
+
+// Mailbox: written by the tcpip task, read by the control task
+static portMUX_TYPE mailMux = portMUX_INITIALIZER_UNLOCKED;
+static SimUdpMail mailbox[SIM_UDP_MAILBOX];
+static uint32_t mailHead = 0;  // Free-running
+static uint32_t mailTail = 0;
+static uint32_t mailboxDrops = 0;
+
+// tcpip task only
+static udp_pcb* pcb = nullptr;
+static SimSeqTracker seqTracker;
+static SimParserStats stats;
+static uint8_t chainBuf[SIM_FRAME_MAX];  // Datagrams split over several pbufs
+static ip_addr_t senderAddr;             // Last bridge heard from, for feed requests
+static u16_t senderPort = 0;
+
+// X-Plane RREF feed
+static udp_pcb* xplanePcb = nullptr;
+static ip_addr_t xplaneAddr;
+static int64_t xplaneLastReplyUs = 0;       // Written by the tcpip task
+static int64_t xplaneLastSubscribeUs = 0;   // Housekeeping task only
+static XPlaneStats xplaneStats;
+static uint16_t xplaneRates[XPLANE_REF_COUNT];  // Housekeeping task only
+static bool xplaneRatesChanged = false;
+static portMUX_TYPE xplaneMux = portMUX_INITIALIZER_UNLOCKED;  // xplaneLastReplyUs
+
+// Queue a message for the control task (tcpip task)
+static void post(const SimMessage& msg, int64_t arrivalUs, SimulatorPort port) {
+    bool queued = false;
+    portENTER_CRITICAL(&mailMux);
+    if (mailHead - mailTail < SIM_UDP_MAILBOX) {
+        SimUdpMail& m = mailbox[mailHead % SIM_UDP_MAILBOX];
+        m.msg = msg;
+        m.arrivalUs = arrivalUs;
+        m.port = port;
+        mailHead++;
+        queued = true;
+    } else {
+        mailboxDrops++;
+    }
+    portEXIT_CRITICAL(&mailMux);
+
+    if (queued) {
+        controlScheduler.wake();
+    }
+}
+
+// lwIP receive callback (tcpip task)
+static void onDatagram(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, u16_t port) {
+    int64_t arrivalUs = esp_timer_get_time();
+
+    // Parse in place; only a datagram spread over a pbuf chain is gathered
+    const uint8_t* data = (const uint8_t*)p->payload;
+    size_t len = p->tot_len;
+    if (p->len != p->tot_len) {
+        if (len > sizeof(chainBuf)) {
+            simulatorUdpLink.counters.lineOverflows++;
+            stats.discardedBytes += len;
+            pbuf_free(p);
+            return;
+        }
+        pbuf_copy_partial(p, chainBuf, len, 0);
+        data = chainBuf;
+    }
+
+    SimMessage msg;
+    SimEvent event = decodeSimDatagram(data, len, &msg);
+    pbuf_free(p);
+
+    if (event == SIM_EVENT_PARSE_ERROR) {
+        simulatorUdpLink.counters.parseErrors++;
+        return;
+    }
+    if (event == SIM_EVENT_CRC_ERROR) {
+        simulatorUdpLink.counters.checksumErrors++;
+        return;
+    }
+    if (msg.hasSeq && !seqTracker.accept(msg.seq, stats)) {
+        return;  // Duplicate or older than what we already have
+    }
+    if (msg.binary) {
+        stats.binaryMessages++;
+    } else {
+        stats.jsonMessages++;
+    }
+    senderAddr = *addr;
+    senderPort = port;
+    simulatorUdpLink.frameReceived(arrivalUs);
+    post(msg, arrivalUs, SIM_PORT_UDP);
+}
+
+// X-Plane RREF reply (tcpip task). Replies are small (8 bytes per dataref),
+// so they always arrive in one pbuf.
+static void onXPlane(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, u16_t port) {
+    int64_t arrivalUs = esp_timer_get_time();
+    SimMessage msg;
+    bool ok = p->len == p->tot_len &&
+              decodeXPlaneRref((const uint8_t*)p->payload, p->len, &msg);
+    pbuf_free(p);
+    if (!ok) {
+        xplaneLink.counters.parseErrors++;
+        return;
+    }
+
+    // X-Plane's signs -> the autopilot's convention
+    msg.pitch *= XPLANE_PITCH_SIGN;
+    msg.roll *= XPLANE_ROLL_SIGN;
+    msg.verticalSpeed *= XPLANE_VS_SIGN;
+    msg.pitchRate *= XPLANE_PITCH_SIGN;
+    msg.rollRate *= XPLANE_ROLL_SIGN;
+
+    portENTER_CRITICAL(&xplaneMux);
+    xplaneLastReplyUs = arrivalUs;
+    portEXIT_CRITICAL(&xplaneMux);
+    xplaneStats.replies++;
+    xplaneLink.frameReceived(arrivalUs);
+    post(msg, arrivalUs, SIM_PORT_XPLANE);
+}
+
+// Runs in the tcpip task: the raw API is not thread safe
+static err_t bindUdp(struct tcpip_api_call_data* call) {
+    pcb = udp_new();
+    if (pcb == nullptr) {
+        return ERR_MEM;
+    }
+    err_t err = udp_bind(pcb, IP_ANY_TYPE, SIM_UDP_PORT);
+    if (err != ERR_OK) {
+        udp_remove(pcb);
+        pcb = nullptr;
+        return err;
+    }
+    udp_recv(pcb, onDatagram, nullptr);
+    return ERR_OK;
+}
+
+static err_t bindXPlane(struct tcpip_api_call_data* call) {
+    xplanePcb = udp_new();
+    if (xplanePcb == nullptr) {
+        return ERR_MEM;
+    }
+    err_t err = udp_bind(xplanePcb, IP_ANY_TYPE, XPLANE_LOCAL_PORT);
+    if (err != ERR_OK) {
+        udp_remove(xplanePcb);
+        xplanePcb = nullptr;
+        return err;
+    }
+    udp_recv(xplanePcb, onXPlane, nullptr);
+    return ERR_OK;
+}
+
+struct SubscribeCall {
+    struct tcpip_api_call_data base;
+    uint16_t rates[XPLANE_REF_COUNT];
+};
+
+// Send one RREF subscription per dataref (tcpip task). X-Plane replies to the source
+// port, i.e. to xplanePcb. Repeating a subscription only updates it.
+static err_t subscribeXPlane(struct tcpip_api_call_data* call) {
+    const SubscribeCall* sub = (const SubscribeCall*)call;
+    for (uint8_t ref = 0; ref < XPLANE_REF_COUNT; ref++) {
+        pbuf* p = pbuf_alloc(PBUF_TRANSPORT, XPLANE_RREF_REQUEST_SIZE, PBUF_RAM);
+        if (p == nullptr) {
+            return ERR_MEM;
+        }
+        buildXPlaneRrefRequest((XPlaneDataref)ref, sub->rates[ref], (uint8_t*)p->payload);
+        err_t err = udp_sendto(xplanePcb, p, &xplaneAddr, XPLANE_PORT);
+        pbuf_free(p);
+        if (err != ERR_OK) {
+            return err;
+        }
+    }
+    return ERR_OK;
+}
+
+struct SendCall {
+    struct tcpip_api_call_data base;
+    const char* data;
+    size_t len;
+};
+
+// Send to the last bridge that sent us a datagram (tcpip task)
+static err_t sendToSender(struct tcpip_api_call_data* call) {
+    const SendCall* send = (const SendCall*)call;
+    if (pcb == nullptr || senderPort == 0) {
+        return ERR_CONN;
+    }
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, send->len, PBUF_RAM);
+    if (p == nullptr) {
+        return ERR_MEM;
+    }
+    memcpy(p->payload, send->data, send->len);
+    err_t err = udp_sendto(pcb, p, &senderAddr, senderPort);
+    pbuf_free(p);
+    return err;
+}
+
+void initSimulatorUdp() {
+    for (uint16_t& rate : xplaneRates) {
+        rate = XPLANE_RREF_HZ;
+    }
+    if (!isWiFiEnabled()) {
+        return;
+    }
+
+    // The pcbs listen on any address, so they keep working across WiFi reconnects
+    struct tcpip_api_call_data call;
+    if (SIM_UDP_ENABLED) {
+        err_t err = tcpip_api_call(bindUdp, &call);
+        if (err != ERR_OK) {
+            LOG_ERRORF("Simulator UDP bind failed (err %d)", (int)err);
+        } else {
+            LOG_INFOF("Simulator UDP listening on port %d", SIM_UDP_PORT);
+        }
+    }
+
+    if (XPLANE_ENABLED) {
+        if (!ipaddr_aton(XPLANE_HOST, &xplaneAddr)) {
+            LOG_ERRORF("X-Plane host '%s' is not an IP address", XPLANE_HOST);
+            return;
+        }
+        err_t err = tcpip_api_call(bindXPlane, &call);
+        if (err != ERR_OK) {
+            LOG_ERRORF("X-Plane UDP bind failed (err %d)", (int)err);
+        } else {
+            LOG_INFOF("X-Plane RREF feed from %s:%d at %d Hz", XPLANE_HOST, XPLANE_PORT, XPLANE_RREF_HZ);
+        }
+    }
+}
+
+void handleXPlane() {
+    if (xplanePcb == nullptr || !isWiFiConnected()) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&xplaneMux);
+    int64_t lastReplyUs = xplaneLastReplyUs;
+    portEXIT_CRITICAL(&xplaneMux);
+
+    bool replying = lastReplyUs != 0 && now - lastReplyUs < (int64_t)XPLANE_TIMEOUT_MS * 1000;
+    if (replying != xplaneStats.connected) {
+        xplaneStats.connected = replying;
+        if (replying) {
+            LOG_INFO("X-Plane feed up");
+        } else {
+            LOG_WARN("X-Plane feed lost, resubscribing");
+        }
+    }
+
+    // Not subscribed yet, X-Plane restarted, or the link dropped: ask
+    // again, once per timeout so an absent sim isn't flooded. New rates
+    // go out at once.
+    if (!xplaneRatesChanged) {
+        if (replying) {
+            return;
+        }
+        if (xplaneLastSubscribeUs != 0 && now - xplaneLastSubscribeUs < (int64_t)XPLANE_TIMEOUT_MS * 1000) {
+            return;
+        }
+    }
+    xplaneLastSubscribeUs = now;
+    xplaneRatesChanged = false;
+
+    SubscribeCall call;
+    memcpy(call.rates, xplaneRates, sizeof(call.rates));
+    err_t err = tcpip_api_call(subscribeXPlane, &call.base);
+    if (err == ERR_OK) {
+        xplaneStats.subscriptions++;
+    } else {
+        xplaneStats.sendErrors++;
+    }
+}
+
+static_assert(SIM_FIELD_SPEED == 1 << XPLANE_REF_SPEED && SIM_FIELD_VS == 1 << XPLANE_REF_VS &&
+              SIM_FIELD_YAW_RATE == 1 << XPLANE_REF_YAW_RATE,
+              "X-Plane dataref order out of sync with SIM_FIELD_*");
+
+void setXPlaneRates(const SimFeedRequest& req) {
+    bool changed = false;
+    for (uint8_t ref = 0; ref < XPLANE_REF_COUNT; ref++) {
+        // Dataref order matches the SIM_FIELD_* bits. The sim time rides
+        // along at the fastest rate so every reply carries it.
+        uint16_t rate = (req.fields & (1 << ref)) ? req.hz : req.otherHz;
+        if (ref == XPLANE_REF_TIME) {
+            rate = req.hz > req.otherHz ? req.hz : req.otherHz;
+        }
+        if (rate != xplaneRates[ref]) {
+            xplaneRates[ref] = rate;
+            changed = true;
+        }
+    }
+    if (changed) {
+        xplaneRatesChanged = true;
+    }
+}
+
+bool sendSimulatorUdp(const char* data, size_t len) {
+    if (pcb == nullptr) {
+        return false;
+    }
+    SendCall call;
+    call.data = data;
+    call.len = len;
+    return tcpip_api_call(sendToSender, &call.base) == ERR_OK;
+}
+
+bool pollSimulatorUdp(SimMessage* msg, int64_t* arrivalUs, SimulatorPort* port) {
+    bool have = false;
+    portENTER_CRITICAL(&mailMux);
+    if (mailTail != mailHead) {
+        const SimUdpMail& m = mailbox[mailTail % SIM_UDP_MAILBOX];
+        *msg = m.msg;
+        *arrivalUs = m.arrivalUs;
+        *port = m.port;
+        mailTail++;
+        have = true;
+    }
+    portEXIT_CRITICAL(&mailMux);
+    return have;
+}
+
+SimParserStats getSimulatorUdpStats() {
+    return stats;
+}
+
+uint32_t getSimulatorUdpMailboxDrops() {
+    return mailboxDrops;
+}
+
+XPlaneStats getXPlaneStats() {
+    XPlaneStats s = xplaneStats;
+    s.enabled = xplanePcb != nullptr;
+    return s;
+}
@@ -2,80 +2,304 @@
 #include "config.h"
 #include "state.h"
 #include "logger.h"
-#include <ArduinoJson.h>
+#include "link_monitor.h"
+#include "scheduler.h"
+#include "sim_protocol.h"
+#include "sim_udp.h"
+#include "sim_feed.h"
+#include "sim_estimator.h"
+#include <USBCDC.h>
+#include <esp_timer.h>
 
-// Use the standard Serial (UART0) for simulator data as it's hardwired to the CH340 COM port
-// Note: With CDC_ON_BOOT=0, Serial is UART0 on GPIO 43/44.
-#define SimSerial Serial
+// Simulator data arrives on any of three sources:
+//   USB:  CDC-ACM channel on the joystick's own USB cable (composite with
+//         the HID joystick, full-speed USB - baud rate is ignored)
+//   UDP:  datagrams over WiFi (sim_udp.cpp), or X-Plane's own RREF feed
+//   UART: Serial (UART0, GPIO 43/44) via the board's CH340 COM port.
+//         With CDC_ON_BOOT=0, Serial stays UART0.
+// All are read every time. Which message gets applied is decided in
+// acceptMessage() (see config.h), so two senders can't fight over
+// state.simulator.
+static USBCDC SimUsb;
+#define SimUart Serial
 
-// Line buffer for JSON messages
-#define SIM_LINE_BUF_SIZE 256
-static char lineBuf[SIM_LINE_BUF_SIZE];
-static size_t lineLen = 0;
+// Framing / parse state (one per port so messages never mix)
+static SimParser usbParser;
+static SimParser uartParser;
+
+// Per-source arbitration state and statistics (control task)
+struct SimSource {
+    int64_t lastUs = 0;     // Last message received (0 = never)
+    uint32_t applied = 0;
+    uint32_t dropped = 0;   // Older sim time, or another source active
+    ProfileStats lag;       // Behind the source that delivered the same sim time first (us)
+};
+static SimSource sources[SIM_PORT_COUNT];
+static portMUX_TYPE sourceMux = portMUX_INITIALIZER_UNLOCKED;  // lastUs, lag: read by the web task
+
+// Extrapolates the applied messages for the fixed-rate autopilot (control task)
+static SimEstimator estimator;
+
+static SimulatorPort activePort = SIM_PORT_NONE;
+static bool haveSimTime = false;
+static uint32_t lastSimTimeMs = 0;   // Newest sim time applied
+static int64_t lastSimTimeUs = 0;    // ... and when it arrived
+
+#if SIM_USB_RX_EVENTS
+// USB event task: wake the control task so the message is handled right away
+static void onUsbEvent(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    controlScheduler.wake();
+}
+#endif
 
 void initSimulatorSerial() {
     // Serial is already initialized in main.cpp, but ensure baud rate matches
-    SimSerial.begin(SIM_SERIAL_BAUD);
+    SimUart.begin(SIM_SERIAL_BAUD);
+    simulatorLink.attachUart(SimUart);
+
+    // The CDC interface registered itself with TinyUSB when SimUsb was
+    // constructed, so it is part of the configuration USB.begin() started
+    SimUsb.setRxBufferSize(SIM_USB_RX_BUFFER);
+    SimUsb.begin();
+#if SIM_USB_RX_EVENTS
+    SimUsb.onEvent(ARDUINO_USB_CDC_RX_EVENT, onUsbEvent);
+#endif
+    // USB events and UDP datagrams wake the control task
+    controlScheduler.addWakeHandler(handleSimulatorSerial);
+    resetSimSourceStats();
 
-    LOG_INFO("Simulator serial initialized (using Serial UART0)");
-    LOG_INFOF("  Baud rate: %d", SIM_SERIAL_BAUD);
+    SimEstimatorSettings est;
+    est.alpha = SIM_EST_ALPHA;
+    est.beta = SIM_EST_BETA;
+    est.maxPredictUs = SIM_EST_MAX_PREDICT_MS * 1000;
+    est.resetUs = SIM_EST_RESET_MS * 1000;
+    est.diffSamples = SIM_DIFF_SAMPLES;
+    est.diffOrder = SIM_DIFF_ORDER;
+    estimator.configure(est);
+
+    LOG_INFO("Simulator serial initialized (USB CDC, Serial UART0 fallback)");
+    LOG_INFOF("  UART baud rate: %d", SIM_SERIAL_BAUD);
 }
 
-static void processLine(const char* line) {
-    StaticJsonDocument<256> doc;
-    DeserializationError err = deserializeJson(doc, line);
+static void processMessage(const SimMessage& msg, int64_t arrivalUs) {
+    state.simulator.lastUpdateMs = millis();
+    state.simulator.lastUpdateUs = arrivalUs;
+    state.simulator.valid = true;
+    if (msg.hasTime) {
+        state.simulator.simTimeMs = msg.simTimeMs;
+    }
 
-    if (err) {
-        LOG_DEBUGF("Simulator JSON parse error: %s", err.c_str());
-        return;
+    if (msg.fields & SIM_FIELD_SPEED) {
+        state.simulator.speed = msg.speed;
+    }
+    if (msg.fields & SIM_FIELD_ALTITUDE) {
+        state.simulator.altitude = msg.altitude;
+    }
+    if (msg.fields & SIM_FIELD_PITCH) {
+        state.simulator.pitch = msg.pitch;
+    }
+    if (msg.fields & SIM_FIELD_ROLL) {
+        state.simulator.roll = msg.roll;
+    }
+    if (msg.fields & SIM_FIELD_HEADING) {
+        state.simulator.heading = msg.heading;
+    }
+    if (msg.fields & SIM_FIELD_VS) {
+        state.simulator.verticalSpeed = msg.verticalSpeed;
     }
+    estimator.update(msg, arrivalUs);
+}
 
-    unsigned long now = millis();
-    state.simulator.lastUpdateMs = now;
-    state.simulator.valid = true;
-    state.simulator.dataUpdated = true;
+// Higher wins when messages carry no sim time
+static uint8_t sourcePriority(SimulatorPort port) {
+    switch (port) {
+        case SIM_PORT_USB:    return 3;
+        case SIM_PORT_UDP:    return 2;
+        case SIM_PORT_XPLANE: return 2;
+        case SIM_PORT_UART:   return 1;
+        default:              return 0;
+    }
+}
 
-    if (doc.containsKey("spd")) {
-        state.simulator.speed = doc["spd"].as<float>();
+static bool sourceAlive(SimulatorPort port, int64_t nowUs) {
+    const SimSource& s = sources[port];
+    return s.lastUs != 0 && nowUs - s.lastUs < (int64_t)SIM_SOURCE_HOLD_MS * 1000;
+}
+
+// Decide whether a message from port replaces the current simulator data
+static bool acceptMessage(SimulatorPort port, const SimMessage& msg, int64_t arrivalUs) {
+    SimSource& src = sources[port];
+    portENTER_CRITICAL(&sourceMux);
+    src.lastUs = arrivalUs;
+    portEXIT_CRITICAL(&sourceMux);
+
+    // Timestamped: the freshest sim state wins, whatever the source. The
+    // check lapses once no newer data has come for SIM_SOURCE_HOLD_MS, so
+    // a restarted sim (clock back at 0) is picked up again.
+    bool simTimeCurrent = haveSimTime &&
+                          arrivalUs - lastSimTimeUs < (int64_t)SIM_SOURCE_HOLD_MS * 1000;
+    if (msg.hasTime && simTimeCurrent) {
+        int32_t ahead = (int32_t)(msg.simTimeMs - lastSimTimeMs);
+        if (ahead == 0 && port != activePort) {
+            portENTER_CRITICAL(&sourceMux);
+            src.lag.record((uint32_t)(arrivalUs - lastSimTimeUs));
+            portEXIT_CRITICAL(&sourceMux);
+        }
+        if (ahead <= 0) {
+            src.dropped++;
+            return false;
+        }
+        return true;
     }
-    if (doc.containsKey("alt")) {
-        state.simulator.altitude = doc["alt"].as<float>();
+    if (msg.hasTime) {
+        return true;
     }
-    if (doc.containsKey("pitch")) {
-        state.simulator.pitch = doc["pitch"].as<float>();
+
+    // No sim time: stay with the active source while it is alive; a
+    // higher-priority source takes over at once
+    if (port == activePort || activePort == SIM_PORT_NONE ||
+        !sourceAlive(activePort, arrivalUs) ||
+        sourcePriority(port) > sourcePriority(activePort)) {
+        return true;
     }
-    if (doc.containsKey("roll")) {
-        state.simulator.roll = doc["roll"].as<float>();
+    src.dropped++;
+    return false;
+}
+
+static void submitMessage(SimulatorPort port, const SimMessage& msg, int64_t arrivalUs) {
+    if (msg.hasAck) {
+        // Even a message that loses arbitration shows the bridge heard us
+        simFeedAcked(msg.ack);
     }
-    if (doc.containsKey("hdg")) {
-        state.simulator.heading = doc["hdg"].as<float>();
+    if (!acceptMessage(port, msg, arrivalUs)) {
+        return;
+    }
+    sources[port].applied++;
+    if (msg.hasTime) {
+        haveSimTime = true;
+        lastSimTimeMs = msg.simTimeMs;
+        lastSimTimeUs = arrivalUs;
     }
-    if (doc.containsKey("vs")) {
-        state.simulator.verticalSpeed = doc["vs"].as<float>();
+    if (port != activePort) {
+        activePort = port;
+        static const char* const portNames[] = {"none", "USB CDC", "UART", "UDP", "X-Plane"};
+        LOG_INFOF("Simulator data via %s", portNames[port]);
     }
+    processMessage(msg, arrivalUs);
 }
 
-void handleSimulatorSerial() {
-    while (SimSerial.available() > 0) {
-        char c = SimSerial.read();
-
-        if (c == '\n' || c == '\r') {
-            if (lineLen > 0) {
-                lineBuf[lineLen] = '\0';
-                processLine(lineBuf);
-                lineLen = 0;
-            }
-            if (c == '\r' && SimSerial.available() && SimSerial.peek() == '\n') {
-                SimSerial.read();  // consume \n after \r
-            }
-        } else if (lineLen < SIM_LINE_BUF_SIZE - 1) {
-            lineBuf[lineLen++] = c;
-        } else {
-            // Buffer overflow, discard line
-            lineLen = 0;
-            while (SimSerial.available() && SimSerial.peek() != '\n' && SimSerial.peek() != '\r') {
-                SimSerial.read();
+// Feed whatever the port has through its parser and submit each message.
+// Returns after the input is drained.
+static void readMessages(Stream& port, SimParser& parser, LinkMonitor& link, SimulatorPort source) {
+    // Counted as a change so a counter reset from the web UI sticks
+    uint32_t discardedBefore = parser.getStats().discardedBytes;
+    while (port.available() > 0) {
+        SimMessage msg;
+        switch (parser.push((uint8_t)port.read(), &msg)) {
+            case SIM_EVENT_MESSAGE: {
+                int64_t arrivalUs = esp_timer_get_time();
+                link.frameReceived(arrivalUs);
+                submitMessage(source, msg, arrivalUs);
+                break;
             }
+            case SIM_EVENT_PARSE_ERROR:
+                link.counters.parseErrors++;
+                break;
+            case SIM_EVENT_CRC_ERROR:
+                link.counters.checksumErrors++;
+                break;
+            case SIM_EVENT_OVERFLOW:
+                link.counters.lineOverflows++;
+                link.counters.resyncs++;
+                break;
+            case SIM_EVENT_NONE:
+                break;
         }
     }
+    link.counters.discardedBytes += parser.getStats().discardedBytes - discardedBefore;
+}
+
+void handleSimulatorSerial() {
+    readMessages(SimUsb, usbParser, simulatorUsbLink, SIM_PORT_USB);
+
+    SimMessage msg;
+    int64_t arrivalUs;
+    SimulatorPort port;
+    while (pollSimulatorUdp(&msg, &arrivalUs, &port)) {
+        submitMessage(port, msg, arrivalUs);
+    }
+
+    readMessages(SimUart, uartParser, simulatorLink, SIM_PORT_UART);
+}
+
+bool estimateSimulator(SimChannel ch, int64_t nowUs, float* out) {
+    return estimator.predict(ch, nowUs, out);
+}
+
+SimChannelStats getSimChannelStats(SimChannel ch) {
+    return estimator.getStats(ch);
+}
+
+SimRateSource estimateSimulatorRate(SimRateAxis axis, int64_t nowUs, float* out) {
+    return estimator.rate(axis, nowUs, out);
+}
+
+SimRateStats getSimRateStats(SimRateAxis axis, int64_t nowUs) {
+    return estimator.getRateStats(axis, nowUs);
+}
+
+void sendSimulatorLine(SimulatorPort port, const char* line, size_t len) {
+    // Not while no host has the CDC port open: nothing would drain the
+    // TX buffer
+    if ((port == SIM_PORT_USB || port == SIM_PORT_NONE) && SimUsb) {
+        SimUsb.write((const uint8_t*)line, len);
+    }
+    if (port == SIM_PORT_UART || port == SIM_PORT_NONE) {
+        // UART0 also carries the log: the whole line goes out in one write
+        logger.writeSerial((const uint8_t*)line, len);
+    }
+    if (port == SIM_PORT_UDP || port == SIM_PORT_NONE) {
+        sendSimulatorUdp(line, len);
+    }
+}
+
+SimulatorPort getSimulatorPort() {
+    return activePort;
+}
+
+SimSourceStats getSimSourceStats(SimulatorPort port) {
+    SimSourceStats stats;
+    const SimSource& src = sources[port];
+    portENTER_CRITICAL(&sourceMux);
+    int64_t lastUs = src.lastUs;
+    src.lag.summarize(stats.lag);
+    portEXIT_CRITICAL(&sourceMux);
+    stats.ageUs = lastUs == 0 ? -1 : esp_timer_get_time() - lastUs;
+    stats.applied = src.applied;
+    stats.dropped = src.dropped;
+    return stats;
+}
+
+void resetSimSourceStats() {
+    portENTER_CRITICAL(&sourceMux);
+    for (SimSource& src : sources) {
+        src.applied = 0;
+        src.dropped = 0;
+        src.lag.reset();
+    }
+    portEXIT_CRITICAL(&sourceMux);
+}
+
+SimParserStats getSimParserStats() {
+    const SimParserStats& u = usbParser.getStats();
+    const SimParserStats& s = uartParser.getStats();
+    SimParserStats d = getSimulatorUdpStats();
+    SimParserStats total;
+    total.jsonMessages = u.jsonMessages + s.jsonMessages + d.jsonMessages;
+    total.binaryMessages = u.binaryMessages + s.binaryMessages + d.binaryMessages;
+    total.discardedBytes = u.discardedBytes + s.discardedBytes + d.discardedBytes;
+    total.lost = u.lost + s.lost + d.lost;
+    total.duplicates = u.duplicates + s.duplicates + d.duplicates;
+    total.reordered = u.reordered + s.reordered + d.reordered;
+    return total;
 }
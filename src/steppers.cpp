@@ -3,6 +3,7 @@
 #include "logger.h"
 #include "buzzer.h"
 #include "state.h"
+#include "ffb.h"
 
 // Motor hold states
 static bool collectiveHeld = false;
@@ -108,8 +109,9 @@ void handleSteppers() {
         return; // skip normal processing
     }
 
-    // Ensure state is correct when transitioning from debug
-    if (cyclicHeld) {
+    // Ensure state is correct when transitioning from debug. Force feedback
+    // energises the motors while an effect pushes the stick.
+    if (cyclicHeld || isFfbEngaged()) {
         digitalWrite(PIN_CYCLIC_X_ENABLED, LOW);
         digitalWrite(PIN_CYCLIC_Y_ENABLED, LOW);
     } else {
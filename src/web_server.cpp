@@ -5,8 +5,14 @@
 #include "joystick.h"
 #include "cyclic_serial.h"
 #include "collective.h"
+#include "simulator_serial.h"
+#include "sim_udp.h"
+#include "sim_feed.h"
+#include "ffb.h"
 #include "state.h"
 #include "ap.h"
+#include "sampler.h"
+#include "link_monitor.h"
 
 // Autopilot mode to string for JSON API
 static const char* apHorizontalModeStr(APHorizontalMode m) {
@@ -26,6 +32,12 @@ static const char* apVerticalModeStr(APVerticalMode m) {
         default: return "off";
     }
 }
+
+static const char* const simPortNames[SIM_PORT_COUNT] = {"none", "usb", "uart", "udp", "xplane"};
+static const char* const simFeedStatusNames[] = {"off", "pending", "acked", "ignored", "xplane"};
+static const char* const simChannelNames[SIM_CH_COUNT] = {"pitch", "roll", "heading", "vs", "altitude"};
+static const char* const simRateNames[SIM_RATE_COUNT] = {"pitch", "roll", "yaw"};
+static const char* const simRateSourceNames[] = {"none", "measured", "derived"};
 #include <WiFi.h>
 #include <WebServer.h>
 #include <WebSocketsServer.h>
@@ -34,8 +46,10 @@ static const char* apVerticalModeStr(APVerticalMode m) {
 #include <ArduinoOTA.h>
 #include <LittleFS.h>
 #include <ESP.h>
+#include <esp_timer.h>
 #include <freertos/task.h>
 #include "profile.h"
+#include "scheduler.h"
 
 // Helper function to check if WiFi is enabled
 bool isWiFiEnabled() {
@@ -163,8 +177,70 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
     }
 }
 
+// Capacity for buildStateJson() documents (heap-allocated, see /api/debug)
+#define STATE_JSON_SIZE 2560
+
+// Compact p50/p95/max latency entry for the state JSON
+static void addLatencyJson(JsonObject parent, const char* key, const ProfileSummary& p) {
+    JsonObject o = parent.createNestedObject(key);
+    o["count"] = p.count;
+    o["p50Us"] = p.p50Us;
+    o["p95Us"] = p.p95Us;
+    o["maxUs"] = p.maxUs;
+}
+
+static void addFilterJson(JsonObject parent, const char* key, const AxisFilterSettings& f) {
+    JsonObject o = parent.createNestedObject(key);
+    o["enabled"] = f.enabled;
+    o["minCutoffHz"] = f.minCutoffHz;
+    o["beta"] = f.beta;
+    o["dCutoffHz"] = f.dCutoffHz;
+}
+
+// Apply the fields present in a JSON object to filter settings
+static void readFilterJson(JsonObjectConst o, AxisFilterSettings& f) {
+    if (o.containsKey("enabled")) f.enabled = o["enabled"].as<bool>();
+    if (o.containsKey("minCutoffHz")) f.minCutoffHz = o["minCutoffHz"].as<float>();
+    if (o.containsKey("beta")) f.beta = o["beta"].as<float>();
+    if (o.containsKey("dCutoffHz")) f.dCutoffHz = o["dCutoffHz"].as<float>();
+}
+
+// Response curve of an axis by API name, nullptr if unknown
+static ResponseCurveSettings* curveByName(const char* name) {
+    if (name == nullptr) return nullptr;
+    if (strcmp(name, "cyclicX") == 0) return &state.joystick.cyclicXCurve;
+    if (strcmp(name, "cyclicY") == 0) return &state.joystick.cyclicYCurve;
+    if (strcmp(name, "collective") == 0) return &state.joystick.collectiveCurve;
+    return nullptr;
+}
+
+static void addCurveJson(JsonObject parent, const char* key, const ResponseCurveSettings& c) {
+    JsonObject o = parent.createNestedObject(key);
+    o["type"] = responseCurveTypeName(c.type);
+    o["amount"] = c.amount;
+    JsonArray points = o.createNestedArray("points");
+    for (uint8_t i = 0; i < c.pointCount; i++) {
+        JsonArray p = points.createNestedArray();
+        p.add(c.points[i].in);
+        p.add(c.points[i].out);
+    }
+}
+
+static void sendCurvesJson() {
+    StaticJsonDocument<1024> doc;
+    JsonObject root = doc.to<JsonObject>();
+    addCurveJson(root, "cyclicX", state.joystick.cyclicXCurve);
+    addCurveJson(root, "cyclicY", state.joystick.cyclicYCurve);
+    addCurveJson(root, "collective", state.joystick.collectiveCurve);
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
 // Build complete state as JSON (for API and WebSocket)
 static void buildStateJson(JsonDocument& doc) {
+    PROFILE_ZONE("web.buildStateJson");
+
     // Update cyclic validity (computed from last packet time)
     (void)isCyclicDataValid();
 
@@ -177,6 +253,10 @@ static void buildStateJson(JsonDocument& doc) {
     sensors["rawY"] = state.sensors.cyclicYRaw;
     sensors["rawZ"] = state.sensors.collectiveRaw;
 
+    JsonObject filters = doc.createNestedObject("filters");
+    addFilterJson(filters, "cyclic", state.sensors.cyclicFilter);
+    addFilterJson(filters, "collective", state.sensors.collectiveFilter);
+
     JsonObject joystick = doc.createNestedObject("joystick");
     joystick["cyclicX"] = state.joystick.cyclicX;
     joystick["cyclicY"] = state.joystick.cyclicY;
@@ -213,6 +293,7 @@ static void buildStateJson(JsonDocument& doc) {
     simulator["heading"] = state.simulator.heading;
     simulator["verticalSpeed"] = state.simulator.verticalSpeed;
     simulator["valid"] = state.simulator.valid;
+    simulator["port"] = simPortNames[getSimulatorPort()];
     
     long age = -1;
     if (state.simulator.lastUpdateMs > 0) {
@@ -249,10 +330,46 @@ static void buildStateJson(JsonDocument& doc) {
     debug["active"] = state.motorDebugActive;
     debug["stepsX"] = state.debugMotorXSteps;
     debug["stepsY"] = state.debugMotorYSteps;
+
+    // Sample-to-HID-report latency, per axis and per input source
+    JsonObject latency = doc.createNestedObject("latency");
+    JsonObject axes = latency.createNestedObject("axes");
+    addLatencyJson(axes, "cyclicX", getAxisLatency(AXIS_CYCLIC_X));
+    addLatencyJson(axes, "cyclicY", getAxisLatency(AXIS_CYCLIC_Y));
+    addLatencyJson(axes, "collective", getAxisLatency(AXIS_COLLECTIVE));
+    JsonObject sources = latency.createNestedObject("sources");
+    addLatencyJson(sources, "cyclicSensor", getSourceLatency(SOURCE_CYCLIC_SENSOR));
+    addLatencyJson(sources, "collectiveSensor", getSourceLatency(SOURCE_COLLECTIVE_SENSOR));
+    addLatencyJson(sources, "autopilot", getSourceLatency(SOURCE_AUTOPILOT));
+}
+
+// Append one scheduler's tick and per-task stats to the /api/debug arrays
+static void addSchedulerJson(const Scheduler& sch, JsonArray schedulers, JsonArray tasks) {
+    JsonObject so = schedulers.createNestedObject();
+    so["name"] = sch.getName();
+    so["tickMs"] = sch.getTickMs();
+    so["maxTickLateUs"] = sch.getMaxTickLateUs();
+    so["wakeups"] = sch.getWakeups();
+
+    for (uint8_t i = 0; i < sch.getTaskCount(); i++) {
+        const SchedTaskStats& s = sch.getStats(i);
+        JsonObject o = tasks.createNestedObject();
+        o["scheduler"] = sch.getName();
+        o["name"] = s.name;
+        o["periodMs"] = s.periodMs;
+        o["runs"] = s.runs;
+        o["overruns"] = s.overruns;
+        o["missed"] = s.missed;
+        o["jitterUs"] = s.lastJitterUs;
+        o["maxJitterUs"] = s.maxJitterUs;
+        o["execUs"] = s.lastExecUs;
+        o["maxExecUs"] = s.maxExecUs;
+    }
 }
 
 // Send complete state only to clients that are due for an update
 void updateWebSocketClients() {
+    PROFILE_ZONE("web.wsUpdate");
     unsigned long now = millis();
     bool needBuild = false;
     
@@ -264,7 +381,7 @@ void updateWebSocketClients() {
     }
     
     if (needBuild) {
-        StaticJsonDocument<1024> doc;
+        DynamicJsonDocument doc(STATE_JSON_SIZE);
         buildStateJson(doc);
         String json;
         serializeJson(doc, json);
@@ -374,7 +491,9 @@ void initWebServer() {
                 }
             });
             server.on("/api/debug", []() {
-                StaticJsonDocument<768> doc;
+                PROFILE_ZONE("http.debug");
+                // Heap-allocated: task tables outgrow the web task's 4 KB stack
+                DynamicJsonDocument doc(16384);
                 doc["uptimeMs"] = millis();
                 doc["freeHeap"] = ESP.getFreeHeap();
                 doc["minFreeHeap"] = ESP.getMinFreeHeap();
@@ -385,19 +504,245 @@ void initWebServer() {
                 TaskHandle_t t = xTaskGetCurrentTaskHandle();
                 UBaseType_t stackLeft = (t != NULL) ? uxTaskGetStackHighWaterMark(t) : 0;
                 doc["stackHighWaterMark"] = stackLeft * 4;  // words to bytes
-                JsonArray tasks = doc.createNestedArray("loopTasks");
-                for (uint8_t i = 0; i < PROFILE_SLOT_COUNT; i++) {
-                    JsonObject o = tasks.createNestedObject();
-                    o["name"] = profileGetName(i);
-                    o["lastMs"] = profileGetLastMs(i);
-                    o["maxMs"] = profileGetMaxMs(i);
+                JsonArray zones = doc.createNestedArray("zones");
+                for (ProfileZone* z = ProfileZone::first(); z != nullptr; z = z->getNext()) {
+                    ProfileSummary p = z->summary();
+                    JsonObject o = zones.createNestedObject();
+                    o["name"] = p.name;
+                    o["count"] = p.count;
+                    o["lastUs"] = p.lastUs;
+                    o["minUs"] = p.minUs;
+                    o["avgUs"] = p.avgUs;
+                    o["maxUs"] = p.maxUs;
+                    o["p50Us"] = p.p50Us;
+                    o["p95Us"] = p.p95Us;
+                    o["p99Us"] = p.p99Us;
+                    o["p999Us"] = p.p999Us;
+                }
+                JsonObject cyclicRx = doc.createNestedObject("cyclicRx");
+                unsigned long cyclicAge = getCyclicDataAge();
+                cyclicRx["ageMs"] = (cyclicAge == ULONG_MAX) ? -1L : (long)cyclicAge;
+                cyclicRx["latencyUs"] = getCyclicRxLatencyUs();
+                cyclicRx["avgLatencyUs"] = getCyclicRxLatencyAvgUs();
+                cyclicRx["maxLatencyUs"] = getCyclicRxLatencyMaxUs();
+                const CyclicParserStats& parserStats = getCyclicParserStats();
+                cyclicRx["frames"] = parserStats.frames;
+                cyclicRx["badFrames"] = parserStats.badFrames;
+                cyclicRx["skippedBytes"] = parserStats.skippedBytes;
+                cyclicRx["version"] = parserStats.lastVersion;
+                cyclicRx["baud"] = getCyclicBaud();
+                cyclicRx["framesV2"] = parserStats.framesV2;
+                cyclicRx["lost"] = parserStats.lost;
+                cyclicRx["duplicates"] = parserStats.duplicates;
+                cyclicRx["reordered"] = parserStats.reordered;
+                cyclicRx["sampleAgeUs"] = getCyclicSampleAgeUs();
+                cyclicRx["maxSampleAgeUs"] = getCyclicSampleAgeMaxUs();
+                JsonObject simRx = doc.createNestedObject("simRx");
+                SimParserStats simStats = getSimParserStats();
+                simRx["jsonMessages"] = simStats.jsonMessages;
+                simRx["binaryMessages"] = simStats.binaryMessages;
+                simRx["lost"] = simStats.lost;
+                simRx["duplicates"] = simStats.duplicates;
+                simRx["reordered"] = simStats.reordered;
+                simRx["simTimeMs"] = state.simulator.simTimeMs;
+                JsonArray simSources = simRx.createNestedArray("sources");
+                for (uint8_t port = SIM_PORT_USB; port < SIM_PORT_COUNT; port++) {
+                    SimSourceStats src = getSimSourceStats((SimulatorPort)port);
+                    JsonObject o = simSources.createNestedObject();
+                    o["name"] = simPortNames[port];
+                    o["ageMs"] = src.ageUs < 0 ? -1L : (long)(src.ageUs / 1000);
+                    o["applied"] = src.applied;
+                    o["dropped"] = src.dropped;
+                    o["lagP50Us"] = src.lag.p50Us;
+                    o["lagP99Us"] = src.lag.p99Us;
+                    o["lagCount"] = src.lag.count;
                 }
+                simRx["udpMailboxDrops"] = getSimulatorUdpMailboxDrops();
+                JsonArray simEstimate = doc.createNestedArray("simEstimate");
+                int64_t estNowUs = esp_timer_get_time();
+                for (uint8_t ch = 0; ch < SIM_CH_COUNT; ch++) {
+                    SimChannelStats est = getSimChannelStats((SimChannel)ch);
+                    JsonObject o = simEstimate.createNestedObject();
+                    o["name"] = simChannelNames[ch];
+                    o["valid"] = est.valid;
+                    o["value"] = est.value;
+                    o["rate"] = est.rate;
+                    o["innovation"] = est.innovation;
+                    o["innovationRms"] = est.innovationRms;
+                    o["ageMs"] = est.valid ? (long)((estNowUs - est.lastUs) / 1000) : -1L;
+                    o["updates"] = est.updates;
+                    o["resets"] = est.resets;
+                }
+                JsonArray simRates = doc.createNestedArray("simRates");
+                for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+                    SimRateStats rate = getSimRateStats((SimRateAxis)axis, estNowUs);
+                    JsonObject o = simRates.createNestedObject();
+                    o["name"] = simRateNames[axis];
+                    o["source"] = simRateSourceNames[rate.source];
+                    o["measured"] = rate.measured;
+                    o["derived"] = rate.derived;
+                    o["measuredAgeMs"] = rate.measuredUs ? (long)((estNowUs - rate.measuredUs) / 1000) : -1L;
+                }
+                JsonObject simFeed = doc.createNestedObject("simFeed");
+                SimFeedStats feedStats = getSimFeedStats();
+                simFeed["status"] = simFeedStatusNames[feedStats.status];
+                simFeed["id"] = feedStats.id;
+                simFeed["fields"] = feedStats.request.fields;
+                simFeed["hz"] = feedStats.request.hz;
+                simFeed["otherHz"] = feedStats.request.otherHz;
+                simFeed["requestsSent"] = feedStats.requestsSent;
+                simFeed["acks"] = feedStats.acks;
+                JsonObject xplane = doc.createNestedObject("xplane");
+                XPlaneStats xplaneStats = getXPlaneStats();
+                xplane["enabled"] = xplaneStats.enabled;
+                xplane["connected"] = xplaneStats.connected;
+                xplane["subscriptions"] = xplaneStats.subscriptions;
+                xplane["sendErrors"] = xplaneStats.sendErrors;
+                xplane["replies"] = xplaneStats.replies;
+                JsonObject hid = doc.createNestedObject("hid");
+                HidStats hidStats = getHidStats();
+                hid["reports"] = hidStats.reports;
+                hid["rateHz"] = hidStats.rateHz;
+                hid["busy"] = hidStats.busy;
+                hid["failed"] = hidStats.failed;
+                JsonObject hidSend = hid.createNestedObject("sendLatency");
+                hidSend["p50Us"] = hidStats.sendLatency.p50Us;
+                hidSend["p99Us"] = hidStats.sendLatency.p99Us;
+                hidSend["maxUs"] = hidStats.sendLatency.maxUs;
+                JsonArray hidAxes = hid.createNestedArray("axes");
+                static const char* const hidAxisNames[JOYSTICK_AXIS_COUNT] = {"cyclicX", "cyclicY", "collective"};
+                for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; axis++) {
+                    AxisReportStats r = getAxisReportStats(axis);
+                    JsonObject o = hidAxes.createNestedObject();
+                    o["name"] = hidAxisNames[axis];
+                    o["sent"] = r.sent;
+                    o["settled"] = r.settled;
+                    o["suppressed"] = r.suppressed;
+                }
+                JsonObject ffb = doc.createNestedObject("ffb");
+                FfbStats ffbStats = getFfbStats();
+                ffb["outputReports"] = ffbStats.outputReports;
+                ffb["featureReports"] = ffbStats.featureReports;
+                ffb["badReports"] = ffbStats.badReports;
+                ffb["effectsCreated"] = ffbStats.effectsCreated;
+                ffb["poolFull"] = ffbStats.poolFull;
+                ffb["playing"] = ffbStats.playing;
+                ffb["actuators"] = ffbStats.actuatorsEnabled;
+                ffb["paused"] = ffbStats.paused;
+                ffb["engaged"] = ffbStats.engaged;
+                ffb["gain"] = ffbStats.deviceGain;
+                ffb["forceX"] = ffbStats.forceX;
+                ffb["forceY"] = ffbStats.forceY;
+                ffb["stepsX"] = ffbStats.stepsX;
+                ffb["stepsY"] = ffbStats.stepsY;
+                JsonObject ffbLatency = ffb.createNestedObject("reportToForce");
+                ffbLatency["p50Us"] = ffbStats.reportToForce.p50Us;
+                ffbLatency["p99Us"] = ffbStats.reportToForce.p99Us;
+                ffbLatency["maxUs"] = ffbStats.reportToForce.maxUs;
+                JsonObject collectiveRx = doc.createNestedObject("collectiveRx");
+                CollectiveStats collectiveStats = getCollectiveStats();
+                collectiveRx["reads"] = collectiveStats.reads;
+                collectiveRx["rateHz"] = collectiveStats.rateHz;
+                collectiveRx["busErrors"] = collectiveStats.busErrors;
+                collectiveRx["recoveries"] = collectiveStats.recoveries;
+                JsonArray links = doc.createNestedArray("links");
+                for (LinkMonitor* l = LinkMonitor::first(); l != nullptr; l = l->getNext()) {
+                    JsonObject o = links.createNestedObject();
+                    o["name"] = l->getName();
+                    o["rateHz"] = l->getRateHz();
+                    o["goodFrames"] = l->counters.goodFrames;
+                    o["checksumErrors"] = l->counters.checksumErrors;
+                    o["resyncs"] = l->counters.resyncs;
+                    o["lineOverflows"] = l->counters.lineOverflows;
+                    o["parseErrors"] = l->counters.parseErrors;
+                    o["discardedBytes"] = l->counters.discardedBytes;
+                    o["uartErrors"] = l->counters.uartErrors;
+                    ProfileSummary gap = l->getInterArrival();
+                    JsonObject g = o.createNestedObject("interArrival");
+                    g["p50Us"] = gap.p50Us;
+                    g["p99Us"] = gap.p99Us;
+                    g["maxUs"] = gap.maxUs;
+                }
+                JsonArray schedulers = doc.createNestedArray("schedulers");
+                JsonArray sched = doc.createNestedArray("schedTasks");
+                addSchedulerJson(controlScheduler, schedulers, sched);
+                addSchedulerJson(housekeepingScheduler, schedulers, sched);
+                String json;
+                serializeJson(doc, json);
+                server.send(200, "application/json", json);
+            });
+            server.on("/api/debug/reset", HTTP_POST, []() {
+                profileResetAll();
+                for (LinkMonitor* l = LinkMonitor::first(); l != nullptr; l = l->getNext()) {
+                    l->reset();
+                }
+                resetSimSourceStats();
+                controlScheduler.resetStats();
+                housekeepingScheduler.resetStats();
+                LOG_INFO("Profiling statistics reset");
+                server.send(200, "application/json", "{\"status\":\"ok\"}");
+            });
+            server.on("/api/sampler", HTTP_GET, []() {
+                StaticJsonDocument<128> doc;
+                doc["running"] = isSamplerRunning();
+                doc["samples"] = getSamplerCount();
+                doc["capacity"] = getSamplerCapacity();
+                doc["hz"] = getSamplerSampleHz();
                 String json;
                 serializeJson(doc, json);
                 server.send(200, "application/json", json);
             });
+            server.on("/api/sampler/start", HTTP_POST, []() {
+                bool ok = startSampler();
+                server.send(ok ? 200 : 500, "application/json",
+                            ok ? "{\"status\":\"ok\"}" : "{\"error\":\"Sampler start failed\"}");
+            });
+            server.on("/api/sampler/stop", HTTP_POST, []() {
+                stopSampler();
+                server.send(200, "application/json", "{\"status\":\"ok\"}");
+            });
+            server.on("/api/sampler/samples", HTTP_GET, []() {
+                // Text dump for tools/pc_report.py: task table, then one line
+                // per sample. Streamed in chunks - 8k samples is ~150 KB.
+                if (isSamplerRunning()) {
+                    server.send(409, "application/json", "{\"error\":\"Stop the sampler first\"}");
+                    return;
+                }
+                // Stopped by a full buffer: remove the hooks and name the tasks now
+                if (isSamplerStopPending()) {
+                    stopSampler();
+                }
+                server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+                server.send(200, "text/plain", "");
+                char buf[1024];
+                size_t len = snprintf(buf, sizeof(buf), "# pc-samples hz=%lu\n", getSamplerSampleHz());
+                len += snprintf(buf + len, sizeof(buf) - len, "T,%u,%s\n",
+                                SAMPLER_TASK_ISR, getSamplerTaskName(SAMPLER_TASK_ISR));
+                for (uint8_t t = 0; t < getSamplerTaskCount(); t++) {
+                    if (len > sizeof(buf) - 64) {
+                        server.sendContent(buf, len);
+                        len = 0;
+                    }
+                    len += snprintf(buf + len, sizeof(buf) - len, "T,%u,%s\n", t, getSamplerTaskName(t));
+                }
+                uint32_t pc;
+                uint8_t core;
+                uint8_t task;
+                for (uint32_t i = 0; getSamplerSample(i, &pc, &core, &task); i++) {
+                    if (len > sizeof(buf) - 32) {
+                        server.sendContent(buf, len);
+                        len = 0;
+                    }
+                    len += snprintf(buf + len, sizeof(buf) - len, "S,%u,%u,%08lx\n", core, task, pc);
+                }
+                if (len > 0) {
+                    server.sendContent(buf, len);
+                }
+                server.sendContent("");  // End of chunked response
+            });
             server.on("/api/state", []() {
-                StaticJsonDocument<1024> doc;
+                PROFILE_ZONE("http.state");
+                DynamicJsonDocument doc(STATE_JSON_SIZE);
                 buildStateJson(doc);
                 String json;
                 serializeJson(doc, json);
@@ -428,6 +773,7 @@ void initWebServer() {
                 }
             });
             server.on("/api/autopilot", HTTP_POST, []() {
+                PROFILE_ZONE("http.autopilot");
                 if (!server.hasArg("plain")) {
                     server.send(400, "application/json", "{\"error\":\"JSON body required\"}");
                     return;
@@ -474,13 +820,14 @@ void initWebServer() {
                     state.autopilot.hasSelectedAltitude = true;
                 }
                 // Return updated state
-                StaticJsonDocument<512> stateDoc;
+                DynamicJsonDocument stateDoc(STATE_JSON_SIZE);
                 buildStateJson(stateDoc);
                 String json;
                 serializeJson(stateDoc, json);
                 server.send(200, "application/json", json);
             });
             server.on("/api/pid", HTTP_POST, []() {
+                PROFILE_ZONE("http.pid");
                 if (!server.hasArg("plain")) {
                     server.send(400, "application/json", "{\"error\":\"JSON body required\"}");
                     return;
@@ -536,12 +883,105 @@ void initWebServer() {
                 }
 
                 // Return updated state
-                StaticJsonDocument<512> stateDoc;
+                DynamicJsonDocument stateDoc(STATE_JSON_SIZE);
                 buildStateJson(stateDoc);
                 String json;
                 serializeJson(stateDoc, json);
                 server.send(200, "application/json", json);
             });
+            server.on("/api/filter", HTTP_POST, []() {
+                if (!server.hasArg("plain")) {
+                    server.send(400, "application/json", "{\"error\":\"JSON body required\"}");
+                    return;
+                }
+                String body = server.arg("plain");
+                StaticJsonDocument<384> doc;
+                DeserializationError err = deserializeJson(doc, body);
+                if (err) {
+                    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+                    return;
+                }
+                // Settings are picked up by the filters on the next sample
+                if (doc.containsKey("cyclic")) {
+                    readFilterJson(doc["cyclic"], state.sensors.cyclicFilter);
+                }
+                if (doc.containsKey("collective")) {
+                    readFilterJson(doc["collective"], state.sensors.collectiveFilter);
+                }
+                const AxisFilterSettings& c = state.sensors.cyclicFilter;
+                LOG_INFOF("Cyclic filter: %s min %.2f Hz beta %.4f d %.2f Hz",
+                          c.enabled ? "on" : "off", c.minCutoffHz, c.beta, c.dCutoffHz);
+                const AxisFilterSettings& z = state.sensors.collectiveFilter;
+                LOG_INFOF("Collective filter: %s min %.2f Hz beta %.4f d %.2f Hz",
+                          z.enabled ? "on" : "off", z.minCutoffHz, z.beta, z.dCutoffHz);
+
+                DynamicJsonDocument stateDoc(STATE_JSON_SIZE);
+                buildStateJson(stateDoc);
+                String json;
+                serializeJson(stateDoc, json);
+                server.send(200, "application/json", json);
+            });
+            server.on("/api/curves", HTTP_GET, []() {
+                sendCurvesJson();
+            });
+            server.on("/api/curves", HTTP_POST, []() {
+                if (!server.hasArg("plain")) {
+                    server.send(400, "application/json", "{\"error\":\"JSON body required\"}");
+                    return;
+                }
+                String body = server.arg("plain");
+                StaticJsonDocument<768> doc;
+                DeserializationError err = deserializeJson(doc, body);
+                if (err) {
+                    server.send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+                    return;
+                }
+
+                const char* axis = doc["axis"];
+                ResponseCurveSettings* curve = curveByName(axis);
+                if (curve == nullptr) {
+                    server.send(400, "application/json", "{\"error\":\"Unknown axis\"}");
+                    return;
+                }
+
+                // Validate into a copy so a bad request leaves the curve alone
+                ResponseCurveSettings updated = *curve;
+                if (doc.containsKey("type") && !parseResponseCurveType(doc["type"], &updated.type)) {
+                    server.send(400, "application/json", "{\"error\":\"Unknown curve type\"}");
+                    return;
+                }
+                if (doc.containsKey("amount")) {
+                    updated.amount = constrain(doc["amount"].as<float>(), 0.0f, 1.0f);
+                }
+                if (doc.containsKey("points")) {
+                    JsonArray points = doc["points"];
+                    if (points.size() > RESPONSE_CURVE_MAX_POINTS) {
+                        server.send(400, "application/json", "{\"error\":\"Too many points\"}");
+                        return;
+                    }
+                    updated.pointCount = 0;
+                    for (JsonArray p : points) {
+                        updated.points[updated.pointCount].in = p[0].as<int16_t>();
+                        updated.points[updated.pointCount].out = p[1].as<int16_t>();
+                        updated.pointCount++;
+                    }
+                }
+                if (updated.type == CURVE_POINTS && !responseCurvePointsValid(updated.points, updated.pointCount)) {
+                    server.send(400, "application/json",
+                                "{\"error\":\"Points need 2+ entries in 0-10000 with increasing inputs\"}");
+                    return;
+                }
+
+                // The control task rebuilds the curve when the revision moves,
+                // so bump it after everything else is in place
+                updated.revision = curve->revision;
+                *curve = updated;
+                curve->revision++;
+                LOG_INFOF("Response curve %s: %s, amount %.2f, %u points", axis,
+                          responseCurveTypeName(curve->type), curve->amount, curve->pointCount);
+
+                sendCurvesJson();
+            });
             server.on("/api/cyclic_feedback", HTTP_POST, []() {
                 if (!server.hasArg("plain")) {
                     server.send(400, "application/json", "{\"error\":\"JSON body required\"}");
@@ -602,6 +1042,7 @@ void initWebServer() {
                 server.send(200, "application/json", state.telemetryEnabled ? "{\"enabled\":true}" : "{\"enabled\":false}");
             });
             server.on("/logs", []() {
+                PROFILE_ZONE("http.logs");
                 String logsJSON = logger.getEntriesJSON();
                 server.send(200, "application/json", logsJSON);
             });
@@ -0,0 +1,103 @@
+#include "xplane_rref.h"
+#include <string.h>
+
+const char* const xplaneDatarefPaths[XPLANE_REF_COUNT] = {
+    "sim/flightmodel/position/indicated_airspeed",
+    "sim/flightmodel/misc/h_ind",
+    "sim/flightmodel/position/theta",
+    "sim/flightmodel/position/phi",
+    "sim/flightmodel/position/mag_psi",
+    "sim/flightmodel/position/vh_ind_fpm",
+    "sim/flightmodel/position/Q",
+    "sim/flightmodel/position/P",
+    "sim/flightmodel/position/R",
+    "sim/time/total_running_time_sec"
+};
+
+static void putLe32(uint8_t* b, uint32_t v) {
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+    b[2] = (uint8_t)(v >> 16);
+    b[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getLe32(const uint8_t* b) {
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) |
+           ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+size_t buildXPlaneRrefRequest(XPlaneDataref ref, uint32_t freqHz, uint8_t* out) {
+    memset(out, 0, XPLANE_RREF_REQUEST_SIZE);
+    memcpy(out, "RREF", 4);
+    putLe32(&out[5], freqHz);
+    putLe32(&out[9], (uint32_t)ref);
+    strncpy((char*)&out[13], xplaneDatarefPaths[ref], XPLANE_RREF_PATH_SIZE - 1);
+    return XPLANE_RREF_REQUEST_SIZE;
+}
+
+bool decodeXPlaneRref(const uint8_t* data, size_t len, SimMessage* msg) {
+    if (len < XPLANE_RREF_HEADER_SIZE || memcmp(data, "RREF", 4) != 0) {
+        return false;
+    }
+
+    msg->fields = 0;
+    msg->binary = true;
+    msg->hasSeq = false;
+    msg->hasTime = false;
+    msg->hasAck = false;
+
+    for (size_t i = XPLANE_RREF_HEADER_SIZE; i + XPLANE_RREF_PAIR_SIZE <= len; i += XPLANE_RREF_PAIR_SIZE) {
+        uint32_t index = getLe32(&data[i]);
+        uint32_t bits = getLe32(&data[i + 4]);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+
+        switch (index) {
+            case XPLANE_REF_SPEED:
+                msg->speed = value;
+                msg->fields |= SIM_FIELD_SPEED;
+                break;
+            case XPLANE_REF_ALTITUDE:
+                msg->altitude = value;
+                msg->fields |= SIM_FIELD_ALTITUDE;
+                break;
+            case XPLANE_REF_PITCH:
+                msg->pitch = value;
+                msg->fields |= SIM_FIELD_PITCH;
+                break;
+            case XPLANE_REF_ROLL:
+                msg->roll = value;
+                msg->fields |= SIM_FIELD_ROLL;
+                break;
+            case XPLANE_REF_HEADING:
+                msg->heading = value;
+                msg->fields |= SIM_FIELD_HEADING;
+                break;
+            case XPLANE_REF_VS:
+                msg->verticalSpeed = value;
+                msg->fields |= SIM_FIELD_VS;
+                break;
+            case XPLANE_REF_PITCH_RATE:
+                msg->pitchRate = value;
+                msg->fields |= SIM_FIELD_PITCH_RATE;
+                break;
+            case XPLANE_REF_ROLL_RATE:
+                msg->rollRate = value;
+                msg->fields |= SIM_FIELD_ROLL_RATE;
+                break;
+            case XPLANE_REF_YAW_RATE:
+                msg->yawRate = value;
+                msg->fields |= SIM_FIELD_YAW_RATE;
+                break;
+            case XPLANE_REF_TIME:
+                if (value >= 0.0f) {
+                    msg->simTimeMs = (uint32_t)(value * 1000.0f);
+                    msg->hasTime = true;
+                }
+                break;
+            default:
+                break;  // Someone else's subscription on this port
+        }
+    }
+    return true;
+}
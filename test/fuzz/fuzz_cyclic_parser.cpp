@@ -0,0 +1,112 @@
+// libFuzzer target for CyclicParser (pio run -e fuzz_cyclic, see platformio.ini).
+// Without PlatformIO (one command):
+//   clang++ -std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -Iinclude
+//       src/cyclic_parser.cpp test/fuzz/fuzz_cyclic_parser.cpp -o fuzz_cyclic
+//
+// Input: byte 0 sets the write chunk size, byte 1 the first sequence number
+// of the trailer, the rest is an arbitrary byte stream. The stream goes in
+// through writeSpan()/commit() in chunks, frames are drained after every
+// chunk, then a run of valid v2 frames follows. Checked:
+// - no out-of-bounds access (ASan / UBSan)
+// - after draining, less than one frame stays buffered (never stuck)
+// - every decoded frame has a version and, for v1, a valid layout
+// - sync comes back: whatever the garbage, the tail of the valid run decodes.
+//   A fake frame may swallow the start of the run, and a fake sequence number
+//   may make up to CYCLIC_PARSER_SEQ_RESYNC - 1 frames look stale.
+
+#include "cyclic_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TRAILER_FRAMES 12
+#define TRAILER_CHECKED 4  // Last frames of the run that must decode
+
+static_assert(TRAILER_FRAMES - TRAILER_CHECKED >= CYCLIC_PARSER_SEQ_RESYNC + 1,
+              "Trailer too short for a sequence resync");
+
+static void check(bool ok) {
+    if (!ok) {
+        abort();
+    }
+}
+
+static void makeV2(uint8_t seq, uint16_t s1, uint16_t s2, uint32_t us, uint8_t* f) {
+    f[0] = PACKET_V2_START_MARKER;
+    f[1] = PACKET_V2_VERSION;
+    f[2] = seq;
+    f[3] = (uint8_t)s1;
+    f[4] = (uint8_t)(s1 >> 8);
+    f[5] = (uint8_t)s2;
+    f[6] = (uint8_t)(s2 >> 8);
+    f[7] = (uint8_t)us;
+    f[8] = (uint8_t)(us >> 8);
+    f[9] = (uint8_t)(us >> 16);
+    f[10] = (uint8_t)(us >> 24);
+    uint16_t crc = cyclicCrc16(&f[1], 10);
+    f[11] = (uint8_t)crc;
+    f[12] = (uint8_t)(crc >> 8);
+}
+
+// Trailer frames carry sensor1 = 0x1000 + index, sensor2 = 0x0FFF - index
+static bool isTrailer(const CyclicSample& s, int* index) {
+    if (s.version != 2 || s.sensor1 < 0x1000 || s.sensor1 >= 0x1000 + TRAILER_FRAMES) {
+        return false;
+    }
+    *index = s.sensor1 - 0x1000;
+    return s.sensor2 == 0x0FFF - *index;
+}
+
+static void feed(CyclicParser& parser, const uint8_t* data, size_t len, size_t chunk,
+                 bool* seen) {
+    size_t pos = 0;
+    while (pos < len) {
+        size_t space;
+        uint8_t* dst = parser.writeSpan(&space);
+        check(space > 0);  // Drained below, so there is always room
+        size_t n = len - pos;
+        if (n > chunk) n = chunk;
+        if (n > space) n = space;
+        memcpy(dst, data + pos, n);
+        parser.commit(n);
+        pos += n;
+
+        CyclicSample sample;
+        while (parser.next(&sample)) {
+            check(sample.version == 1 || sample.version == 2);
+            if (sample.version == 1) {
+                check(sample.seq == 0 && sample.sensorUs == 0);
+            }
+            int index;
+            if (seen != nullptr && isTrailer(sample, &index)) {
+                seen[index] = true;
+            }
+        }
+        check(parser.available() < PACKET_V2_SIZE);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 2) {
+        return 0;
+    }
+    size_t chunk = 1 + data[0] % 64;
+    uint8_t seq = data[1];
+
+    CyclicParser parser;
+    feed(parser, data + 2, size - 2, chunk, nullptr);
+
+    uint8_t trailer[TRAILER_FRAMES * PACKET_V2_SIZE];
+    for (int i = 0; i < TRAILER_FRAMES; i++) {
+        makeV2((uint8_t)(seq + i), (uint16_t)(0x1000 + i), (uint16_t)(0x0FFF - i),
+               1000u * (uint32_t)i, &trailer[i * PACKET_V2_SIZE]);
+    }
+    bool seen[TRAILER_FRAMES] = {};
+    feed(parser, trailer, sizeof(trailer), chunk, seen);
+    for (int i = TRAILER_FRAMES - TRAILER_CHECKED; i < TRAILER_FRAMES; i++) {
+        check(seen[i]);
+    }
+
+    const CyclicParserStats& stats = parser.getStats();
+    check(stats.framesV2 <= stats.frames);
+    return 0;
+}
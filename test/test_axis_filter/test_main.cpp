@@ -0,0 +1,202 @@
+// Axis filter on a cyclic sensor trace: noise reduction at rest vs lag added
+// in slow and fast moves (pio test -e native -f test_axis_filter -v prints
+// the table)
+//
+// No ground truth is needed, so a real capture can replace the trace:
+// - noise: RMS of the sample-to-sample change while the stick rests
+// - lag: the delay that best aligns the output with the raw input, over the
+//   samples where the stick moves
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "axis_filter.h"
+#include "config.h"
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "test/data/"
+#endif
+
+#define AXIS_RANGE 10000
+#define MAX_LAG_SAMPLES 150
+#define SPEED_WINDOW 10       // Samples each side for the speed of a move
+#define REST_WINDOW 50        // Samples each side to tell rest from noise
+#define REST_SPEED 100.0      // Axis units/s; slower counts as resting
+#define REST_SETTLE 250       // Samples at rest before noise is measured
+#define FAST_SPEED 10000.0    // Axis units/s; faster counts as a fast move
+
+struct Trace {
+    std::vector<int64_t> us;
+    std::vector<int16_t> x;   // Cyclic X in axis units
+    std::vector<int> motion;  // 0 rest, 1 slow, 2 fast, -1 in between
+};
+
+static Trace trace;
+
+// |speed| of the raw input around sample i (axis units/s), from
+// x[i+k] - x[i-k] ~ 2k * speed * dt summed over k = 1..window
+static double rawSpeed(size_t i, int window) {
+    double span = 0;
+    for (int k = 1; k <= window; k++) {
+        span += trace.x[i + k] - trace.x[i - k];
+    }
+    double dtS = (double)(trace.us[i + window] - trace.us[i - window]) / (2 * window) * 1e-6;
+    return fabs(span) / (window * (window + 1) * dtS);
+}
+
+static bool loadTrace(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        long long us;
+        int s1, s2;
+        if (sscanf(line, "%lld,%d,%d", &us, &s1, &s2) != 3) {
+            continue;  // Comment or header
+        }
+        // Linear calibration as on the device
+        long axis = (long)(s1 - CYCLIC_X_SENSOR_MIN) * AXIS_RANGE / (CYCLIC_X_SENSOR_MAX - CYCLIC_X_SENSOR_MIN);
+        trace.us.push_back(us);
+        trace.x.push_back((int16_t)(axis < 0 ? 0 : (axis > AXIS_RANGE ? AXIS_RANGE : axis)));
+    }
+    fclose(f);
+
+    // Classify each sample by the speed of the raw input around it: a wide
+    // window to find rest (noise averages out), a narrow one for moves
+    size_t n = trace.x.size();
+    trace.motion.assign(n, -1);
+    for (size_t i = REST_WINDOW; i + REST_WINDOW < n; i++) {
+        double speed = rawSpeed(i, SPEED_WINDOW);
+        if (rawSpeed(i, REST_WINDOW) < REST_SPEED) {
+            trace.motion[i] = 0;
+        } else if (speed > FAST_SPEED) {
+            trace.motion[i] = 2;
+        } else if (speed > REST_SPEED * 4) {
+            trace.motion[i] = 1;
+        }
+    }
+    return n > 0;
+}
+
+static std::vector<int16_t> runFilter(const AxisFilterSettings& settings) {
+    AxisFilter filter;
+    filter.configure(settings);
+    std::vector<int16_t> out(trace.x.size());
+    for (size_t i = 0; i < trace.x.size(); i++) {
+        out[i] = filter.update(trace.x[i], trace.us[i]);
+    }
+    return out;
+}
+
+// RMS sample-to-sample change while resting (axis units), once the
+// stick has rested for REST_SETTLE samples (the tail of a move is lag, not noise)
+static double restNoise(const std::vector<int16_t>& v) {
+    double sum = 0;
+    size_t count = 0;
+    size_t resting = 0;
+    for (size_t i = 1; i < v.size(); i++) {
+        resting = (trace.motion[i] == 0) ? resting + 1 : 0;
+        if (resting > REST_SETTLE) {
+            double d = v[i] - v[i - 1];
+            sum += d * d;
+            count++;
+        }
+    }
+    return count > 0 ? sqrt(sum / count) : 0;
+}
+
+// Delay (ms) that minimises the RMS between out[i] and raw[i - lag] over the
+// samples of one motion class
+static double lagMs(const std::vector<int16_t>& out, int motion) {
+    double best = -1;
+    int bestLag = 0;
+    for (int lag = 0; lag <= MAX_LAG_SAMPLES; lag++) {
+        double sum = 0;
+        for (size_t i = MAX_LAG_SAMPLES; i < out.size(); i++) {
+            if (trace.motion[i] == motion) {
+                double d = out[i] - trace.x[i - lag];
+                sum += d * d;
+            }
+        }
+        if (best < 0 || sum < best) {
+            best = sum;
+            bestLag = lag;
+        }
+    }
+    double meanDtMs = (double)(trace.us.back() - trace.us.front()) / (trace.us.size() - 1) / 1000.0;
+    return bestLag * meanDtMs;
+}
+
+struct Result {
+    double noise;
+    double slowLagMs;
+    double fastLagMs;
+};
+
+static Result evaluate(const char* label, const AxisFilterSettings& settings) {
+    std::vector<int16_t> out = runFilter(settings);
+    Result r = {restNoise(out), lagMs(out, 1), lagMs(out, 2)};
+    char line[160];
+    snprintf(line, sizeof(line), "%-28s rest noise %5.2f units  lag slow %5.1f ms  fast %5.1f ms",
+             label, r.noise, r.slowLagMs, r.fastLagMs);
+    TEST_MESSAGE(line);
+    return r;
+}
+
+static AxisFilterSettings makeSettings(float minCutoffHz, float beta, float dCutoffHz) {
+    AxisFilterSettings s;
+    s.enabled = true;
+    s.minCutoffHz = minCutoffHz;
+    s.beta = beta;
+    s.dCutoffHz = dCutoffHz;
+    return s;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_trace_has_rest_slow_and_fast_parts(void) {
+    size_t counts[3] = {};
+    for (int m : trace.motion) {
+        if (m >= 0) counts[m]++;
+    }
+    TEST_ASSERT_GREATER_THAN(500, counts[0]);
+    TEST_ASSERT_GREATER_THAN(500, counts[1]);
+    TEST_ASSERT_GREATER_THAN(200, counts[2]);
+}
+
+void test_latency_vs_noise(void) {
+    AxisFilterSettings off;
+    Result raw = evaluate("off", off);
+    Result def = evaluate("defaults (One Euro)",
+                          makeSettings(CYCLIC_FILTER_MIN_CUTOFF_HZ, CYCLIC_FILTER_BETA, CYCLIC_FILTER_D_CUTOFF_HZ));
+    Result fixedLow = evaluate("fixed low-pass, min cutoff",
+                               makeSettings(CYCLIC_FILTER_MIN_CUTOFF_HZ, 0.0f, CYCLIC_FILTER_D_CUTOFF_HZ));
+    evaluate("fixed low-pass, 10 Hz", makeSettings(10.0f, 0.0f, CYCLIC_FILTER_D_CUTOFF_HZ));
+    evaluate("One Euro, beta x4", makeSettings(CYCLIC_FILTER_MIN_CUTOFF_HZ, CYCLIC_FILTER_BETA * 4,
+                                                CYCLIC_FILTER_D_CUTOFF_HZ));
+
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0, raw.fastLagMs);
+    // The defaults: most of the resting noise gone...
+    TEST_ASSERT_LESS_THAN_FLOAT(raw.noise / 4, def.noise);
+    // ...about as smooth as a fixed filter at the resting cutoff, for a
+    // fraction of its lag
+    TEST_ASSERT_LESS_THAN_FLOAT(fixedLow.noise * 2, def.noise);
+    TEST_ASSERT_LESS_THAN_FLOAT(fixedLow.slowLagMs / 2, def.slowLagMs);
+    TEST_ASSERT_LESS_THAN_FLOAT(fixedLow.fastLagMs / 2, def.fastLagMs);
+    TEST_ASSERT_LESS_THAN_FLOAT(20.0, def.fastLagMs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    if (!loadTrace(TEST_DATA_DIR "cyclic_trace.csv")) {
+        TEST_MESSAGE("Trace " TEST_DATA_DIR "cyclic_trace.csv not found (run from the project directory)");
+        return UNITY_END() + 1;
+    }
+    RUN_TEST(test_trace_has_rest_slow_and_fast_parts);
+    RUN_TEST(test_latency_vs_noise);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// Axis lookup tables vs the per-sample code they replaced: every raw value
+// 0..4095 must map to the same axis value, bit for bit
+
+#include <unity.h>
+#include <stdio.h>
+#include "axis_pipeline.h"
+#include "config.h"
+
+// Cyclic mapping before the tables (cyclic_serial.cpp)
+static int16_t mapSensorToAxis(uint16_t sensorValue, uint16_t sensorMin, uint16_t sensorMax, bool invert) {
+    // Clamp sensor value to calibration range
+    if (sensorValue < sensorMin) {
+        sensorValue = sensorMin;
+    }
+    if (sensorValue > sensorMax) {
+        sensorValue = sensorMax;
+    }
+
+    // Map from sensor range to joystick axis range (0 to 10000)
+    // Using long to avoid overflow during calculation
+    long mapped = (long)(sensorValue - sensorMin) * (AXIS_MAX - AXIS_MIN) / (sensorMax - sensorMin) + AXIS_MIN;
+
+    // Apply inversion if needed
+    if (invert) {
+        mapped = AXIS_MAX - (mapped - AXIS_MIN);
+    }
+
+    return (int16_t)mapped;
+}
+
+// Collective mapping before the tables (collective.cpp), including its
+// wrap detection
+static int16_t collectiveBaseline(uint16_t sensorValue, uint16_t sensorMin, uint16_t sensorMax, bool invert,
+                                  bool* wraps) {
+    bool hasOverflow = (sensorMax < sensorMin) || ((sensorMax - sensorMin) < 200 && sensorMax < 2000);
+    *wraps = hasOverflow;
+
+    int32_t normalizedValue;
+    int32_t normalizedMin;
+    int32_t normalizedMax;
+
+    if (hasOverflow) {
+        if (sensorValue <= sensorMax) {
+            normalizedValue = sensorValue + 4096;
+        } else {
+            normalizedValue = sensorValue;
+        }
+        normalizedMin = (int32_t)sensorMin;
+        normalizedMax = (int32_t)sensorMax + 4096;
+    } else {
+        normalizedValue = (int32_t)sensorValue;
+        normalizedMin = (int32_t)sensorMin;
+        normalizedMax = (int32_t)sensorMax;
+    }
+
+    if (normalizedValue < normalizedMin) {
+        normalizedValue = normalizedMin;
+    }
+    if (normalizedValue > normalizedMax) {
+        normalizedValue = normalizedMax;
+    }
+
+    int32_t inputOffset = normalizedValue - normalizedMin;
+    int32_t inputRange = normalizedMax - normalizedMin;
+    int32_t outputRange = AXIS_MAX - AXIS_MIN;
+    long mapped = ((long)inputOffset * (long)outputRange) / (long)inputRange + AXIS_MIN;
+
+    int16_t value = (int16_t)mapped;
+    if (invert) {
+        value = AXIS_MAX - (value - AXIS_MIN);
+    }
+    return value;
+}
+
+template <typename Pipeline>
+static void sweepCyclic(const char* label) {
+    const AxisCalibration& cal = Pipeline::calibration;
+    for (uint32_t raw = 0; raw < AXIS_PIPELINE_SENSOR_RANGE; raw++) {
+        int16_t expected = mapSensorToAxis((uint16_t)raw, cal.sensorMin, cal.sensorMax, cal.invert);
+        int16_t actual = Pipeline::map((uint16_t)raw);
+        if (expected != actual) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "%s: raw %u maps to %d, baseline %d", label, (unsigned)raw, actual, expected);
+            TEST_FAIL_MESSAGE(msg);
+        }
+    }
+}
+
+template <typename Pipeline>
+static void sweepCollective(const char* label) {
+    const AxisCalibration& cal = Pipeline::calibration;
+    for (uint32_t raw = 0; raw < AXIS_PIPELINE_SENSOR_RANGE; raw++) {
+        bool baselineWraps;
+        int16_t expected = collectiveBaseline((uint16_t)raw, cal.sensorMin, cal.sensorMax, cal.invert, &baselineWraps);
+        // The baseline guessed the wrap from the range; the WRAPS flag now says it
+        TEST_ASSERT_TRUE_MESSAGE(baselineWraps == cal.wraps, label);
+        int16_t actual = Pipeline::map((uint16_t)raw);
+        if (expected != actual) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "%s: raw %u maps to %d, baseline %d", label, (unsigned)raw, actual, expected);
+            TEST_FAIL_MESSAGE(msg);
+        }
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_cyclic_axes_match_baseline(void) {
+    sweepCyclic<AxisPipeline<CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX, CYCLIC_X_INVERT>>("cyclic X");
+    sweepCyclic<AxisPipeline<CYCLIC_Y_SENSOR_MIN, CYCLIC_Y_SENSOR_MAX, CYCLIC_Y_INVERT>>("cyclic Y");
+}
+
+void test_other_cyclic_calibrations_match_baseline(void) {
+    sweepCyclic<AxisPipeline<0, 4095, false>>("full range");
+    sweepCyclic<AxisPipeline<0, 4095, true>>("full range inverted");
+    sweepCyclic<AxisPipeline<1000, 1001, false>>("two counts");
+    sweepCyclic<AxisPipeline<500, 3500, true>>("500-3500 inverted");
+    sweepCyclic<AxisPipeline<1234, 2777, false>>("uneven range");
+}
+
+void test_collective_matches_baseline(void) {
+    sweepCollective<AxisPipeline<COLLECTIVE_SENSOR_MIN, COLLECTIVE_SENSOR_MAX, COLLECTIVE_INVERT,
+                                 COLLECTIVE_SENSOR_WRAPS>>("collective");
+}
+
+void test_other_collective_calibrations_match_baseline(void) {
+    sweepCollective<AxisPipeline<3900, 150, false, true>>("wrap, max < min");
+    sweepCollective<AxisPipeline<3900, 150, true, true>>("wrap, max < min, inverted");
+    sweepCollective<AxisPipeline<1370, 1500, false, true>>("wrap, short range");
+    sweepCollective<AxisPipeline<4095, 0, true, true>>("wrap at the boundary");
+    sweepCollective<AxisPipeline<200, 3800, true, false>>("no wrap");
+    sweepCollective<AxisPipeline<2100, 2250, false, false>>("short range above 2000");
+}
+
+void test_out_of_range_raw_reads_as_4095(void) {
+    using Pipeline = AxisPipeline<CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX, CYCLIC_X_INVERT>;
+    TEST_ASSERT_EQUAL_INT(Pipeline::map(4095), Pipeline::map(4096));
+    TEST_ASSERT_EQUAL_INT(Pipeline::map(4095), Pipeline::map(65535));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cyclic_axes_match_baseline);
+    RUN_TEST(test_other_cyclic_calibrations_match_baseline);
+    RUN_TEST(test_collective_matches_baseline);
+    RUN_TEST(test_other_collective_calibrations_match_baseline);
+    RUN_TEST(test_out_of_range_raw_reads_as_4095);
+    return UNITY_END();
+}
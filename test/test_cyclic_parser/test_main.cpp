@@ -0,0 +1,193 @@
+// Host tests and throughput benchmark for the cyclic packet parser
+// (pio test -e native -f test_cyclic_parser -v prints the benchmark lines)
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "cyclic_parser.h"
+
+static void appendV1(std::vector<uint8_t>& out, uint16_t s1, uint16_t s2) {
+    uint8_t f[PACKET_SIZE] = {PACKET_START_MARKER, (uint8_t)s1, (uint8_t)(s1 >> 8),
+                              (uint8_t)s2, (uint8_t)(s2 >> 8), 0, PACKET_END_MARKER};
+    f[5] = f[1] ^ f[2] ^ f[3] ^ f[4];
+    out.insert(out.end(), f, f + PACKET_SIZE);
+}
+
+static void appendV2(std::vector<uint8_t>& out, uint8_t seq, uint16_t s1, uint16_t s2, uint32_t us) {
+    uint8_t f[PACKET_V2_SIZE] = {PACKET_V2_START_MARKER, PACKET_V2_VERSION, seq,
+                                 (uint8_t)s1, (uint8_t)(s1 >> 8), (uint8_t)s2, (uint8_t)(s2 >> 8),
+                                 (uint8_t)us, (uint8_t)(us >> 8), (uint8_t)(us >> 16), (uint8_t)(us >> 24)};
+    uint16_t crc = cyclicCrc16(&f[1], 10);
+    f[11] = (uint8_t)crc;
+    f[12] = (uint8_t)(crc >> 8);
+    out.insert(out.end(), f, f + PACKET_V2_SIZE);
+}
+
+// Feed through writeSpan()/commit() in chunks (as the UART path does) and
+// collect every decoded frame
+static std::vector<CyclicSample> parseAll(CyclicParser& parser, const std::vector<uint8_t>& bytes,
+                                          size_t chunk) {
+    std::vector<CyclicSample> samples;
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        size_t space;
+        uint8_t* dst = parser.writeSpan(&space);
+        size_t n = bytes.size() - pos;
+        if (n > chunk) n = chunk;
+        if (n > space) n = space;
+        memcpy(dst, &bytes[pos], n);
+        parser.commit(n);
+        pos += n;
+
+        CyclicSample sample;
+        while (parser.next(&sample)) {
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+// Deterministic stream of v2 frames with the sensors sweeping the 12-bit range
+static std::vector<uint8_t> makeStream(size_t frames) {
+    std::vector<uint8_t> out;
+    out.reserve(frames * PACKET_V2_SIZE);
+    for (size_t i = 0; i < frames; i++) {
+        appendV2(out, (uint8_t)i, (uint16_t)((i * 7) & 0x0FFF), (uint16_t)((i * 13) & 0x0FFF),
+                 (uint32_t)(i * 1000));
+    }
+    return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_crc16_check_value(void) {
+    // CRC-16/CCITT-FALSE check value
+    const uint8_t text[] = "123456789";
+    TEST_ASSERT_EQUAL_UINT16(0x29B1, cyclicCrc16(text, 9));
+}
+
+void test_decodes_v1_and_v2(void) {
+    std::vector<uint8_t> bytes;
+    appendV1(bytes, 1234, 4000);
+    appendV2(bytes, 7, 2048, 17, 123456789u);
+
+    CyclicParser parser;
+    std::vector<CyclicSample> samples = parseAll(parser, bytes, bytes.size());
+    TEST_ASSERT_EQUAL(2, samples.size());
+    TEST_ASSERT_EQUAL_UINT8(1, samples[0].version);
+    TEST_ASSERT_EQUAL_UINT16(1234, samples[0].sensor1);
+    TEST_ASSERT_EQUAL_UINT16(4000, samples[0].sensor2);
+    TEST_ASSERT_EQUAL_UINT8(2, samples[1].version);
+    TEST_ASSERT_EQUAL_UINT8(7, samples[1].seq);
+    TEST_ASSERT_EQUAL_UINT16(2048, samples[1].sensor1);
+    TEST_ASSERT_EQUAL_UINT16(17, samples[1].sensor2);
+    TEST_ASSERT_EQUAL_UINT32(123456789u, samples[1].sensorUs);
+    TEST_ASSERT_EQUAL_UINT32(2, parser.getStats().frames);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getStats().framesV2);
+}
+
+void test_chunking_does_not_change_output(void) {
+    std::vector<uint8_t> bytes = makeStream(500);
+    CyclicParser whole;
+    std::vector<CyclicSample> expected = parseAll(whole, bytes, CYCLIC_PARSER_RING_SIZE);
+    TEST_ASSERT_EQUAL(500, expected.size());
+
+    for (size_t chunk = 1; chunk <= 40; chunk++) {
+        CyclicParser parser;
+        std::vector<CyclicSample> samples = parseAll(parser, bytes, chunk);
+        TEST_ASSERT_EQUAL(expected.size(), samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT16(expected[i].sensor1, samples[i].sensor1);
+            TEST_ASSERT_EQUAL_UINT16(expected[i].sensor2, samples[i].sensor2);
+            TEST_ASSERT_EQUAL_UINT8(expected[i].seq, samples[i].seq);
+        }
+    }
+}
+
+void test_resyncs_after_garbage_and_corruption(void) {
+    std::vector<uint8_t> bytes;
+    appendV2(bytes, 0, 100, 200, 0);
+    const uint8_t garbage[] = {PACKET_V2_START_MARKER, PACKET_V2_VERSION, 0x11, PACKET_START_MARKER, 0x00};
+    bytes.insert(bytes.end(), garbage, garbage + sizeof(garbage));
+    appendV2(bytes, 1, 101, 201, 1000);
+    size_t corrupt = bytes.size() + 5;
+    appendV2(bytes, 2, 102, 202, 2000);
+    bytes[corrupt] ^= 0x40;  // CRC mismatch
+    appendV2(bytes, 3, 103, 203, 3000);
+
+    CyclicParser parser;
+    std::vector<CyclicSample> samples = parseAll(parser, bytes, 3);
+    TEST_ASSERT_EQUAL(3, samples.size());
+    TEST_ASSERT_EQUAL_UINT16(100, samples[0].sensor1);
+    TEST_ASSERT_EQUAL_UINT16(101, samples[1].sensor1);
+    TEST_ASSERT_EQUAL_UINT16(103, samples[2].sensor1);
+
+    const CyclicParserStats& stats = parser.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.lost);
+    TEST_ASSERT_GREATER_THAN(0, stats.badFrames);
+    TEST_ASSERT_GREATER_THAN(0, stats.skippedBytes);
+    TEST_ASSERT_LESS_THAN(PACKET_V2_SIZE, parser.available());
+}
+
+void test_drops_duplicate_and_older_frames(void) {
+    std::vector<uint8_t> bytes;
+    appendV2(bytes, 10, 1, 1, 0);
+    appendV2(bytes, 10, 2, 2, 0);  // Duplicate
+    appendV2(bytes, 9, 3, 3, 0);   // Older
+    appendV2(bytes, 11, 4, 4, 0);
+
+    CyclicParser parser;
+    std::vector<CyclicSample> samples = parseAll(parser, bytes, bytes.size());
+    TEST_ASSERT_EQUAL(2, samples.size());
+    TEST_ASSERT_EQUAL_UINT16(1, samples[0].sensor1);
+    TEST_ASSERT_EQUAL_UINT16(4, samples[1].sensor1);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getStats().duplicates);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getStats().reordered);
+}
+
+// Throughput through the same writeSpan()/commit()/next() path the UART task
+// uses, in 64-byte reads (a typical UART FIFO burst)
+static void benchmark(const char* label, const std::vector<uint8_t>& bytes, size_t frames) {
+    const int rounds = 20;
+    size_t decoded = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        CyclicParser parser;
+        decoded += parseAll(parser, bytes, 64).size();
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    char line[160];
+    snprintf(line, sizeof(line), "%s: %.1f M packets/s, %.2f ns/byte (%zu of %zu frames decoded)",
+             label, decoded / s / 1e6, s * 1e9 / ((double)bytes.size() * rounds), decoded / rounds,
+             frames);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, decoded);
+}
+
+void test_benchmark_throughput(void) {
+    const size_t frames = 100000;
+    std::vector<uint8_t> clean = makeStream(frames);
+    benchmark("clean v2", clean, frames);
+
+    // One corrupted byte per 100 frames: exercises the bad-frame / resync path
+    std::vector<uint8_t> noisy = clean;
+    for (size_t i = 0; i < frames; i += 100) {
+        noisy[i * PACKET_V2_SIZE + 4] ^= 0x5A;
+    }
+    benchmark("1% corrupted", noisy, frames);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc16_check_value);
+    RUN_TEST(test_decodes_v1_and_v2);
+    RUN_TEST(test_chunking_does_not_change_output);
+    RUN_TEST(test_resyncs_after_garbage_and_corruption);
+    RUN_TEST(test_drops_duplicate_and_older_frames);
+    RUN_TEST(test_benchmark_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,117 @@
+// Oversampling: effective resolution gained by block averaging, on a slow
+// sweep through the cyclic X calibration (pio test -e native -f
+// test_decimator -v prints the table)
+//
+// The sweep's true position is known, so the RMS error of the axis value
+// against it is the effective resolution: one raw count is ~6 axis units
+// with the cyclic X calibration, quantization alone leaves 6 / sqrt(12).
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "axis_pipeline.h"
+#include "config.h"
+#include "decimator.h"
+
+#define SAMPLE_US 1000     // 1 kHz sensor frames
+#define SWEEP_SAMPLES 40000
+#define SWEEP_COUNTS 37.0  // Raw counts covered by the sweep (slow, not a whole number)
+
+using Pipeline = AxisPipeline<CYCLIC_X_SENSOR_MIN, CYCLIC_X_SENSOR_MAX, false>;
+
+// Deterministic Gaussian noise (xorshift + Box-Muller)
+static uint32_t rngState;
+
+static double uniform() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return (rngState + 0.5) / 4294967296.0;
+}
+
+static double gaussian() {
+    return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+static double truePosition(int64_t us) {
+    return CYCLIC_X_SENSOR_MIN + 300.0 + SWEEP_COUNTS * (double)us / ((double)SWEEP_SAMPLES * SAMPLE_US);
+}
+
+static double trueAxis(double raw) {
+    return (raw - CYCLIC_X_SENSOR_MIN) * (AXIS_MAX - AXIS_MIN) / (CYCLIC_X_SENSOR_MAX - CYCLIC_X_SENSOR_MIN) + AXIS_MIN;
+}
+
+// RMS error (axis units) of the decimated axis against the true position at
+// each block's time
+static double sweepError(uint8_t ratio, double noiseCounts) {
+    rngState = 12345;
+    Decimator decimator;
+    decimator.setRatio(ratio);
+    double sum = 0;
+    int count = 0;
+    for (int i = 0; i < SWEEP_SAMPLES; i++) {
+        int64_t us = (int64_t)i * SAMPLE_US;
+        long raw = lround(truePosition(us) + noiseCounts * gaussian());
+        if (decimator.add(Pipeline::map((uint16_t)raw), us)) {
+            double e = decimator.value() - trueAxis(truePosition(decimator.timeUs()));
+            sum += e * e;
+            count++;
+        }
+    }
+    return sqrt(sum / count);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_resolution_gain(void) {
+    const double noises[] = {0.0, 0.3, 0.6, 1.0};
+    const uint8_t ratios[] = {1, 2, 4, 8};
+    double err[4][4];
+
+    TEST_MESSAGE("RMS error, axis units (bits gained vs ratio 1); ratio N adds (N-1)/2 ms of delay at 1 kHz");
+    for (int n = 0; n < 4; n++) {
+        char line[160];
+        int len = snprintf(line, sizeof(line), "noise %.1f counts:", noises[n]);
+        for (int r = 0; r < 4; r++) {
+            err[n][r] = sweepError(ratios[r], noises[n]);
+            len += snprintf(line + len, sizeof(line) - len, "  x%u %5.2f (%+.1f)", ratios[r], err[n][r],
+                            log2(err[n][0] / err[n][r]));
+        }
+        TEST_MESSAGE(line);
+    }
+
+    // No noise, no dither: averaging identical samples gains nothing
+    TEST_ASSERT_FLOAT_WITHIN(0.2, err[0][0], err[0][2]);
+    // Some noise dithers the samples: the block average resolves finer than
+    // the quantization step itself
+    TEST_ASSERT_LESS_THAN_FLOAT(err[0][0], err[1][2]);
+    // With a count of noise or so, ratio 4 about halves the error
+    TEST_ASSERT_LESS_THAN_FLOAT(err[2][0] / 1.7, err[2][2]);
+    TEST_ASSERT_LESS_THAN_FLOAT(err[3][0] / 1.7, err[3][2]);
+    // More samples, more gain
+    TEST_ASSERT_LESS_THAN_FLOAT(err[3][2], err[3][3]);
+}
+
+void test_block_average_and_time(void) {
+    Decimator decimator;
+    decimator.setRatio(4);
+    TEST_ASSERT_FALSE(decimator.add(10, 1000));
+    TEST_ASSERT_FALSE(decimator.add(11, 2000));
+    TEST_ASSERT_FALSE(decimator.add(11, 3000));
+    TEST_ASSERT_TRUE(decimator.add(11, 4000));
+    TEST_ASSERT_EQUAL_INT(11, decimator.value());  // 43 / 4 rounded
+    TEST_ASSERT_EQUAL_INT(2500, decimator.timeUs());
+
+    decimator.setRatio(1);
+    TEST_ASSERT_TRUE(decimator.add(-7, 5000));
+    TEST_ASSERT_EQUAL_INT(-7, decimator.value());
+    TEST_ASSERT_EQUAL_INT(5000, decimator.timeUs());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_average_and_time);
+    RUN_TEST(test_resolution_gain);
+    return UNITY_END();
+}
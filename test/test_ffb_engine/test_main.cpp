@@ -0,0 +1,297 @@
+// Effect engine + step drive replaying a PID report stream
+// (test/data/ffb_reports.txt): reports go in at their time stamps, the
+// engine ticks every millisecond and each step moves a simulated stick.
+// From HAND_FROM_MS a hand holds the stick instead and flicks it, so the
+// motion-dependent conditions (damper, friction, inertia) see real speed.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "config.h"
+#include "ffb_engine.h"
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "test/data/"
+#endif
+
+#define UNITS_PER_STEP  20     // Simulated stick travel per motor step (position units)
+#define REPLAY_MS       8100
+#define HAND_FROM_MS    6000   // The hand holds the stick from here on
+#define FLICK_SPEED     250    // Position units per ms (full travel in ~80 ms)
+#define FLICK_TRAVEL    9000
+#define FLICK_HOLD_MS   200    // Out, hold, back
+
+// Flick start per condition segment (see the report stream)
+#define DAMPER_FLICK_MS    6100
+#define FRICTION_FLICK_MS  6800
+#define INERTIA_FLICK_MS   7500
+
+struct Report {
+    uint32_t timeMs;
+    char kind[4];  // out / set / get
+    uint8_t id;
+    std::vector<uint8_t> payload;
+};
+
+struct Tick {
+    int16_t force[FFB_AXES];
+    int16_t position[FFB_AXES];
+    int8_t step[FFB_AXES];
+};
+
+static std::vector<Report> reports;
+static std::vector<Tick> ticks;  // One per millisecond of the replay
+static int16_t handBase[FFB_AXES];  // Where the hand took the stick
+static uint32_t rejected;
+static uint32_t replyMismatches;
+
+static bool loadReports(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        char* comment = strchr(line, '#');
+        if (comment != nullptr) {
+            *comment = '\0';
+        }
+        Report r;
+        unsigned id;
+        int used;
+        if (sscanf(line, "%u %3s %x%n", &r.timeMs, r.kind, &id, &used) != 3) {
+            continue;
+        }
+        r.id = (uint8_t)id;
+        char* p = line + used;
+        char* end;
+        for (unsigned long b = strtoul(p, &end, 16); end != p; b = strtoul(p, &end, 16)) {
+            r.payload.push_back((uint8_t)b);
+            p = end;
+        }
+        reports.push_back(r);
+    }
+    fclose(f);
+    return !reports.empty();
+}
+
+// Hand offset from handBase on X at ms: out at FLICK_SPEED, hold, back
+static int32_t flickOffset(uint32_t ms) {
+    const uint32_t starts[] = {DAMPER_FLICK_MS, FRICTION_FLICK_MS, INERTIA_FLICK_MS};
+    const uint32_t rampMs = FLICK_TRAVEL / FLICK_SPEED;
+    for (uint32_t start : starts) {
+        if (ms < start || ms >= start + 2 * rampMs + FLICK_HOLD_MS) {
+            continue;
+        }
+        uint32_t t = ms - start;
+        if (t < rampMs) {
+            return (int32_t)t * FLICK_SPEED;
+        }
+        if (t < rampMs + FLICK_HOLD_MS) {
+            return FLICK_TRAVEL;
+        }
+        return FLICK_TRAVEL - (int32_t)(t - rampMs - FLICK_HOLD_MS) * FLICK_SPEED;
+    }
+    return 0;
+}
+
+static void replay() {
+    FfbEngine engine;
+    FfbStepDrive drives[FFB_AXES] = {
+        FfbStepDrive(FFB_MAX_STEP_RATE, FFB_RELEASE_FORCE, FFB_TRAVEL_LIMIT),
+        FfbStepDrive(FFB_MAX_STEP_RATE, FFB_RELEASE_FORCE, FFB_TRAVEL_LIMIT)
+    };
+    int16_t position[FFB_AXES] = {0, 0};
+    size_t next = 0;
+
+    for (uint32_t ms = 0; ms < REPLAY_MS; ms++) {
+        for (; next < reports.size() && reports[next].timeMs <= ms; next++) {
+            Report& r = reports[next];
+            if (strcmp(r.kind, "out") == 0) {
+                rejected += !engine.handleOutput(r.id, r.payload.data(), (uint16_t)r.payload.size());
+            } else if (strcmp(r.kind, "set") == 0) {
+                rejected += !engine.handleSetFeature(r.id, r.payload.data(), (uint16_t)r.payload.size());
+            } else {
+                uint8_t reply[64];
+                uint16_t len = engine.handleGetFeature(r.id, reply, sizeof(reply));
+                replyMismatches += len != r.payload.size() || memcmp(reply, r.payload.data(), len) != 0;
+            }
+        }
+
+        Tick t;
+        engine.tick(position, t.force);
+        for (uint8_t axis = 0; axis < FFB_AXES; axis++) {
+            t.step[axis] = drives[axis].update(t.force[axis], position[axis]);
+            position[axis] += t.step[axis] * UNITS_PER_STEP;
+            if (ms + 1 == HAND_FROM_MS) {
+                handBase[axis] = position[axis];
+            }
+            if (ms + 1 >= HAND_FROM_MS) {
+                // Held: the steps don't move it, the hand does
+                position[axis] = (int16_t)(handBase[axis] + (axis == 0 ? flickOffset(ms + 1) : 0));
+            }
+            t.position[axis] = position[axis];
+        }
+        ticks.push_back(t);
+    }
+}
+
+// Net and total steps on one axis over [fromMs, toMs)
+static void countSteps(uint8_t axis, uint32_t fromMs, uint32_t toMs, int* net, int* total) {
+    *net = 0;
+    *total = 0;
+    for (uint32_t ms = fromMs; ms < toMs; ms++) {
+        *net += ticks[ms].step[axis];
+        *total += ticks[ms].step[axis] != 0;
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_stream_accepted(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, replyMismatches);
+}
+
+void test_constant_force_steps(void) {
+    // 5000 from the right for 1000 ms: half the full step rate towards -X,
+    // until the stick reaches the travel limit
+    int net, total;
+    countSteps(0, 0, 1100, &net, &total);
+    TEST_ASSERT_EQUAL_INT(-FFB_TRAVEL_LIMIT / UNITS_PER_STEP, net);
+    TEST_ASSERT_EQUAL_INT(FFB_TRAVEL_LIMIT / UNITS_PER_STEP, total);
+    TEST_ASSERT_EQUAL_INT(-5000, ticks[11].force[0]);
+    TEST_ASSERT_EQUAL_INT(-5000, ticks[1000].force[0]);
+    TEST_ASSERT_EQUAL_INT(0, ticks[1000].step[0]);
+    countSteps(1, 0, 1100, &net, &total);
+    TEST_ASSERT_EQUAL_INT(0, total);
+    // Effect time: it ends after its duration
+    TEST_ASSERT_EQUAL_INT(0, ticks[1050].force[0]);
+}
+
+void test_spring_returns_to_centre(void) {
+    TEST_ASSERT_EQUAL_INT(-FFB_TRAVEL_LIMIT, ticks[1099].position[0]);
+    int net, total;
+    countSteps(0, 1100, 3100, &net, &total);
+    TEST_ASSERT_EQUAL_INT(net, total);  // Only ever towards the centre
+    // Stops where the force falls under the release force past the dead band
+    int16_t x = ticks[3099].position[0];
+    TEST_ASSERT_LESS_OR_EQUAL(0, x);
+    TEST_ASSERT_GREATER_THAN(-(200 + FFB_RELEASE_FORCE + UNITS_PER_STEP), x);
+    // Y sits in the dead band: no force at all
+    countSteps(1, 1100, 3100, &net, &total);
+    TEST_ASSERT_EQUAL_INT(0, total);
+}
+
+void test_sine_steps_back_and_forth(void) {
+    // 2 s of a 2 Hz sine: whole periods, so the stick ends where it started
+    int net, total;
+    countSteps(1, 3200, 5300, &net, &total);
+    TEST_ASSERT_LESS_OR_EQUAL(2, abs(net));
+    // Mean |force| of 8000 * 2/pi over 2 s is 1019 steps; the 250 ms attack
+    // and fade ramps take half their share (~127), the zero crossings below
+    // the release force a few more
+    TEST_ASSERT_GREATER_THAN(850, total);
+    TEST_ASSERT_LESS_THAN(900, total);
+    countSteps(0, 3200, 5300, &net, &total);
+    TEST_ASSERT_EQUAL_INT(0, total);
+}
+
+void test_no_steps_with_actuators_off(void) {
+    int net, total;
+    countSteps(0, 5300, HAND_FROM_MS, &net, &total);
+    TEST_ASSERT_EQUAL_INT(0, total);
+    countSteps(1, 5300, HAND_FROM_MS, &net, &total);
+    TEST_ASSERT_EQUAL_INT(0, total);
+}
+
+// Hand speed on X during tick ms (units per ms), from the positions the
+// engine saw
+static int32_t handSpeed(uint32_t ms) {
+    return ticks[ms].position[0] - ticks[ms - 1].position[0];
+}
+
+// Damper and friction: while the hand moves, the force is against the
+// motion and reaches full force; never along it
+static void assertOpposesMotion(uint32_t fromMs, uint32_t toMs) {
+    int32_t strongest = 0;
+    for (uint32_t ms = fromMs; ms < toMs; ms++) {
+        // The force of tick ms is computed from the position of tick ms - 1
+        int32_t v = handSpeed(ms - 1);
+        int32_t f = ticks[ms].force[0];
+        char msg[80];
+        snprintf(msg, sizeof(msg), "tick %u: speed %d units/ms, force %d", (unsigned)ms, (int)v, (int)f);
+        if (v > 0) {
+            TEST_ASSERT_TRUE_MESSAGE(f <= 0, msg);
+        } else if (v < 0) {
+            TEST_ASSERT_TRUE_MESSAGE(f >= 0, msg);
+        }
+        if (v != 0 && abs(f) > strongest) {
+            strongest = abs(f);
+        }
+        TEST_ASSERT_EQUAL_INT(0, ticks[ms].force[1]);  // Y is held still
+    }
+    TEST_ASSERT_EQUAL_INT(FFB_FORCE_MAX, strongest);
+}
+
+void test_damper_opposes_flick(void) {
+    assertOpposesMotion(DAMPER_FLICK_MS, FRICTION_FLICK_MS - 200);
+    // Held still before the flick: no force
+    TEST_ASSERT_EQUAL_INT(0, ticks[DAMPER_FLICK_MS - 1].force[0]);
+}
+
+void test_friction_opposes_flick(void) {
+    // 250 units/ms is far past the speed at which the product of speed and
+    // full force leaves int32
+    assertOpposesMotion(FRICTION_FLICK_MS, INERTIA_FLICK_MS - 200);
+}
+
+void test_inertia_opposes_acceleration(void) {
+    // The flick starts and stops abruptly: against the push-off at each
+    // start, against the stop at each end
+    const uint32_t rampMs = FLICK_TRAVEL / FLICK_SPEED;
+    const uint32_t out = INERTIA_FLICK_MS;
+    const uint32_t back = out + rampMs + FLICK_HOLD_MS;
+    for (uint32_t ms = 1; ms <= 5; ms++) {
+        TEST_ASSERT_LESS_THAN(0, ticks[out + ms].force[0]);            // Speeding up towards +X
+        TEST_ASSERT_GREATER_THAN(0, ticks[out + rampMs + ms].force[0]); // Stopping
+        TEST_ASSERT_GREATER_THAN(0, ticks[back + ms].force[0]);        // Speeding up towards -X
+        TEST_ASSERT_LESS_THAN(0, ticks[back + rampMs + ms].force[0]);  // Stopping
+    }
+    TEST_ASSERT_EQUAL_INT(-FFB_FORCE_MAX, ticks[out + 2].force[0]);
+}
+
+void test_step_drive_limits(void) {
+    FfbStepDrive drive(FFB_MAX_STEP_RATE, FFB_RELEASE_FORCE, FFB_TRAVEL_LIMIT);
+    int steps = 0;
+    for (int i = 0; i < 1000; i++) {
+        steps += drive.update(FFB_FORCE_MAX, 0);
+    }
+    TEST_ASSERT_EQUAL_INT(FFB_MAX_STEP_RATE, steps);  // Full force: full rate
+    TEST_ASSERT_EQUAL_INT(0, drive.update(FFB_RELEASE_FORCE - 1, 0));
+    TEST_ASSERT_EQUAL_INT(0, drive.update(FFB_FORCE_MAX, FFB_TRAVEL_LIMIT));
+    TEST_ASSERT_EQUAL_INT(-1, drive.update(-FFB_FORCE_MAX, FFB_TRAVEL_LIMIT));
+    TEST_ASSERT_EQUAL_INT(0, drive.update(-FFB_FORCE_MAX, -FFB_TRAVEL_LIMIT));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    if (!loadReports(TEST_DATA_DIR "ffb_reports.txt")) {
+        TEST_MESSAGE("Report stream " TEST_DATA_DIR "ffb_reports.txt not found (run from the project directory)");
+        return UNITY_END() + 1;
+    }
+    replay();
+    RUN_TEST(test_stream_accepted);
+    RUN_TEST(test_constant_force_steps);
+    RUN_TEST(test_spring_returns_to_centre);
+    RUN_TEST(test_sine_steps_back_and_forth);
+    RUN_TEST(test_no_steps_with_actuators_off);
+    RUN_TEST(test_damper_opposes_flick);
+    RUN_TEST(test_friction_opposes_flick);
+    RUN_TEST(test_inertia_opposes_acceleration);
+    RUN_TEST(test_step_drive_limits);
+    return UNITY_END();
+}
@@ -0,0 +1,241 @@
+// Simulator estimator on a recorded feed (test/data/sim_trace.csv): phase
+// lag and noise of the attitude rates, Savitzky-Golay differentiator vs the
+// alpha-beta trackers (pio test -e native -f test_sim_estimator -v prints
+// the table)
+//
+// The feed is replayed without its rate fields, so the estimator has to
+// derive them; the trace's own rates are the reference:
+// - lag: the delay that best aligns an estimate with the reference rate
+// - noise: RMS of what is left once aligned
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "config.h"
+#include "sim_estimator.h"
+
+#ifndef TEST_DATA_DIR
+#define TEST_DATA_DIR "test/data/"
+#endif
+
+#define WARMUP_MS     1000  // Estimates before this aren't scored
+#define MAX_LAG_MS    200
+#define AP_TICK_US    10000 // Autopilot rate for the extrapolation check (100 Hz)
+
+struct Sample {
+    int64_t arrivalUs;
+    uint32_t simTimeMs;
+    float attitude[SIM_RATE_COUNT];  // Pitch, roll, heading
+    float rate[SIM_RATE_COUNT];      // Reference rates
+};
+
+struct Estimates {
+    std::vector<float> sg[SIM_RATE_COUNT];          // Derived rate at each message (NAN = none)
+    std::vector<float> alphaBeta[SIM_RATE_COUNT];   // Tracker rate at each message
+};
+
+struct Fit {
+    int lagMs;
+    double rms;   // Aligned
+};
+
+static std::vector<Sample> trace;
+static Estimates est;
+
+static const SimChannel CHANNELS[SIM_RATE_COUNT] = {SIM_CH_PITCH, SIM_CH_ROLL, SIM_CH_HEADING};
+static const char* const AXIS_NAMES[SIM_RATE_COUNT] = {"pitch", "roll", "yaw"};
+
+static bool loadTrace(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+    char line[160];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        long long us;
+        unsigned ms;
+        Sample s;
+        if (sscanf(line, "%lld,%u,%f,%f,%f,%f,%f,%f", &us, &ms, &s.attitude[0], &s.attitude[1], &s.attitude[2],
+                   &s.rate[0], &s.rate[1], &s.rate[2]) != 8) {
+            continue;  // Comment or header
+        }
+        s.arrivalUs = us;
+        s.simTimeMs = ms;
+        trace.push_back(s);
+    }
+    fclose(f);
+    return trace.size() > 100;
+}
+
+static SimEstimatorSettings configSettings() {
+    SimEstimatorSettings s;
+    s.alpha = SIM_EST_ALPHA;
+    s.beta = SIM_EST_BETA;
+    s.maxPredictUs = SIM_EST_MAX_PREDICT_MS * 1000UL;
+    s.resetUs = SIM_EST_RESET_MS * 1000UL;
+    s.diffSamples = SIM_DIFF_SAMPLES;
+    s.diffOrder = SIM_DIFF_ORDER;
+    return s;
+}
+
+static SimMessage message(const Sample& s) {
+    SimMessage m;
+    m.fields = SIM_FIELD_PITCH | SIM_FIELD_ROLL | SIM_FIELD_HEADING;
+    m.hasTime = true;
+    m.simTimeMs = s.simTimeMs;
+    m.pitch = s.attitude[0];
+    m.roll = s.attitude[1];
+    m.heading = s.attitude[2];
+    return m;
+}
+
+static void replay() {
+    SimEstimator estimator;
+    estimator.configure(configSettings());
+    for (const Sample& s : trace) {
+        estimator.update(message(s), s.arrivalUs);
+        for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+            float rate;
+            bool derived = estimator.rate((SimRateAxis)axis, s.arrivalUs, &rate) == SIM_RATE_DERIVED;
+            est.sg[axis].push_back(derived ? rate : NAN);
+            est.alphaBeta[axis].push_back(estimator.getStats(CHANNELS[axis]).rate);
+        }
+    }
+}
+
+// Reference rate at a sim time, linear between the messages
+static double referenceAt(uint8_t axis, double ms) {
+    size_t i = (size_t)(ms / (trace[1].simTimeMs - trace[0].simTimeMs));
+    if (i + 1 >= trace.size()) {
+        i = trace.size() - 2;
+    }
+    double u = (ms - trace[i].simTimeMs) / (double)(trace[i + 1].simTimeMs - trace[i].simTimeMs);
+    return trace[i].rate[axis] + u * (trace[i + 1].rate[axis] - trace[i].rate[axis]);
+}
+
+static double alignedRms(uint8_t axis, const std::vector<float>& estimate, int lagMs) {
+    double sum = 0;
+    int count = 0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (trace[i].simTimeMs < WARMUP_MS || isnan(estimate[i])) {
+            continue;
+        }
+        double e = estimate[i] - referenceAt(axis, (double)trace[i].simTimeMs - lagMs);
+        sum += e * e;
+        count++;
+    }
+    return sqrt(sum / count);
+}
+
+static Fit fit(uint8_t axis, const std::vector<float>& estimate) {
+    Fit best = {0, INFINITY};
+    for (int lag = 0; lag <= MAX_LAG_MS; lag++) {
+        double rms = alignedRms(axis, estimate, lag);
+        if (rms < best.rms) {
+            best.lagMs = lag;
+            best.rms = rms;
+        }
+    }
+    return best;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_rate_lag_and_noise(void) {
+    TEST_MESSAGE("Rate estimates on the feed: lag (ms) and RMS error once aligned (deg/s)");
+    for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+        Fit sg = fit(axis, est.sg[axis]);
+        Fit ab = fit(axis, est.alphaBeta[axis]);
+        char line[120];
+        snprintf(line, sizeof(line), "%-5s  SG lag %3d ms rms %5.2f   alpha-beta lag %3d ms rms %5.2f",
+                 AXIS_NAMES[axis], sg.lagMs, sg.rms, ab.lagMs, ab.rms);
+        TEST_MESSAGE(line);
+
+        // The quadratic fit takes the slope at the newest sample: next to
+        // no lag, about a deg/s of noise from the attitude noise and rounding
+        TEST_ASSERT_LESS_OR_EQUAL(10, sg.lagMs);
+        TEST_ASSERT_LESS_THAN_FLOAT(1.5, sg.rms);
+        // The tracker's rate is smoother but trails by about three packets
+        TEST_ASSERT_GREATER_THAN(sg.lagMs + 30, ab.lagMs);
+        TEST_ASSERT_LESS_THAN(90, ab.lagMs);
+        TEST_ASSERT_LESS_THAN_FLOAT(0.6, ab.rms);
+    }
+}
+
+void test_sg_every_message_after_window(void) {
+    for (uint8_t axis = 0; axis < SIM_RATE_COUNT; axis++) {
+        for (size_t i = SIM_DIFF_SAMPLES - 1; i < trace.size(); i++) {
+            TEST_ASSERT_FALSE_MESSAGE(isnan(est.sg[axis][i]), AXIS_NAMES[axis]);
+        }
+    }
+}
+
+void test_yaw_rate_through_360(void) {
+    // Heading crosses 360 in the right turns: no spike in either estimate
+    int crossings = 0;
+    for (size_t i = 1; i < trace.size(); i++) {
+        if (fabsf(trace[i].attitude[2] - trace[i - 1].attitude[2]) > 180.0f) {
+            crossings++;
+            for (size_t k = i; k < i + SIM_DIFF_SAMPLES && k < trace.size(); k++) {
+                TEST_ASSERT_FLOAT_WITHIN(10.0f, trace[k].rate[2], est.sg[SIM_RATE_YAW][k]);
+                TEST_ASSERT_FLOAT_WITHIN(10.0f, trace[k].rate[2], est.alphaBeta[SIM_RATE_YAW][k]);
+            }
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, crossings);
+}
+
+void test_attitude_between_packets(void) {
+    // Alpha-beta attitude at a fixed 100 Hz autopilot tick, against the
+    // trace interpolated on the arrival clock
+    SimEstimator estimator;
+    estimator.configure(configSettings());
+    size_t next = 0;
+    double sum[2] = {0, 0};
+    double held[2] = {0, 0};
+    int count = 0;
+    for (int64_t now = trace[0].arrivalUs; now < trace.back().arrivalUs; now += AP_TICK_US) {
+        for (; next < trace.size() && trace[next].arrivalUs <= now; next++) {
+            estimator.update(message(trace[next]), trace[next].arrivalUs);
+        }
+        const Sample& a = trace[next - 1];
+        const Sample& b = trace[next];
+        if (a.simTimeMs < WARMUP_MS) {
+            continue;
+        }
+        double u = (double)(now - a.arrivalUs) / (double)(b.arrivalUs - a.arrivalUs);
+        for (uint8_t axis = 0; axis < 2; axis++) {
+            double truth = a.attitude[axis] + u * (b.attitude[axis] - a.attitude[axis]);
+            float value;
+            TEST_ASSERT_TRUE(estimator.predict(CHANNELS[axis], now, &value));
+            sum[axis] += (value - truth) * (value - truth);
+            held[axis] += (a.attitude[axis] - truth) * (a.attitude[axis] - truth);
+        }
+        count++;
+    }
+    for (uint8_t axis = 0; axis < 2; axis++) {
+        double rms = sqrt(sum[axis] / count);
+        double heldRms = sqrt(held[axis] / count);
+        char line[96];
+        snprintf(line, sizeof(line), "%-5s  attitude at 100 Hz: rms %.3f deg (last packet held: %.3f)",
+                 AXIS_NAMES[axis], rms, heldRms);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_LESS_THAN_FLOAT(heldRms, rms);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    if (!loadTrace(TEST_DATA_DIR "sim_trace.csv")) {
+        TEST_MESSAGE("Trace " TEST_DATA_DIR "sim_trace.csv not found (run from the project directory)");
+        return UNITY_END() + 1;
+    }
+    replay();
+    RUN_TEST(test_rate_lag_and_noise);
+    RUN_TEST(test_sg_every_message_after_window);
+    RUN_TEST(test_yaw_rate_through_360);
+    RUN_TEST(test_attitude_between_packets);
+    return UNITY_END();
+}
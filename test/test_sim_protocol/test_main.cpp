@@ -0,0 +1,250 @@
+// Simulator protocol: encode / decode round trips and a parse cost
+// benchmark, JSON vs binary (pio test -e native -f test_sim_protocol -v
+// prints the figures)
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "sim_protocol.h"
+
+static std::string frame(const SimMessage& msg) {
+    uint8_t buf[SIM_BINARY_RATES_SIZE + 3];
+    size_t len = encodeSimBinary(msg, buf);
+    return std::string((const char*)buf, len);
+}
+
+static std::string json(const SimMessage& msg) {
+    char buf[SIM_FRAME_MAX];
+    snprintf(buf, sizeof(buf),
+             "{\"seq\":%u,\"t\":%u,\"spd\":%.9g,\"alt\":%.9g,\"pitch\":%.9g,\"roll\":%.9g,\"hdg\":%.9g,\"vs\":%.9g,"
+             "\"prate\":%.9g,\"rrate\":%.9g,\"yrate\":%.9g}\n",
+             (unsigned)msg.seq, (unsigned)msg.simTimeMs, msg.speed, msg.altitude, msg.pitch, msg.roll,
+             msg.heading, msg.verticalSpeed, msg.pitchRate, msg.rollRate, msg.yawRate);
+    return buf;
+}
+
+static std::vector<SimMessage> feed(SimParser& parser, const std::string& bytes, std::vector<SimEvent>* events) {
+    std::vector<SimMessage> out;
+    for (unsigned char c : bytes) {
+        SimMessage msg;
+        SimEvent e = parser.push(c, &msg);
+        if (events != nullptr && e != SIM_EVENT_NONE) {
+            events->push_back(e);
+        }
+        if (e == SIM_EVENT_MESSAGE) {
+            out.push_back(msg);
+        }
+    }
+    return out;
+}
+
+// Sample message; i varies every value (zero bytes included, so COBS has
+// work to do)
+static SimMessage sample(uint32_t i, uint16_t fields) {
+    SimMessage m;
+    m.fields = fields;
+    m.seq = i;
+    m.simTimeMs = 1000000u + i * 20;
+    m.speed = 85.123f + i;
+    m.altitude = (i % 3 == 0) ? 0.0f : 2500.5f - i * 3.25f;
+    m.pitch = 2.5417f - i * 0.01f;
+    m.roll = -1.0833f * (float)(i % 7);
+    m.heading = fmodf(270.254f + i * 1.5f, 360.0f);
+    m.verticalSpeed = -120.75f;
+    if (fields & SIM_FIELD_RATES) {
+        m.pitchRate = 0.5f * i;
+        m.rollRate = -3.0e-3f;
+        m.yawRate = 1.0e4f;
+    }
+    return m;
+}
+
+static void assertSame(const SimMessage& a, const SimMessage& b, float relTol) {
+    TEST_ASSERT_EQUAL_UINT16(a.fields, b.fields);
+    TEST_ASSERT_EQUAL_UINT32(a.seq, b.seq);
+    TEST_ASSERT_EQUAL_UINT32(a.simTimeMs, b.simTimeMs);
+    const float av[] = {a.speed, a.altitude, a.pitch, a.roll, a.heading, a.verticalSpeed,
+                        a.pitchRate, a.rollRate, a.yawRate};
+    const float bv[] = {b.speed, b.altitude, b.pitch, b.roll, b.heading, b.verticalSpeed,
+                        b.pitchRate, b.rollRate, b.yawRate};
+    for (int k = 0; k < 9; k++) {
+        if (relTol == 0) {
+            TEST_ASSERT_TRUE_MESSAGE(memcmp(&av[k], &bv[k], sizeof(float)) == 0, "value not bit-identical");
+        } else {
+            TEST_ASSERT_FLOAT_WITHIN(fabsf(av[k]) * relTol, av[k], bv[k]);
+        }
+    }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_binary_round_trip(void) {
+    SimParser parser;
+    for (uint32_t i = 0; i < 200; i++) {
+        uint16_t fields = (i & 1) ? SIM_FIELD_ALL : SIM_FIELD_STATE;
+        SimMessage m = sample(i, fields);
+        std::vector<SimMessage> out = feed(parser, frame(m), nullptr);
+        TEST_ASSERT_EQUAL(1, out.size());
+        TEST_ASSERT_TRUE(out[0].binary && out[0].hasSeq && out[0].hasTime);
+        if (!(fields & SIM_FIELD_RATES)) {
+            m.pitchRate = m.rollRate = m.yawRate = 0.0f;
+        }
+        assertSame(m, out[0], 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(200, parser.getStats().binaryMessages);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.getStats().lost);
+}
+
+void test_binary_frame_sizes(void) {
+    // COBS adds one byte, plus the two delimiters
+    TEST_ASSERT_EQUAL(SIM_BINARY_STATE_SIZE + 3, frame(sample(1, SIM_FIELD_STATE)).size());
+    TEST_ASSERT_EQUAL(SIM_BINARY_RATES_SIZE + 3, frame(sample(1, SIM_FIELD_ALL)).size());
+}
+
+void test_json_round_trip(void) {
+    SimParser parser;
+    for (uint32_t i = 0; i < 200; i++) {
+        SimMessage m = sample(i, SIM_FIELD_ALL);
+        std::vector<SimMessage> out = feed(parser, json(m), nullptr);
+        TEST_ASSERT_EQUAL(1, out.size());
+        TEST_ASSERT_FALSE(out[0].binary);
+        // 9 significant digits print a float exactly; the scanner rounds
+        // within a few ulp
+        assertSame(m, out[0], 3e-7f);
+    }
+}
+
+void test_mixed_stream_and_corruption(void) {
+    SimParser parser;
+    std::string stream = frame(sample(0, SIM_FIELD_STATE)) + json(sample(1, SIM_FIELD_ALL)) +
+                         frame(sample(2, SIM_FIELD_ALL));
+    std::string bad = frame(sample(3, SIM_FIELD_STATE));
+    bad[10] ^= 0x04;  // Payload bit flip (no delimiter created): CRC error
+    stream += bad + frame(sample(4, SIM_FIELD_STATE));
+
+    std::vector<SimEvent> events;
+    std::vector<SimMessage> out = feed(parser, stream, &events);
+    TEST_ASSERT_EQUAL(4, out.size());
+    TEST_ASSERT_EQUAL_UINT32(4, out[3].seq);
+    TEST_ASSERT_EQUAL(5, events.size());
+    TEST_ASSERT_EQUAL(SIM_EVENT_CRC_ERROR, events[3]);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getStats().lost);  // seq 3
+}
+
+// Bare payload of a stream frame (0x00 | COBS | 0x00)
+static std::vector<uint8_t> unframe(const std::string& f) {
+    std::vector<uint8_t> out;
+    size_t i = 1;
+    while (i + 1 < f.size()) {
+        uint8_t code = (uint8_t)f[i++];
+        for (uint8_t k = 1; k < code; k++) {
+            out.push_back((uint8_t)f[i++]);
+        }
+        if (code < 0xFF && i + 1 < f.size()) {
+            out.push_back(0);
+        }
+    }
+    return out;
+}
+
+void test_datagram_decode(void) {
+    // A datagram carries the bare payload or the JSON text
+    SimMessage m = sample(5, SIM_FIELD_ALL);
+    std::vector<uint8_t> payload = unframe(frame(m));
+    TEST_ASSERT_EQUAL(SIM_BINARY_RATES_SIZE, payload.size());
+    SimMessage viaBinary;
+    TEST_ASSERT_EQUAL(SIM_EVENT_MESSAGE, decodeSimDatagram(payload.data(), payload.size(), &viaBinary));
+    assertSame(m, viaBinary, 0);
+
+    std::string text = json(m);
+    SimMessage viaJson;
+    TEST_ASSERT_EQUAL(SIM_EVENT_MESSAGE,
+                      decodeSimDatagram((const uint8_t*)text.data(), text.size() - 1, &viaJson));
+    assertSame(m, viaJson, 3e-7f);
+
+    payload[12] ^= 0x01;
+    TEST_ASSERT_EQUAL(SIM_EVENT_CRC_ERROR, decodeSimDatagram(payload.data(), payload.size(), &viaBinary));
+    TEST_ASSERT_EQUAL(SIM_EVENT_PARSE_ERROR, decodeSimDatagram(payload.data(), payload.size() - 1, &viaBinary));
+}
+
+void test_feed_request_format(void) {
+    SimFeedRequest req;
+    req.fields = SIM_FIELD_SPEED | SIM_FIELD_PITCH | SIM_FIELD_ROLL;
+    req.hz = 50;
+    req.otherHz = 5;
+    char line[SIM_REQUEST_MAX];
+    size_t len = formatSimRequest(req, 7, line, sizeof(line));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_EQUAL(strlen(line), len);
+    TEST_ASSERT_EQUAL_STRING("@SIMREQ {\"id\":7,\"hz\":50,\"fields\":[\"spd\",\"pitch\",\"roll\"],\"otherHz\":5}\n", line);
+    TEST_ASSERT_EQUAL(0, formatSimRequest(req, 7, line, 20));
+}
+
+// Parse cost through SimParser::push() (the UART / USB path) and the
+// message rate the link and the parser each allow
+static void benchmark(const char* label, const std::string& stream, size_t messages) {
+    const int rounds = 200;
+    SimParser parser;
+    size_t decoded = 0;
+    volatile float sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        parser.reset();  // Sequence numbers restart every round
+        for (unsigned char c : stream) {
+            SimMessage msg;
+            if (parser.push(c, &msg) == SIM_EVENT_MESSAGE) {
+                sink = sink + msg.speed;
+                decoded++;
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    double bytesPerMsg = (double)stream.size() / messages;
+    double nsPerMsg = ns / decoded;
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%-14s %5.1f bytes/msg  %6.1f ns/msg (host)  parser max %7.0f k msg/s  link max %5.0f msg/s @%d baud",
+             label, bytesPerMsg, nsPerMsg, 1e6 / nsPerMsg, SIM_SERIAL_BAUD / 10.0 / bytesPerMsg, SIM_SERIAL_BAUD);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(messages * rounds, decoded);
+}
+
+void test_benchmark_json_vs_binary(void) {
+    const size_t messages = 1000;
+    std::string jsonState, jsonRates, binaryState, binaryRates;
+    for (uint32_t i = 0; i < messages; i++) {
+        SimMessage state = sample(i, SIM_FIELD_STATE);
+        SimMessage rates = sample(i, SIM_FIELD_ALL);
+        char buf[SIM_FRAME_MAX];
+        snprintf(buf, sizeof(buf), "{\"spd\":%.2f,\"alt\":%.1f,\"pitch\":%.3f,\"roll\":%.3f,\"hdg\":%.2f,\"vs\":%.1f}\n",
+                 state.speed, state.altitude, state.pitch, state.roll, state.heading, state.verticalSpeed);
+        jsonState += buf;
+        jsonRates += json(rates);
+        // Back-to-back frames share their delimiter
+        binaryState += frame(state).substr(i == 0 ? 0 : 1);
+        binaryRates += frame(rates).substr(i == 0 ? 0 : 1);
+    }
+    benchmark("json state", jsonState, messages);
+    benchmark("json all", jsonRates, messages);
+    benchmark("binary state", binaryState, messages);
+    benchmark("binary all", binaryRates, messages);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_round_trip);
+    RUN_TEST(test_binary_frame_sizes);
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_mixed_stream_and_corruption);
+    RUN_TEST(test_datagram_decode);
+    RUN_TEST(test_feed_request_format);
+    RUN_TEST(test_benchmark_json_vs_binary);
+    return UNITY_END();
+}
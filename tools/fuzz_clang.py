@@ -0,0 +1,8 @@
+# PlatformIO extra script for the fuzz_cyclic environment: build with clang
+# and link libFuzzer plus the address / undefined-behaviour sanitizers
+Import("env")
+
+SANITIZERS = "-fsanitize=fuzzer,address,undefined"
+
+env.Replace(CC="clang", CXX="clang++", LINK="clang++")
+env.Append(CCFLAGS=[SANITIZERS], LINKFLAGS=[SANITIZERS])
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Hot-function report for the firmware's PC sampler.
+
+Resolves the samples downloaded from /api/sampler/samples against the
+firmware.elf of the same build and prints a flat profile plus a per-task
+breakdown.
+
+Usage:
+    python tools/pc_report.py pc-samples.txt .pio/build/esp32-s3-devkitc-1/firmware.elf
+    python tools/pc_report.py http://esp32-heli.local/api/sampler/samples firmware.elf
+
+addr2line is taken from $ADDR2LINE, else xtensa-esp32s3-elf-addr2line on PATH,
+else the copy in ~/.platformio/packages.
+"""
+
+import argparse
+import collections
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import urllib.request
+
+ADDR2LINE_NAME = "xtensa-esp32s3-elf-addr2line"
+
+
+def find_addr2line():
+    tool = os.environ.get("ADDR2LINE") or shutil.which(ADDR2LINE_NAME)
+    if tool:
+        return tool
+    pattern = os.path.expanduser(
+        "~/.platformio/packages/toolchain-xtensa-esp32s3*/bin/" + ADDR2LINE_NAME + "*")
+    matches = glob.glob(pattern)
+    if matches:
+        return matches[0]
+    sys.exit("addr2line not found; set ADDR2LINE=/path/to/" + ADDR2LINE_NAME)
+
+
+def read_samples(source):
+    if source.startswith("http://") or source.startswith("https://"):
+        with urllib.request.urlopen(source) as resp:
+            text = resp.read().decode()
+    else:
+        with open(source) as f:
+            text = f.read()
+
+    tasks = {}
+    samples = []  # (core, task name, pc)
+    for line in text.splitlines():
+        if not line or line.startswith("#"):
+            continue
+        fields = line.split(",")
+        if fields[0] == "T":
+            tasks[int(fields[1])] = ",".join(fields[2:])
+        elif fields[0] == "S":
+            core, task, pc = int(fields[1]), int(fields[2]), int(fields[3], 16)
+            samples.append((core, task, pc))
+    return [(core, tasks.get(task, "?"), pc) for core, task, pc in samples]
+
+
+def resolve(elf, pcs):
+    """Map each PC to 'function (file:line)' with one addr2line call."""
+    pcs = sorted(set(pc for pc in pcs if pc))
+    names = {0: "(in interrupt)"}
+    if not pcs:
+        return names
+    out = subprocess.run(
+        [find_addr2line(), "-f", "-C", "-e", elf] + ["0x%08x" % pc for pc in pcs],
+        check=True, capture_output=True, text=True).stdout.splitlines()
+    for i, pc in enumerate(pcs):
+        func = out[2 * i] if 2 * i < len(out) else "??"
+        names[pc] = func if func != "??" else "0x%08x" % pc
+    return names
+
+
+def print_table(title, counter, total, limit):
+    print(title)
+    print("  %7s %6s  %s" % ("samples", "%", "function"))
+    for name, n in counter.most_common(limit):
+        print("  %7d %5.1f%%  %s" % (n, 100.0 * n / total, name))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("samples", help="sample dump file or /api/sampler/samples URL")
+    parser.add_argument("elf", help="firmware.elf matching the running build")
+    parser.add_argument("-n", "--top", type=int, default=25, help="rows per table")
+    args = parser.parse_args()
+
+    samples = read_samples(args.samples)
+    if not samples:
+        sys.exit("no samples")
+    names = resolve(args.elf, [pc for _, _, pc in samples])
+    total = len(samples)
+
+    per_core = collections.Counter(core for core, _, _ in samples)
+    print("%d samples (core 0: %d, core 1: %d)\n" % (total, per_core[0], per_core[1]))
+
+    flat = collections.Counter(names[pc] for _, _, pc in samples)
+    print_table("Flat profile", flat, total, args.top)
+
+    by_task = collections.defaultdict(collections.Counter)
+    for core, task, pc in samples:
+        by_task["%s (core %d)" % (task, core)][names[pc]] += 1
+    for task, counter in sorted(by_task.items(), key=lambda kv: -sum(kv[1].values())):
+        n = sum(counter.values())
+        print_table("%s: %d samples, %.1f%%" % (task, n, 100.0 * n / total),
+                    counter, n, min(args.top, 10))
+
+
+if __name__ == "__main__":
+    main()
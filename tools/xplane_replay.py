@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""X-Plane RREF capture / replay stand-in.
+
+Lets the firmware's X-Plane feed (XPLANE_ENABLED) be tested without X-Plane
+running: capture the RREF replies of a real X-Plane once, then replay them to
+the joystick from any PC. The replay side answers RREF subscriptions on
+X-Plane's port exactly like the sim does, remapping the captured values to
+the indexes the subscriber asked for. Each dataref goes out at the rate it
+was subscribed with, capped by the captured rate.
+
+Usage:
+    # Record 60 s of the datarefs the firmware uses from X-Plane at 192.168.1.100
+    python tools/xplane_replay.py capture 192.168.1.100 flight.rref --seconds 60
+
+    # Pretend to be X-Plane (set XPLANE_HOST to this PC's IP)
+    python tools/xplane_replay.py replay flight.rref --loop
+
+    # No capture at hand: a generated gentle climbing turn
+    python tools/xplane_replay.py replay --synthetic
+
+Stopping and restarting the replay looks like a dropped link to the firmware,
+which then resubscribes.
+
+Capture file: "# <index> <dataref>" header lines, then one line per reply
+packet: "<seconds since start> <packet hex>".
+"""
+
+import argparse
+import math
+import socket
+import struct
+import sys
+import time
+
+XPLANE_PORT = 49000
+
+# Same datarefs as xplane_rref.cpp (the index is the position in this list)
+DATAREFS = [
+    "sim/flightmodel/position/indicated_airspeed",
+    "sim/flightmodel/misc/h_ind",
+    "sim/flightmodel/position/theta",
+    "sim/flightmodel/position/phi",
+    "sim/flightmodel/position/mag_psi",
+    "sim/flightmodel/position/vh_ind_fpm",
+    "sim/flightmodel/position/Q",
+    "sim/flightmodel/position/P",
+    "sim/flightmodel/position/R",
+    "sim/time/total_running_time_sec",
+]
+TIME_REF = DATAREFS[-1]
+
+
+def rref_request(freq, index, path):
+    return b"RREF\0" + struct.pack("<ii", freq, index) + path.encode().ljust(400, b"\0")
+
+
+def parse_request(data):
+    """(freq, index, path) of an RREF subscription, or None."""
+    if len(data) < 13 or data[:4] != b"RREF":
+        return None
+    freq, index = struct.unpack_from("<ii", data, 5)
+    path = data[13:413].split(b"\0", 1)[0].decode(errors="replace")
+    return freq, index, path
+
+
+def parse_reply(data):
+    """{index: value} of an RREF reply."""
+    if len(data) < 5 or data[:4] != b"RREF":
+        return {}
+    values = {}
+    for off in range(5, len(data) - 7, 8):
+        index, value = struct.unpack_from("<if", data, off)
+        values[index] = value
+    return values
+
+
+def build_reply(pairs):
+    return b"RREF," + b"".join(struct.pack("<if", i, v) for i, v in pairs)
+
+
+def capture(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", 0))
+    sock.settimeout(1.0)
+    for index, path in enumerate(DATAREFS):
+        sock.sendto(rref_request(args.hz, index, path), (args.host, XPLANE_PORT))
+
+    packets = 0
+    start = time.monotonic()
+    try:
+        with open(args.file, "w") as out:
+            for index, path in enumerate(DATAREFS):
+                out.write("# %d %s\n" % (index, path))
+            while time.monotonic() - start < args.seconds:
+                try:
+                    data = sock.recv(2048)
+                except socket.timeout:
+                    print("no reply from %s yet" % args.host, file=sys.stderr)
+                    continue
+                out.write("%.6f %s\n" % (time.monotonic() - start, data.hex()))
+                packets += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for index, path in enumerate(DATAREFS):
+            sock.sendto(rref_request(0, index, path), (args.host, XPLANE_PORT))
+    print("captured %d packets" % packets)
+
+
+def load_capture(path):
+    names = {}
+    frames = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            if line.startswith("#"):
+                index, name = line[1:].split(None, 1)
+                names[int(index)] = name
+                continue
+            t, payload = line.split()
+            values = parse_reply(bytes.fromhex(payload))
+            frames.append((float(t), {names[i]: v for i, v in values.items() if i in names}))
+    return frames
+
+
+def synthetic_frames(seconds=120.0, hz=50):
+    frames = []
+    for n in range(int(seconds * hz)):
+        t = n / hz
+        frames.append((t, {
+            DATAREFS[0]: 90.0 + 5.0 * math.sin(t / 10.0),
+            DATAREFS[1]: 2500.0 + 5.0 * t,
+            DATAREFS[2]: 3.0,
+            DATAREFS[3]: 15.0 * math.sin(t / 20.0),
+            DATAREFS[4]: (270.0 + 3.0 * t) % 360.0,
+            DATAREFS[5]: 300.0,
+            DATAREFS[6]: 0.0,
+            DATAREFS[7]: 0.75 * math.cos(t / 20.0),
+            DATAREFS[8]: 3.0,
+            TIME_REF: 1000.0 + t,
+        }))
+    return frames
+
+
+def replay(args):
+    frames = synthetic_frames() if args.synthetic else load_capture(args.file)
+    if not frames:
+        sys.exit("nothing to replay")
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    sock.setblocking(False)
+    print("listening for RREF subscriptions on port %d" % args.port)
+
+    subscriber = None
+    subscriptions = {}  # dataref path -> (index, freq)
+    last_sent = {}      # dataref path -> replay time of its last reply
+    duration = frames[-1][0]
+    start = time.monotonic()
+    pos = 0
+    sent = 0
+    time_offset = 0.0  # Keeps the sim clock running forward across loops
+    try:
+        while True:
+            # Subscriptions may arrive (again) at any time
+            while True:
+                try:
+                    data, addr = sock.recvfrom(1024)
+                except BlockingIOError:
+                    break
+                req = parse_request(data)
+                if req is None:
+                    continue
+                freq, index, path = req
+                if addr != subscriber:
+                    print("subscriber %s:%d" % addr)
+                    subscriber = addr
+                    subscriptions = {}
+                if freq == 0:
+                    subscriptions.pop(path, None)
+                else:
+                    subscriptions[path] = (index, freq)
+
+            now = time.monotonic() - start
+            if pos >= len(frames):
+                if not args.loop:
+                    break
+                start += duration
+                time_offset += duration
+                pos = 0
+                continue
+            t, values = frames[pos]
+            if t > now:
+                time.sleep(min(t - now, 0.005))
+                continue
+            pos += 1
+            if subscriber and subscriptions:
+                t += time_offset
+                pairs = []
+                for p, v in values.items():
+                    if p not in subscriptions:
+                        continue
+                    index, freq = subscriptions[p]
+                    # 10% slack so captured timing jitter doesn't skip a frame
+                    if t - last_sent.get(p, -1e9) < 0.9 / freq:
+                        continue
+                    last_sent[p] = t
+                    pairs.append((index, v + time_offset if p == TIME_REF else v))
+                if pairs:
+                    sock.sendto(build_reply(pairs), subscriber)
+                    sent += 1
+    except KeyboardInterrupt:
+        pass
+    print("sent %d replies" % sent)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    cap = sub.add_parser("capture", help="record RREF replies from a running X-Plane")
+    cap.add_argument("host", help="X-Plane PC address")
+    cap.add_argument("file", help="capture file to write")
+    cap.add_argument("--hz", type=int, default=50, help="requested reply rate (default 50)")
+    cap.add_argument("--seconds", type=float, default=60.0, help="capture length (default 60)")
+
+    rep = sub.add_parser("replay", help="answer RREF subscriptions with captured data")
+    rep.add_argument("file", nargs="?", help="capture file to replay")
+    rep.add_argument("--synthetic", action="store_true", help="replay a generated flight instead")
+    rep.add_argument("--loop", action="store_true", help="start over at the end")
+    rep.add_argument("--port", type=int, default=XPLANE_PORT, help="port to listen on (default 49000)")
+
+    args = parser.parse_args()
+    if args.mode == "capture":
+        capture(args)
+    else:
+        if not args.file and not args.synthetic:
+            parser.error("replay needs a capture file or --synthetic")
+        replay(args)
+
+
+if __name__ == "__main__":
+    main()